@@ -2,14 +2,24 @@
 
 #include "BaseFilesDownloader.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
 #include "Containers/UnrealString.h"
 #include "ImageUtils.h"
+#include "RuntimeCallbackDispatcher.h"
 #include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadMemoryBudget.h"
+#include "RuntimeFileIOQueue.h"
+#include "RuntimeProgressAggregator.h"
+#include "RuntimeTextDecoder.h"
+#include "RuntimeTextureDecoder.h"
 #include "Engine/World.h"
 #include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
 
+std::atomic<ERuntimeCallbackExecutor> UBaseFilesDownloader::DefaultCallbackExecutor{ERuntimeCallbackExecutor::GameThread};
+
 UBaseFilesDownloader::UBaseFilesDownloader()
+	: CallbackExecutor(DefaultCallbackExecutor.load())
 {
 	// --- Note: this part is commented out because we don't need to cancel downloads on World reload 
 	// FWorldDelegates::OnWorldCleanup.AddWeakLambda(this, [this](UWorld* World, bool bSessionEnded, bool bCleanupResources)
@@ -30,7 +40,10 @@ void UBaseFilesDownloader::GetContentSize(const FString& URL, float Timeout, con
 {
 	GetContentSize(URL, Timeout, FOnGetDownloadContentLengthNative::CreateLambda([OnComplete](int64 ContentSize)
 	{
-		OnComplete.ExecuteIfBound(ContentSize);
+		RunOnGameThread([OnComplete, ContentSize]()
+		{
+			OnComplete.ExecuteIfBound(ContentSize);
+		});
 	}));
 }
 
@@ -41,25 +54,27 @@ void UBaseFilesDownloader::GetContentSize(const FString& URL, float Timeout, con
 	FileDownloader->RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
 	FileDownloader->RuntimeChunkDownloaderPtr->GetContentSize(URL, Timeout, Headers).Next([FileDownloader, OnComplete](int64 ContentSize)
 	{
+		OnComplete.ExecuteIfBound(ContentSize);
 		if (FileDownloader)
 		{
-			FileDownloader->RemoveFromRoot();
+			FileDownloader->RemoveFromRootOnGameThread();
 		}
-		OnComplete.ExecuteIfBound(ContentSize);
 	});
 }
 
 FString UBaseFilesDownloader::BytesToString(const TArray<uint8>& Bytes)
 {
-	const uint8* BytesData = Bytes.GetData();
-	FString Result;
-	for (int32 Count = Bytes.Num(); Count > 0; --Count)
-	{
-		Result += static_cast<TCHAR>(*BytesData);
+	return FRuntimeTextDecoder::Decode(Bytes.GetData(), Bytes.Num());
+}
 
-		++BytesData;
-	}
-	return Result;
+FString UBaseFilesDownloader::BytesToString(const TArray64<uint8>& Bytes)
+{
+	return FRuntimeTextDecoder::Decode(Bytes.GetData(), Bytes.Num());
+}
+
+FString UBaseFilesDownloader::BytesToString(TArrayView64<const uint8> Bytes)
+{
+	return FRuntimeTextDecoder::Decode(Bytes.GetData(), Bytes.Num());
 }
 
 UTexture2D* UBaseFilesDownloader::BytesToTexture(const TArray<uint8>& Bytes)
@@ -67,6 +82,22 @@ UTexture2D* UBaseFilesDownloader::BytesToTexture(const TArray<uint8>& Bytes)
 	return FImageUtils::ImportBufferAsTexture2D(Bytes);
 }
 
+void UBaseFilesDownloader::BytesToTextureAsync(const TArray<uint8>& Bytes, const FOnBytesToTextureComplete& OnComplete)
+{
+	BytesToTextureAsync(FRuntimeSharedBuffer::MakeCopy(Bytes.GetData(), Bytes.Num()), FOnBytesToTextureCompleteNative::CreateLambda([OnComplete](UTexture2D* Texture)
+	{
+		OnComplete.ExecuteIfBound(Texture);
+	}));
+}
+
+void UBaseFilesDownloader::BytesToTextureAsync(const FRuntimeSharedBuffer& Bytes, const FOnBytesToTextureCompleteNative& OnComplete)
+{
+	FRuntimeTextureDecoder::Get().DecodeAsync(Bytes, [OnComplete](UTexture2D* Texture)
+	{
+		OnComplete.ExecuteIfBound(Texture);
+	});
+}
+
 bool UBaseFilesDownloader::LoadFileToArray(const FString& Filename, TArray<uint8>& Result)
 {
 	return FFileHelper::LoadFileToArray(Result, *Filename);
@@ -87,15 +118,190 @@ bool UBaseFilesDownloader::SaveStringToFile(const FString& String, const FString
 	return FFileHelper::SaveStringToFile(String, *Filename);
 }
 
+void UBaseFilesDownloader::LoadFileToArrayAsync(const FString& FilePath, const FOnLoadFileToArrayComplete& OnComplete)
+{
+	LoadFileToArrayAsync(FilePath, FOnLoadFileToArrayCompleteNative::CreateLambda([OnComplete](bool bSuccess, const TArray64<uint8>& Result)
+	{
+		if (Result.Num() > TNumericLimits<TArray<uint8>::SizeType>::Max())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The loaded file is too large (%lld bytes) to be passed to Blueprints. The maximum size is %d bytes"), Result.Num(), TNumericLimits<TArray<uint8>::SizeType>::Max());
+			OnComplete.ExecuteIfBound(false, TArray<uint8>());
+			return;
+		}
+		OnComplete.ExecuteIfBound(bSuccess, TArray<uint8>(Result));
+	}));
+}
+
+void UBaseFilesDownloader::LoadFileToArrayAsync(const FString& FilePath, const FOnLoadFileToArrayCompleteNative& OnComplete)
+{
+	FRuntimeFileIOQueue::Get().LoadFileToArray(FilePath, [OnComplete](bool bSuccess, TArray64<uint8>&& Result)
+	{
+		OnComplete.ExecuteIfBound(bSuccess, Result);
+	});
+}
+
+void UBaseFilesDownloader::SaveArrayToFileAsync(const TArray<uint8>& Bytes, const FString& FilePath, bool bAtomic, const FOnSaveFileComplete& OnComplete)
+{
+	SaveArrayToFileAsync(FRuntimeSharedBuffer::MakeCopy(Bytes.GetData(), Bytes.Num()), FilePath, bAtomic, FOnSaveFileCompleteNative::CreateLambda([OnComplete](bool bSuccess)
+	{
+		OnComplete.ExecuteIfBound(bSuccess);
+	}));
+}
+
+void UBaseFilesDownloader::SaveArrayToFileAsync(TArray64<uint8>&& Bytes, const FString& FilePath, bool bAtomic, const FOnSaveFileCompleteNative& OnComplete)
+{
+	SaveArrayToFileAsync(FRuntimeSharedBuffer::MakeOwned(MoveTemp(Bytes)), FilePath, bAtomic, OnComplete);
+}
+
+void UBaseFilesDownloader::SaveArrayToFileAsync(const FRuntimeSharedBuffer& Bytes, const FString& FilePath, bool bAtomic, const FOnSaveFileCompleteNative& OnComplete)
+{
+	FRuntimeFileIOQueue::Get().SaveArrayToFile(Bytes, FilePath, bAtomic, [OnComplete](bool bSuccess)
+	{
+		OnComplete.ExecuteIfBound(bSuccess);
+	});
+}
+
+void UBaseFilesDownloader::LoadFileToStringAsync(const FString& FilePath, const FOnLoadFileToStringComplete& OnComplete)
+{
+	LoadFileToStringAsync(FilePath, FOnLoadFileToStringCompleteNative::CreateLambda([OnComplete](bool bSuccess, const FString& Result)
+	{
+		OnComplete.ExecuteIfBound(bSuccess, Result);
+	}));
+}
+
+void UBaseFilesDownloader::LoadFileToStringAsync(const FString& FilePath, const FOnLoadFileToStringCompleteNative& OnComplete)
+{
+	FRuntimeFileIOQueue::Get().LoadFileToString(FilePath, [OnComplete](bool bSuccess, FString&& Result)
+	{
+		OnComplete.ExecuteIfBound(bSuccess, Result);
+	});
+}
+
+void UBaseFilesDownloader::SaveStringToFileAsync(const FString& String, const FString& FilePath, bool bAtomic, const FOnSaveFileComplete& OnComplete)
+{
+	SaveStringToFileAsync(String, FilePath, bAtomic, FOnSaveFileCompleteNative::CreateLambda([OnComplete](bool bSuccess)
+	{
+		OnComplete.ExecuteIfBound(bSuccess);
+	}));
+}
+
+void UBaseFilesDownloader::SaveStringToFileAsync(const FString& String, const FString& FilePath, bool bAtomic, const FOnSaveFileCompleteNative& OnComplete)
+{
+	FRuntimeFileIOQueue::Get().SaveStringToFile(String, FilePath, bAtomic, [OnComplete](bool bSuccess)
+	{
+		OnComplete.ExecuteIfBound(bSuccess);
+	});
+}
+
 bool UBaseFilesDownloader::IsFileExist(const FString& FilePath)
 {
 	return FPaths::FileExists(FilePath);
 }
 
+FRuntimeDownloadTelemetry UBaseFilesDownloader::GetDownloadTelemetry() const
+{
+	return RuntimeChunkDownloaderPtr.IsValid() ? RuntimeChunkDownloaderPtr->GetTelemetry() : FRuntimeDownloadTelemetry();
+}
+
+TArray<FRuntimeDownloadTelemetry> UBaseFilesDownloader::GetRecentDownloadsTelemetry()
+{
+	return FRuntimeDownloadStats::Get().GetRecentDownloads();
+}
+
+FRuntimeDownloadStatsTotals UBaseFilesDownloader::GetDownloadStatsTotals()
+{
+	return FRuntimeDownloadStats::Get().GetTotals();
+}
+
+void UBaseFilesDownloader::SetProgressUpdateRate(float MaxUpdatesPerSecond, int64 MinBytesDelta)
+{
+	FRuntimeProgressAggregator::Get().SetUpdateRate(MaxUpdatesPerSecond, MinBytesDelta);
+}
+
+void UBaseFilesDownloader::SetDownloadMemoryBudget(int64 BudgetBytes)
+{
+	FRuntimeDownloadMemoryBudget::Get().SetBudget(BudgetBytes);
+}
+
+void UBaseFilesDownloader::SetFastStartEnabled(bool bEnabled)
+{
+	FRuntimeChunkDownloader::SetFastStartByDefault(bEnabled);
+}
+
+void UBaseFilesDownloader::SetHedgingEnabled(bool bEnabled, float ThroughputRatio, float LatencyPercentile)
+{
+	FRuntimeHedgingSettings Settings = FRuntimeChunkDownloader::GetHedgingSettingsByDefault();
+	Settings.bEnabled = bEnabled;
+	Settings.ThroughputRatio = FMath::Clamp(ThroughputRatio, 0.f, 1.f);
+	Settings.LatencyPercentile = FMath::Clamp(LatencyPercentile, 0.01f, 1.f);
+	FRuntimeChunkDownloader::SetHedgingSettingsByDefault(Settings);
+}
+
+void UBaseFilesDownloader::SetMaxConnections(int32 MaxConnections)
+{
+	FRuntimeChunkDownloader::SetMaxConnectionsByDefault(MaxConnections);
+}
+
+void UBaseFilesDownloader::SetLowSpeedLimit(float MinBytesPerSecond, float WindowSeconds, float IdleTimeout, int32 MaxRetries)
+{
+	FRuntimeLowSpeedLimit LowSpeedLimit;
+	LowSpeedLimit.MinBytesPerSecond = FMath::Max(0.f, MinBytesPerSecond);
+	LowSpeedLimit.WindowSeconds = FMath::Max(1.f, WindowSeconds);
+	LowSpeedLimit.IdleTimeout = FMath::Max(0.f, IdleTimeout);
+	LowSpeedLimit.MaxRetries = FMath::Max(0, MaxRetries);
+	FRuntimeChunkDownloader::SetLowSpeedLimitByDefault(LowSpeedLimit);
+}
+
+void UBaseFilesDownloader::SetCallbackExecutor(ERuntimeCallbackExecutor Executor)
+{
+	CallbackExecutor = Executor;
+}
+
+void UBaseFilesDownloader::SetDefaultCallbackExecutor(ERuntimeCallbackExecutor Executor)
+{
+	DefaultCallbackExecutor = Executor;
+}
+
+void UBaseFilesDownloader::SetGameThreadCallbackBudget(float MaxMilliseconds)
+{
+	FRuntimeCallbackDispatcher::Get().SetFrameBudget(FMath::Max(0.f, MaxMilliseconds) / 1000.0);
+}
+
 void UBaseFilesDownloader::BroadcastProgress(int64 BytesReceived, int64 ContentLength, float ProgressRatio) const
 {
-	if (OnDownloadProgress.IsBound())
+	if (!OnDownloadProgress.IsBound())
 	{
-		OnDownloadProgress.Execute(BytesReceived, ContentLength, ProgressRatio);
+		return;
 	}
+
+	// The delegate is copied, since the downloader may be collected before a deferred progress update is broadcast
+	DispatchCallback([OnProgress = OnDownloadProgress, BytesReceived, ContentLength, ProgressRatio]()
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UBaseFilesDownloader::BroadcastProgress);
+		OnProgress.ExecuteIfBound(BytesReceived, ContentLength, ProgressRatio);
+	});
+}
+
+void UBaseFilesDownloader::DispatchCallback(TUniqueFunction<void()>&& Callback) const
+{
+	FRuntimeCallbackDispatcher::Get().Dispatch(CallbackExecutor.load(), MoveTemp(Callback));
+}
+
+void UBaseFilesDownloader::RunOnGameThread(TUniqueFunction<void()>&& Callback)
+{
+	if (IsInGameThread())
+	{
+		Callback();
+		return;
+	}
+	FRuntimeCallbackDispatcher::Get().Dispatch(ERuntimeCallbackExecutor::GameThread, MoveTemp(Callback));
+}
+
+void UBaseFilesDownloader::RemoveFromRootOnGameThread()
+{
+	// The downloader stays rooted until then, so it cannot be collected while a callback on another thread still uses it
+	RunOnGameThread([this]()
+	{
+		RemoveFromRoot();
+	});
 }
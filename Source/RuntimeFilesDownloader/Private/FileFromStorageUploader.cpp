@@ -2,6 +2,7 @@
 
 #include "FileToMemoryDownloader.h"
 #include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadMemoryBudget.h"
 #include "RuntimeFilesDownloaderDefines.h"
 #include "Misc/Paths.h"
 #include "HAL/FileManager.h"
@@ -14,10 +15,14 @@ UFileFromStorageUploader* UFileFromStorageUploader::UploadFileFromStorage(
 {
 	return UploadFileFromStorage(URL, FilePath, Timeout, FOnDownloadProgressNative::CreateLambda(
 		[OnProgress](int64 BytesReceived, int64 ContentSize, float ProgressRatio) {
-			OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+			RunOnGameThread([OnProgress, BytesReceived, ContentSize, ProgressRatio]() {
+				OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+			});
 		}), FOnFileFromStorageUploadCompleteNative::CreateLambda(
 		[OnComplete](EUploadFromStorageResult Result, FString& FilePath) {
-			OnComplete.ExecuteIfBound(Result);
+			RunOnGameThread([OnComplete, Result]() {
+				OnComplete.ExecuteIfBound(Result);
+			});
 		}));
 }
 
@@ -50,7 +55,7 @@ void UFileFromStorageUploader::UploadFileFromStorage(const FString& URL, const F
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to upload the file"));
 		OnUploadComplete.ExecuteIfBound(EUploadFromStorageResult::InvalidURL, FilePath);
-		RemoveFromRoot();
+		RemoveFromRootOnGameThread();
 		return;
 	}
 
@@ -58,7 +63,7 @@ void UFileFromStorageUploader::UploadFileFromStorage(const FString& URL, const F
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a path for the file to be uploaded"));
 		OnUploadComplete.ExecuteIfBound(EUploadFromStorageResult::InvalidPath, FilePath);
-		RemoveFromRoot();
+		RemoveFromRootOnGameThread();
 		return;
 	}
 
@@ -74,35 +79,48 @@ void UFileFromStorageUploader::UploadFileFromStorage(const FString& URL, const F
 			ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
 	};
 
-	auto OnResult = [this](FRuntimeChunkUploaderResult&& Result) mutable {
-		OnComplete_Internal(Result.Result);
-	};
+	// The body is held in memory until the upload completes, so it waits for the download memory budget like downloads do
+	const int64 FileSize = FMath::Max<int64>(IFileManager::Get().FileSize(*SourceFile), 0);
+	FRuntimeDownloadMemoryBudget::Get().Reserve(FileSize, nullptr,
+		[this, URL, SourceFile, Timeout, Headers, OnProgress](const FRuntimeDownloadMemoryBudget::FReservationPtr& Reservation) {
+			auto OnResult = [this, Reservation](FRuntimeChunkUploaderResult&& Result) mutable {
+				Reservation->Release();
+				DispatchCallback([this, UploadResult = Result.Result]() {
+					OnComplete_Internal(UploadResult);
 
-	// Read the file from disk
-	TArray<uint8> Body;
-	if (!FFileHelper::LoadFileToArray(Body, *SourceFile))
-	{
-		UE_LOG(LogRuntimeFilesDownloader, Error,
-			TEXT("Something went wrong while reading the file '%s'"), *SourceFile);
-		#if PLATFORM_LINUX || PLATFORM_MAC // Notably, PLATFORM_UNIX is not set on macOS (whyyy?)
-		UE_LOG(LogInit, Warning, TEXT("Failed to read file with errno: %d: %s"),
-			errno, UTF8_TO_TCHAR(strerror(errno)));
-		#elif PLATFORM_WINDOWS
-		// Figure it out yourself. Sorry.
-		#endif
-		OnUploadComplete.ExecuteIfBound(EUploadFromStorageResult::LoadFailed, FilePath);
-		RemoveFromRoot();
-		return;
-	}
+					// The uploader may be collected once it leaves the root set, so this comes after the delegate has been broadcast
+					RemoveFromRootOnGameThread();
+				});
+			};
+
+			// Read the file from disk
+			TArray<uint8> Body;
+			{
+				RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+				if (!FFileHelper::LoadFileToArray(Body, *SourceFile))
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error,
+						TEXT("Something went wrong while reading the file '%s'"), *SourceFile);
+					#if PLATFORM_LINUX || PLATFORM_MAC // Notably, PLATFORM_UNIX is not set on macOS (whyyy?)
+					UE_LOG(LogInit, Warning, TEXT("Failed to read file with errno: %d: %s"),
+						errno, UTF8_TO_TCHAR(strerror(errno)));
+					#elif PLATFORM_WINDOWS
+					// Figure it out yourself. Sorry.
+					#endif
+					Reservation->Release();
+					OnUploadComplete.ExecuteIfBound(EUploadFromStorageResult::LoadFailed, FilePath);
+					RemoveFromRootOnGameThread();
+					return;
+				}
+			}
 
-	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
-	RuntimeChunkDownloaderPtr->UploadFile(URL, Timeout, Body, OnProgress, Headers).Next(OnResult);
+			RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
+			RuntimeChunkDownloaderPtr->UploadFile(URL, Timeout, Body, OnProgress, Headers).Next(OnResult);
+		});
 }
 
 void UFileFromStorageUploader::OnComplete_Internal(EUploadFromStorageResult Result)
 {
-	RemoveFromRoot();
-
 	EUploadFromStorageResult ResultUpstream;
 	switch (Result)
 	{
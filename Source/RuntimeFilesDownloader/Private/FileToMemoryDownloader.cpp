@@ -2,25 +2,41 @@
 
 #include "FileToMemoryDownloader.h"
 #include "RuntimeChunkDownloader.h"
+#include "RuntimeChunkBufferPool.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
 
 UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int32 MaxChunkSize, const FOnDownloadProgress& OnProgress, const FOnFileToMemoryChunkDownloadComplete& OnChunkComplete, const FOnFileToMemoryAllChunksDownloadComplete& OnAllChunksDownloadComplete)
 {
 	return DownloadFileToMemoryPerChunk(URL, Timeout, ContentType, MaxChunkSize, FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float Progress)
 	{
-		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, Progress);
+		RunOnGameThread([OnProgress, BytesReceived, ContentSize, Progress]()
+		{
+			OnProgress.ExecuteIfBound(BytesReceived, ContentSize, Progress);
+		});
 	}), FOnFileToMemoryChunkDownloadCompleteNative::CreateLambda([OnChunkComplete](const TArray64<uint8>& DownloadedContent)
 	{
 		if (DownloadedContent.Num() > TNumericLimits<int32>::Max())
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The size of the downloaded content exceeds the maximum limit for an int32 array. Maximum length: %d, Retrieved length: %lld\nA standard byte array can hold a maximum of 2 GB of data. If you need to download more than 2 GB of data into memory, consider using the C++ native equivalent instead of the Blueprint dynamic delegate"), TNumericLimits<int32>::Max(), DownloadedContent.Num());
-			OnChunkComplete.ExecuteIfBound(TArray<uint8>());
+			RunOnGameThread([OnChunkComplete]()
+			{
+				OnChunkComplete.ExecuteIfBound(TArray<uint8>());
+			});
 			return;
 		}
-		OnChunkComplete.ExecuteIfBound(TArray<uint8>(DownloadedContent));
+
+		// The chunk is only valid for the duration of the native delegate call, so it is copied before it is handed over to the game thread
+		RunOnGameThread([OnChunkComplete, Content = TArray<uint8>(DownloadedContent)]()
+		{
+			OnChunkComplete.ExecuteIfBound(Content);
+		});
 	}), FOnFileToMemoryAllChunksDownloadCompleteNative::CreateLambda([OnAllChunksDownloadComplete](EDownloadToMemoryResult Result)
 	{
-		OnAllChunksDownloadComplete.ExecuteIfBound(Result);
+		RunOnGameThread([OnAllChunksDownloadComplete, Result]()
+		{
+			OnAllChunksDownloadComplete.ExecuteIfBound(Result);
+		});
 	}));
 }
 
@@ -39,16 +55,25 @@ UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemory(const FSt
 {
 	return DownloadFileToMemory(URL, Timeout, ContentType, bForceByPayload, FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float Progress)
 	{
-		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, Progress);
+		RunOnGameThread([OnProgress, BytesReceived, ContentSize, Progress]()
+		{
+			OnProgress.ExecuteIfBound(BytesReceived, ContentSize, Progress);
+		});
 	}), FOnFileToMemoryDownloadCompleteNative::CreateLambda([OnComplete](const TArray64<uint8>& DownloadedContent, EDownloadToMemoryResult Result)
 	{
 		if (DownloadedContent.Num() > TNumericLimits<int32>::Max())
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The size of the downloaded content exceeds the maximum limit for an int32 array. Maximum length: %d, Retrieved length: %lld\nA standard byte array can hold a maximum of 2 GB of data. If you need to download more than 2 GB of data into memory, consider using the C++ native equivalent instead of the Blueprint dynamic delegate"), TNumericLimits<int32>::Max(), DownloadedContent.Num());
-			OnComplete.ExecuteIfBound(TArray<uint8>(), EDownloadToMemoryResult::DownloadFailed);
+			RunOnGameThread([OnComplete]()
+			{
+				OnComplete.ExecuteIfBound(TArray<uint8>(), EDownloadToMemoryResult::DownloadFailed);
+			});
 			return;
 		}
-		OnComplete.ExecuteIfBound(TArray<uint8>(DownloadedContent), Result);
+		RunOnGameThread([OnComplete, Content = TArray<uint8>(DownloadedContent), Result]()
+		{
+			OnComplete.ExecuteIfBound(Content, Result);
+		});
 	}));
 }
 
@@ -62,6 +87,70 @@ UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemory(const FSt
 	return Downloader;
 }
 
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryShared(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSharedNative& OnComplete, const TMap<FString, FString>& Headers)
+{
+	UFileToMemoryDownloader* Downloader = NewObject<UFileToMemoryDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnSharedDownloadComplete = OnComplete;
+	Downloader->DownloadFileToMemory(URL, Timeout, ContentType, bForceByPayload, Headers);
+	return Downloader;
+}
+
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToTexture(const FString& URL, float Timeout, const FString& ContentType, const FOnDownloadProgress& OnProgress, const FOnFileToTextureDownloadComplete& OnComplete)
+{
+	return DownloadFileToTexture(URL, Timeout, ContentType, FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float Progress)
+	{
+		RunOnGameThread([OnProgress, BytesReceived, ContentSize, Progress]()
+		{
+			OnProgress.ExecuteIfBound(BytesReceived, ContentSize, Progress);
+		});
+	}), FOnFileToTextureDownloadCompleteNative::CreateLambda([OnComplete](UTexture2D* Texture, EDownloadToMemoryResult Result)
+	{
+		RunOnGameThread([OnComplete, Texture, Result]()
+		{
+			OnComplete.ExecuteIfBound(Texture, Result);
+		});
+	}));
+}
+
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToTexture(const FString& URL, float Timeout, const FString& ContentType, const FOnDownloadProgressNative& OnProgress, const FOnFileToTextureDownloadCompleteNative& OnComplete, const TMap<FString, FString>& Headers)
+{
+	return DownloadFileToMemoryShared(URL, Timeout, ContentType, false, OnProgress, FOnFileToMemoryDownloadCompleteSharedNative::CreateLambda([OnComplete](const FRuntimeSharedBuffer& DownloadedContent, EDownloadToMemoryResult Result)
+	{
+		if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
+		{
+			OnComplete.ExecuteIfBound(nullptr, Result);
+			return;
+		}
+
+		BytesToTextureAsync(DownloadedContent, FOnBytesToTextureCompleteNative::CreateLambda([OnComplete, Result](UTexture2D* Texture)
+		{
+			OnComplete.ExecuteIfBound(Texture, Texture ? Result : EDownloadToMemoryResult::DownloadFailed);
+		}));
+	}), Headers);
+}
+
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryHybrid(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 SpillThreshold, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSharedNative& OnComplete, const TMap<FString, FString>& Headers)
+{
+	UFileToMemoryDownloader* Downloader = NewObject<UFileToMemoryDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnSharedDownloadComplete = OnComplete;
+	Downloader->DownloadFileToMemoryHybrid(URL, Timeout, ContentType, MaxChunkSize, SpillThreshold, Headers);
+	return Downloader;
+}
+
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemorySegmented(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSegmentedNative& OnComplete, const TMap<FString, FString>& Headers)
+{
+	UFileToMemoryDownloader* Downloader = NewObject<UFileToMemoryDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnSegmentedDownloadComplete = OnComplete;
+	Downloader->DownloadFileToMemorySegmented(URL, Timeout, ContentType, MaxChunkSize, Headers);
+	return Downloader;
+}
+
 bool UFileToMemoryDownloader::CancelDownload()
 {
 	if (RuntimeChunkDownloaderPtr.IsValid())
@@ -78,8 +167,8 @@ void UFileToMemoryDownloader::DownloadFileToMemory(const FString& URL, float Tim
 	if (URL.IsEmpty())
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
-		OnDownloadComplete.ExecuteIfBound(TArray64<uint8>(), EDownloadToMemoryResult::InvalidURL);
-		RemoveFromRoot();
+		BroadcastDownloadComplete(TArray64<uint8>(), EDownloadToMemoryResult::InvalidURL);
+		RemoveFromRootOnGameThread();
 		return;
 	}
 
@@ -96,8 +185,11 @@ void UFileToMemoryDownloader::DownloadFileToMemory(const FString& URL, float Tim
 
 	auto OnResult = [this](FRuntimeChunkDownloaderResult&& Result) mutable
 	{
-		RemoveFromRoot();
-		OnDownloadComplete.ExecuteIfBound(Result.Data, Result.Result);
+		DispatchCallback([this, Result = MoveTemp(Result)]() mutable
+		{
+			BroadcastDownloadComplete(MoveTemp(Result.Data), Result.Result);
+			RemoveFromRootOnGameThread();
+		});
 	};
 
 	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
@@ -111,13 +203,73 @@ void UFileToMemoryDownloader::DownloadFileToMemory(const FString& URL, float Tim
 	}
 }
 
+void UFileToMemoryDownloader::DownloadFileToMemoryHybrid(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 SpillThreshold, const TMap<FString, FString>& Headers)
+{
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
+		BroadcastDownloadComplete(TArray64<uint8>(), EDownloadToMemoryResult::InvalidURL);
+		RemoveFromRootOnGameThread();
+		return;
+	}
+
+	if (Timeout < 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The specified timeout (%f) is less than 0, setting it to 0"), Timeout);
+		Timeout = 0;
+	}
+
+	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
+	RuntimeChunkDownloaderPtr->DownloadFileHybrid(URL, Timeout, ContentType, MaxChunkSize, SpillThreshold, [this](int64 BytesReceived, int64 ContentSize)
+	{
+		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
+	}, Headers).Next([this](FRuntimeChunkDownloaderSharedResult&& Result)
+	{
+		DispatchCallback([this, Result = MoveTemp(Result)]()
+		{
+			OnSharedDownloadComplete.ExecuteIfBound(Result.Data, Result.Result);
+			RemoveFromRootOnGameThread();
+		});
+	});
+}
+
+void UFileToMemoryDownloader::DownloadFileToMemorySegmented(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TMap<FString, FString>& Headers)
+{
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
+		OnSegmentedDownloadComplete.ExecuteIfBound(FRuntimeSegmentedBuffer(), EDownloadToMemoryResult::InvalidURL);
+		RemoveFromRootOnGameThread();
+		return;
+	}
+
+	if (Timeout < 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The specified timeout (%f) is less than 0, setting it to 0"), Timeout);
+		Timeout = 0;
+	}
+
+	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
+	RuntimeChunkDownloaderPtr->DownloadFileSegmented(URL, Timeout, ContentType, MaxChunkSize, [this](int64 BytesReceived, int64 ContentSize)
+	{
+		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
+	}, Headers).Next([this](FRuntimeChunkDownloaderSegmentedResult&& Result)
+	{
+		DispatchCallback([this, Result = MoveTemp(Result)]()
+		{
+			OnSegmentedDownloadComplete.ExecuteIfBound(Result.Data, Result.Result);
+			RemoveFromRootOnGameThread();
+		});
+	});
+}
+
 void UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TMap<FString, FString>& Headers)
 {
 	if (URL.IsEmpty())
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
 		OnDownloadComplete.ExecuteIfBound(TArray64<uint8>(), EDownloadToMemoryResult::InvalidURL);
-		RemoveFromRoot();
+		RemoveFromRootOnGameThread();
 		return;
 	}
 
@@ -131,12 +283,80 @@ void UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(const FString& URL, f
 	RuntimeChunkDownloaderPtr->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, FInt64Vector2(), [this](int64 BytesReceived, int64 ContentSize)
 		{
 			BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
-		}, [this](TArray64<uint8> DownloadedContent)
+		}, [this](TArray64<uint8>&& DownloadedContent)
 		{
 			OnChunkDownloadComplete.ExecuteIfBound(DownloadedContent);
+
+			// The chunk is only valid for the duration of the delegate call, so its buffer can be reused for the next chunk
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(DownloadedContent));
 		}, Headers).Next([this](EDownloadToMemoryResult Result)
 	{
-		RemoveFromRoot();
-		OnAllChunksDownloadComplete.ExecuteIfBound(Result);
+		DispatchCallback([this, Result]()
+		{
+			OnAllChunksDownloadComplete.ExecuteIfBound(Result);
+			RemoveFromRootOnGameThread();
+		});
+	});
+}
+
+void UFileToMemoryDownloader::BroadcastDownloadComplete(TArray64<uint8>&& DownloadedContent, EDownloadToMemoryResult Result)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UFileToMemoryDownloader::BroadcastDownloadComplete);
+	if (OnSharedDownloadComplete.IsBound())
+	{
+		OnSharedDownloadComplete.Execute(FRuntimeSharedBuffer::MakeOwned(MoveTemp(DownloadedContent)), Result);
+		return;
+	}
+	OnDownloadComplete.ExecuteIfBound(DownloadedContent, Result);
+}
+
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryStreamed(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int32 MaxOutstandingChunks, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryStreamedChunkDownloadCompleteNative& OnChunkDownloadComplete, const FOnFileToMemoryAllChunksDownloadCompleteNative& OnAllChunksDownloadComplete, const TMap<FString, FString>& Headers)
+{
+	UFileToMemoryDownloader* Downloader = NewObject<UFileToMemoryDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnStreamedChunkDownloadComplete = OnChunkDownloadComplete;
+	Downloader->OnAllChunksDownloadComplete = OnAllChunksDownloadComplete;
+	Downloader->DownloadFileToMemoryStreamed(URL, Timeout, ContentType, MaxChunkSize, MaxOutstandingChunks, Headers);
+	return Downloader;
+}
+
+void UFileToMemoryDownloader::DownloadFileToMemoryStreamed(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int32 MaxOutstandingChunks, const TMap<FString, FString>& Headers)
+{
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
+		OnAllChunksDownloadComplete.ExecuteIfBound(EDownloadToMemoryResult::InvalidURL);
+		RemoveFromRootOnGameThread();
+		return;
+	}
+
+	if (Timeout < 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The specified timeout (%f) is less than 0, setting it to 0"), Timeout);
+		Timeout = 0;
+	}
+
+	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
+	RuntimeChunkDownloaderPtr->DownloadFileStreamed(URL, Timeout, ContentType, MaxChunkSize, MaxOutstandingChunks, [this](int64 BytesReceived, int64 ContentSize)
+	{
+		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
+	}, [this](FRuntimeStreamedChunk& Chunk)
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UFileToMemoryDownloader::BroadcastStreamedChunk);
+		if (!OnStreamedChunkDownloadComplete.IsBound())
+		{
+			// Nobody consumes the chunk, so its credit is returned right away
+			Chunk.Acknowledge();
+			return;
+		}
+		OnStreamedChunkDownloadComplete.Execute(Chunk);
+	}, Headers).Next([this](EDownloadToMemoryResult Result)
+	{
+		DispatchCallback([this, Result]()
+		{
+			OnAllChunksDownloadComplete.ExecuteIfBound(Result);
+			RemoveFromRootOnGameThread();
+		});
 	});
 }
@@ -4,20 +4,36 @@
 
 #include "FileToMemoryDownloader.h"
 #include "RuntimeChunkDownloader.h"
+#include "RuntimeMappedFileWriter.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "Misc/Guid.h"
 #include "Misc/Paths.h"
 #include "HAL/FileManager.h"
 #include "HAL/PlatformFileManager.h"
 #include "GenericPlatform/GenericPlatformFile.h"
+#include <atomic>
+
+namespace FileToStorageDownloader
+{
+	/** The smallest number of connections a preallocated file is downloaded over, since its chunks are written in place in any order */
+	constexpr int32 MinPreallocatedConnections = 4;
+}
 
 UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgress& OnProgress, const FOnFileToStorageDownloadComplete& OnComplete)
 {
 	return DownloadFileToStorage(URL, SavePath, Timeout, ContentType, bForceByPayload, FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float ProgressRatio)
 	{
-		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+		RunOnGameThread([OnProgress, BytesReceived, ContentSize, ProgressRatio]()
+		{
+			OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+		});
 	}), FOnFileToStorageDownloadCompleteNative::CreateLambda([OnComplete](EDownloadToStorageResult Result, const FString& SavedPath, const TArray<FString>& Headers)
 	{
-		OnComplete.ExecuteIfBound(Result, SavedPath);
+		RunOnGameThread([OnComplete, Result, SavedPath]()
+		{
+			OnComplete.ExecuteIfBound(Result, SavedPath);
+		});
 	}));
 }
 
@@ -31,6 +47,33 @@ UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStorage(const
 	return Downloader;
 }
 
+UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStoragePreallocated(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, int32 MaxChunkSize, const FOnDownloadProgress& OnProgress, const FOnFileToStorageDownloadComplete& OnComplete)
+{
+	return DownloadFileToStoragePreallocated(URL, SavePath, Timeout, ContentType, static_cast<int64>(MaxChunkSize), FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float ProgressRatio)
+	{
+		RunOnGameThread([OnProgress, BytesReceived, ContentSize, ProgressRatio]()
+		{
+			OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+		});
+	}), FOnFileToStorageDownloadCompleteNative::CreateLambda([OnComplete](EDownloadToStorageResult Result, const FString& SavedPath, const TArray<FString>& Headers)
+	{
+		RunOnGameThread([OnComplete, Result, SavedPath]()
+		{
+			OnComplete.ExecuteIfBound(Result, SavedPath);
+		});
+	}));
+}
+
+UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStoragePreallocated(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToStorageDownloadCompleteNative& OnComplete, const TMap<FString, FString>& Headers)
+{
+	UFileToStorageDownloader* Downloader = NewObject<UFileToStorageDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnDownloadComplete = OnComplete;
+	Downloader->DownloadFileToStoragePreallocated(URL, SavePath, Timeout, ContentType, MaxChunkSize, Headers);
+	return Downloader;
+}
+
 bool UFileToStorageDownloader::CancelDownload()
 {
 	if (RuntimeChunkDownloaderPtr.IsValid())
@@ -47,7 +90,7 @@ void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const F
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
 		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidURL, SavePath, {});
-		RemoveFromRoot();
+		RemoveFromRootOnGameThread();
 		return;
 	}
 
@@ -55,7 +98,7 @@ void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const F
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a path to save the file"));
 		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidSavePath, SavePath, {});
-		RemoveFromRoot();
+		RemoveFromRootOnGameThread();
 		return;
 	}
 
@@ -74,7 +117,13 @@ void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const F
 
 	auto OnResult = [this](FRuntimeChunkDownloaderResult&& Result) mutable
 	{
-		OnComplete_Internal(Result.Result, MoveTemp(Result.Data), Result.Headers);
+		DispatchCallback([this, Result = MoveTemp(Result)]() mutable
+		{
+			OnComplete_Internal(Result.Result, MoveTemp(Result.Data), Result.Headers);
+
+			// Only once the file has been saved and the delegate broadcast, since the garbage collector may collect the downloader as soon as it leaves the root set
+			RemoveFromRootOnGameThread();
+		});
 	};
 
 	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
@@ -89,28 +138,164 @@ void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const F
 	}
 }
 
-void UFileToStorageDownloader::OnComplete_Internal(EDownloadToMemoryResult Result, TArray64<uint8> DownloadedContent, TArray<FString> Headers)
+void UFileToStorageDownloader::DownloadFileToStoragePreallocated(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TMap<FString, FString>& Headers)
 {
-	RemoveFromRoot();
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidURL, SavePath, {});
+		RemoveFromRootOnGameThread();
+		return;
+	}
 
-	if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
+	if (SavePath.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a path to save the file"));
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidSavePath, SavePath, {});
+		RemoveFromRootOnGameThread();
+		return;
+	}
+
+	if (Timeout < 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The specified timeout (%f) is less than 0, setting it to 0"), Timeout);
+		Timeout = 0;
+	}
+
+	FileSavePath = SavePath;
+
+	auto OnProgress = [this](int64 BytesReceived, int64 ContentSize)
+	{
+		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
+	};
+
+	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
+	RuntimeChunkDownloaderPtr->GetContentSize(URL, Timeout, Headers).Next([this, URL, Timeout, ContentType, MaxChunkSize, Headers, OnProgress](int64 ContentSize)
 	{
-		// TODO: redesign in a more elegant way
-		switch (Result)
+		// -304 is used by GetContentSize to signal that the HEAD request returned a "304 Not Modified" instead of a size
+		if (ContentSize == -304)
 		{
-		case EDownloadToMemoryResult::Cancelled:
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::Cancelled, FileSavePath, Headers);
-			break;
-		case EDownloadToMemoryResult::DownloadFailed:
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DownloadFailed, FileSavePath, Headers);
-			break;
-		case EDownloadToMemoryResult::InvalidURL:
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidURL, FileSavePath, Headers);
-			break;
-		case EDownloadToMemoryResult::NotModified:
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::NotModified, FileSavePath, Headers);
-			break;
+			DispatchCallback([this]()
+			{
+				OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::NotModified, FileSavePath, {});
+				RemoveFromRootOnGameThread();
+			});
+			return;
+		}
+
+		// Without a known size, the file cannot be preallocated, so download it in memory as usual
+		if (ContentSize <= 0 || MaxChunkSize <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to preallocate the file for %s (content size: %lld, max chunk size: %lld). Trying to download the file by payload"), *URL, ContentSize, MaxChunkSize);
+			RuntimeChunkDownloaderPtr->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress, Headers).Next([this](FRuntimeChunkDownloaderResult&& Result) mutable
+			{
+				DispatchCallback([this, Result = MoveTemp(Result)]() mutable
+				{
+					OnComplete_Internal(Result.Result, MoveTemp(Result.Data), Result.Headers);
+					RemoveFromRootOnGameThread();
+				});
+			});
+			return;
 		}
+
+		if (!CreateSaveDirectory())
+		{
+			DispatchCallback([this]()
+			{
+				OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DirectoryCreationFailed, FileSavePath, {});
+				RemoveFromRootOnGameThread();
+			});
+			return;
+		}
+
+		// Download into a temporary file so that an existing file is only replaced once the download succeeds. The name is unique so that concurrent downloads to the same path do not share it
+		const FString TempFilePath = FString::Printf(TEXT("%s.%s.download"), *FileSavePath, *FGuid::NewGuid().ToString());
+		TUniquePtr<FRuntimeMappedFileWriter> FileWriter = FRuntimeMappedFileWriter::Create(TempFilePath, ContentSize);
+		if (!FileWriter.IsValid())
+		{
+			DispatchCallback([this]()
+			{
+				OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::PreallocationFailed, FileSavePath, {});
+				RemoveFromRootOnGameThread();
+			});
+			return;
+		}
+		TSharedPtr<FRuntimeMappedFileWriter, ESPMode::ThreadSafe> FileWriterPtr = MakeShareable(FileWriter.Release());
+
+		TSharedRef<std::atomic<int64>, ESPMode::ThreadSafe> WrittenSizePtr = MakeShared<std::atomic<int64>, ESPMode::ThreadSafe>(0);
+		TSharedRef<std::atomic<bool>, ESPMode::ThreadSafe> bWriteFailedPtr = MakeShared<std::atomic<bool>, ESPMode::ThreadSafe>(false);
+
+		// The chunks are written at their offset straight from the HTTP responses, in whatever order the connections complete them
+		auto WriteChunk = [FileWriterPtr, WrittenSizePtr, bWriteFailedPtr](int64 Offset, const uint8* Data, int64 Size)
+		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UFileToStorageDownloader::WriteChunk);
+			if (!FileWriterPtr->Write(Offset, Data, Size))
+			{
+				*bWriteFailedPtr = true;
+				return false;
+			}
+			*WrittenSizePtr += Size;
+			return true;
+		};
+
+		const int32 NumConnections = FMath::Max(RuntimeChunkDownloaderPtr->GetMaxConnections(), FileToStorageDownloader::MinPreallocatedConnections);
+		RuntimeChunkDownloaderPtr->DownloadFileInto(URL, Timeout, ContentType, ContentSize, MaxChunkSize, NumConnections, OnProgress, WriteChunk, Headers).Next([this, FileWriterPtr, WrittenSizePtr, bWriteFailedPtr](FRuntimeChunkDownloaderResult&& IntoResult)
+		{
+			const EDownloadToMemoryResult Result = IntoResult.Result;
+			// Finalizing and moving the file is the heavy part of the completion, so it runs on the callback executor as well
+			DispatchCallback([this, Result, FileWriterPtr, WrittenSize = WrittenSizePtr->load(), bWriteFailed = bWriteFailedPtr->load()]()
+			{
+				OnPreallocatedComplete_Internal(Result, FileWriterPtr, WrittenSize, bWriteFailed);
+				RemoveFromRootOnGameThread();
+			});
+		});
+	});
+}
+
+void UFileToStorageDownloader::OnPreallocatedComplete_Internal(EDownloadToMemoryResult Result, const TSharedPtr<FRuntimeMappedFileWriter, ESPMode::ThreadSafe>& FileWriterPtr, int64 WrittenSize, bool bWriteFailed)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UFileToStorageDownloader::OnPreallocatedComplete_Internal);
+
+	if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload && !bWriteFailed)
+	{
+		FileWriterPtr->Abort();
+		BroadcastDownloadFailure(Result, {});
+		return;
+	}
+
+	if (bWriteFailed || WrittenSize != FileWriterPtr->GetFileSize())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while writing the downloaded data to the file '%s' (written %lld of %lld bytes)"), *FileWriterPtr->GetFilePath(), WrittenSize, FileWriterPtr->GetFileSize());
+		FileWriterPtr->Abort();
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, {});
+		return;
+	}
+
+	if (!FileWriterPtr->Finalize())
+	{
+		FileWriterPtr->Abort();
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, {});
+		return;
+	}
+
+	if (!IFileManager::Get().Move(*FileSavePath, *FileWriterPtr->GetFilePath(), true, true))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while moving the downloaded file '%s' to '%s'"), *FileWriterPtr->GetFilePath(), *FileSavePath);
+		FileWriterPtr->Abort();
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, {});
+		return;
+	}
+
+	OnDownloadComplete.ExecuteIfBound(Result == EDownloadToMemoryResult::SucceededByPayload ? EDownloadToStorageResult::SucceededByPayload : EDownloadToStorageResult::Success, FileSavePath, {});
+}
+
+void UFileToStorageDownloader::OnComplete_Internal(EDownloadToMemoryResult Result, TArray64<uint8> DownloadedContent, TArray<FString> Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UFileToStorageDownloader::OnComplete_Internal);
+
+	if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
+	{
+		BroadcastDownloadFailure(Result, Headers);
 		return;
 	}
 
@@ -124,18 +309,10 @@ void UFileToStorageDownloader::OnComplete_Internal(EDownloadToMemoryResult Resul
 	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
 
 	// Create save directory if it does not exist
+	if (!CreateSaveDirectory())
 	{
-		FString Path, Filename, Extension;
-		FPaths::Split(FileSavePath, Path, Filename, Extension);
-		if (!PlatformFile.DirectoryExists(*Path))
-		{
-			if (!PlatformFile.CreateDirectoryTree(*Path))
-			{
-				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create a directory '%s' to save the downloaded file"), *Path);
-				OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DirectoryCreationFailed, FileSavePath, Headers);
-				return;
-			}
-		}
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DirectoryCreationFailed, FileSavePath, Headers);
+		return;
 	}
 
 	// Delete the file if it already exists
@@ -150,22 +327,66 @@ void UFileToStorageDownloader::OnComplete_Internal(EDownloadToMemoryResult Resul
 		}
 	}
 
-	IFileHandle* FileHandle = PlatformFile.OpenWrite(*FileSavePath);
-	if (!FileHandle)
+	bool bWritten;
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while saving the file '%s'"), *FileSavePath);
-		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, Headers);
-		return;
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UFileToStorageDownloader::WriteFile);
+
+		IFileHandle* FileHandle = PlatformFile.OpenWrite(*FileSavePath);
+		if (!FileHandle)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while saving the file '%s'"), *FileSavePath);
+			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, Headers);
+			return;
+		}
+
+		bWritten = FileHandle->Write(DownloadedContent.GetData(), DownloadedContent.Num());
+		delete FileHandle;
 	}
 
-	if (!FileHandle->Write(DownloadedContent.GetData(), DownloadedContent.Num()))
+	if (!bWritten)
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while writing the response data to the file '%s'"), *FileSavePath);
-		delete FileHandle;
 		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, Headers);
 		return;
 	}
 
-	delete FileHandle;
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(UFileToStorageDownloader::BroadcastComplete);
 	OnDownloadComplete.ExecuteIfBound(Result == EDownloadToMemoryResult::SucceededByPayload ? EDownloadToStorageResult::SucceededByPayload : EDownloadToStorageResult::Success, FileSavePath, Headers);
 }
+
+void UFileToStorageDownloader::BroadcastDownloadFailure(EDownloadToMemoryResult Result, const TArray<FString>& Headers)
+{
+	// TODO: redesign in a more elegant way
+	switch (Result)
+	{
+	case EDownloadToMemoryResult::Cancelled:
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::Cancelled, FileSavePath, Headers);
+		break;
+	case EDownloadToMemoryResult::DownloadFailed:
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DownloadFailed, FileSavePath, Headers);
+		break;
+	case EDownloadToMemoryResult::InvalidURL:
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidURL, FileSavePath, Headers);
+		break;
+	case EDownloadToMemoryResult::NotModified:
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::NotModified, FileSavePath, Headers);
+		break;
+	}
+}
+
+bool UFileToStorageDownloader::CreateSaveDirectory() const
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	FString Path, Filename, Extension;
+	FPaths::Split(FileSavePath, Path, Filename, Extension);
+	if (!PlatformFile.DirectoryExists(*Path))
+	{
+		if (!PlatformFile.CreateDirectoryTree(*Path))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create a directory '%s' to save the downloaded file"), *Path);
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,167 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeByteRangesParser.h"
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+
+namespace RuntimeByteRangesParser
+{
+	/** Lines outside of the part bodies are short, so a longer line means that the body is not what it claims to be */
+	constexpr int32 MaxLineLength = 8 * 1024;
+
+	bool LineEquals(const uint8* Line, int32 Size, const TArray<uint8>& Expected, bool bClosing)
+	{
+		const int32 ExpectedSize = Expected.Num() + (bClosing ? 2 : 0);
+		if (Size != ExpectedSize || FMemory::Memcmp(Line, Expected.GetData(), Expected.Num()) != 0)
+		{
+			return false;
+		}
+		return !bClosing || (Line[Size - 2] == '-' && Line[Size - 1] == '-');
+	}
+}
+
+FRuntimeByteRangesParser::FRuntimeByteRangesParser(const FString& InBoundary, TFunction<void(int64, const uint8*, int64)>&& InOnPartData)
+	: OnPartData(MoveTemp(InOnPartData))
+{
+	const FTCHARToUTF8 BoundaryUTF8(*InBoundary);
+	Delimiter.Append(reinterpret_cast<const uint8*>("--"), 2);
+	Delimiter.Append(reinterpret_cast<const uint8*>(BoundaryUTF8.Get()), BoundaryUTF8.Length());
+}
+
+bool FRuntimeByteRangesParser::GetBoundary(const FString& ContentType, FString& OutBoundary)
+{
+	TArray<FString> Parameters;
+	ContentType.ParseIntoArray(Parameters, TEXT(";"));
+	if (Parameters.Num() < 2 || !Parameters[0].TrimStartAndEnd().Equals(TEXT("multipart/byteranges"), ESearchCase::IgnoreCase))
+	{
+		return false;
+	}
+
+	for (int32 Index = 1; Index < Parameters.Num(); ++Index)
+	{
+		FString Name, Value;
+		if (Parameters[Index].Split(TEXT("="), &Name, &Value) && Name.TrimStartAndEnd().Equals(TEXT("boundary"), ESearchCase::IgnoreCase))
+		{
+			OutBoundary = Value.TrimStartAndEnd().TrimQuotes();
+			return !OutBoundary.IsEmpty();
+		}
+	}
+	return false;
+}
+
+bool FRuntimeByteRangesParser::Feed(const uint8* Data, int64 Size)
+{
+	while (Size > 0 && State != EState::Done && State != EState::Error)
+	{
+		// Part data is passed on directly without being buffered
+		if (State == EState::PartBody)
+		{
+			const int64 PieceSize = FMath::Min(Size, PartRemaining);
+			OnPartData(PartPosition, Data, PieceSize);
+			PartPosition += PieceSize;
+			PartRemaining -= PieceSize;
+			Data += PieceSize;
+			Size -= PieceSize;
+			if (PartRemaining == 0)
+			{
+				State = EState::PartEnd;
+			}
+			continue;
+		}
+
+		int64 LineLength = 0;
+		while (LineLength < Size && Data[LineLength] != '\n')
+		{
+			++LineLength;
+		}
+
+		if (PendingLine.Num() + LineLength > RuntimeByteRangesParser::MaxLineLength)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the multipart/byteranges response: a line exceeds %d bytes"), RuntimeByteRangesParser::MaxLineLength);
+			State = EState::Error;
+			break;
+		}
+
+		PendingLine.Append(Data, static_cast<int32>(LineLength));
+		if (LineLength == Size)
+		{
+			// The rest of the line has not been received yet
+			break;
+		}
+
+		Data += LineLength + 1;
+		Size -= LineLength + 1;
+		ParseLine(PendingLine.GetData(), PendingLine.Num());
+		PendingLine.Reset();
+	}
+	return State != EState::Error;
+}
+
+void FRuntimeByteRangesParser::ParseLine(const uint8* Line, int32 Size)
+{
+	// Line breaks are CRLF, and the boundary may be followed by transport padding
+	while (Size > 0 && (Line[Size - 1] == '\r' || Line[Size - 1] == ' ' || Line[Size - 1] == '\t'))
+	{
+		--Size;
+	}
+
+	switch (State)
+	{
+	case EState::Preamble:
+	case EState::PartEnd:
+		{
+			if (RuntimeByteRangesParser::LineEquals(Line, Size, Delimiter, false))
+			{
+				State = EState::PartHeaders;
+				PartPosition = -1;
+				PartRemaining = 0;
+			}
+			else if (RuntimeByteRangesParser::LineEquals(Line, Size, Delimiter, true))
+			{
+				State = EState::Done;
+			}
+			else if (State == EState::PartEnd && Size > 0)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the multipart/byteranges response: expected a boundary after the data of a part"));
+				State = EState::Error;
+			}
+			break;
+		}
+	case EState::PartHeaders:
+		{
+			if (Size == 0)
+			{
+				if (PartPosition < 0)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the multipart/byteranges response: a part has no Content-Range header"));
+					State = EState::Error;
+					break;
+				}
+				State = EState::PartBody;
+				break;
+			}
+
+			const FUTF8ToTCHAR HeaderConverter(reinterpret_cast<const ANSICHAR*>(Line), Size);
+			const FString Header(HeaderConverter.Length(), HeaderConverter.Get());
+			FString Name, Value;
+			if (!Header.Split(TEXT(":"), &Name, &Value) || !Name.TrimStartAndEnd().Equals(TEXT("Content-Range"), ESearchCase::IgnoreCase))
+			{
+				break;
+			}
+
+			int64 RangeStart, RangeEnd, TotalSize;
+			if (!FRuntimeChunkDownloader::ParseContentRange(Value, RangeStart, RangeEnd, TotalSize))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the multipart/byteranges response: invalid Content-Range '%s'"), *Value);
+				State = EState::Error;
+				break;
+			}
+			PartPosition = RangeStart;
+			PartRemaining = RangeEnd - RangeStart + 1;
+			FileSize = TotalSize;
+			break;
+		}
+	default:
+		break;
+	}
+}
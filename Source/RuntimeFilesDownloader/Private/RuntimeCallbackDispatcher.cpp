@@ -0,0 +1,117 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeCallbackDispatcher.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+FRuntimeCallbackDispatcher& FRuntimeCallbackDispatcher::Get()
+{
+	static FRuntimeCallbackDispatcher Dispatcher;
+	return Dispatcher;
+}
+
+void FRuntimeCallbackDispatcher::Dispatch(ERuntimeCallbackExecutor Executor, TUniqueFunction<void()>&& Callback)
+{
+	switch (Executor)
+	{
+	case ERuntimeCallbackExecutor::HttpThread:
+		{
+			Callback();
+			return;
+		}
+	case ERuntimeCallbackExecutor::TaskGraph:
+		{
+			AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, MoveTemp(Callback));
+			return;
+		}
+	default:
+		break;
+	}
+
+	FScopeLock Lock(&CriticalSection);
+
+	// The ticker is added lazily, since the core ticker may not exist yet when the singleton is first accessed
+	if (!TickerHandle.IsValid())
+	{
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimeCallbackDispatcher::Tick));
+#else
+		TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimeCallbackDispatcher::Tick));
+#endif
+	}
+	QueuedCallbacks.Add(MoveTemp(Callback));
+}
+
+void FRuntimeCallbackDispatcher::SetFrameBudget(double InFrameBudget)
+{
+	FScopeLock Lock(&CriticalSection);
+	FrameBudget = FMath::Max(0.0, InFrameBudget);
+}
+
+int32 FRuntimeCallbackDispatcher::GetNumQueued() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return QueuedCallbacks.Num();
+}
+
+void FRuntimeCallbackDispatcher::Shutdown()
+{
+	FScopeLock Lock(&CriticalSection);
+	if (TickerHandle.IsValid())
+	{
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#else
+		FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#endif
+		TickerHandle.Reset();
+	}
+	QueuedCallbacks.Empty();
+}
+
+bool FRuntimeCallbackDispatcher::Tick(float DeltaTime)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeCallbackDispatcher::Tick);
+
+	TArray<TUniqueFunction<void()>> Callbacks;
+	double Budget;
+	{
+		FScopeLock Lock(&CriticalSection);
+		Callbacks = MoveTemp(QueuedCallbacks);
+		QueuedCallbacks.Reset();
+		Budget = FrameBudget;
+	}
+
+	if (Callbacks.Num() == 0)
+	{
+		return true;
+	}
+
+	// Callbacks may start new downloads and queue more callbacks, so they are called outside of the lock
+	const double StartTime = FPlatformTime::Seconds();
+	int32 NumRun = 0;
+	while (NumRun < Callbacks.Num())
+	{
+		Callbacks[NumRun]();
+		++NumRun;
+
+		if (Budget > 0 && FPlatformTime::Seconds() - StartTime >= Budget)
+		{
+			break;
+		}
+	}
+
+	if (NumRun < Callbacks.Num())
+	{
+		// The callbacks left over are put in front of the ones queued in the meantime, so the order is kept
+		Callbacks.RemoveAt(0, NumRun);
+		FScopeLock Lock(&CriticalSection);
+		Callbacks.Append(MoveTemp(QueuedCallbacks));
+		QueuedCallbacks = MoveTemp(Callbacks);
+		UE_LOG(LogRuntimeFilesDownloader, Verbose, TEXT("Ran %d callbacks on the game thread within the frame budget of %f ms, %d are deferred to the next frame"), NumRun, Budget * 1000, QueuedCallbacks.Num());
+	}
+	return true;
+}
@@ -0,0 +1,167 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeChunkBufferPool.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeDownloadMemoryBudget.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Misc/ScopeLock.h"
+
+FRuntimeChunkBufferPool& FRuntimeChunkBufferPool::Get()
+{
+	static FRuntimeChunkBufferPool Pool;
+	return Pool;
+}
+
+TArray64<uint8> FRuntimeChunkBufferPool::Acquire(int64 Size)
+{
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+	const int32 SizeClassIndex = GetAcquireSizeClassIndex(Size);
+	if (SizeClassIndex == INDEX_NONE)
+	{
+		// Too large to be pooled, allocate exactly what was requested
+		{
+			FScopeLock Lock(&CriticalSection);
+			++Stats.Misses;
+		}
+		TArray64<uint8> Buffer;
+		Buffer.Reserve(Size);
+		return Buffer;
+	}
+
+	{
+		FScopeLock Lock(&CriticalSection);
+		TArray<TArray64<uint8>>& Buffers = FreeBuffers[SizeClassIndex];
+		if (Buffers.Num() > 0)
+		{
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+			TArray64<uint8> Buffer = Buffers.Pop(EAllowShrinking::No);
+#else
+			TArray64<uint8> Buffer = Buffers.Pop(false);
+#endif
+			Stats.PooledBytes -= Buffer.Max();
+			++Stats.Hits;
+			return Buffer;
+		}
+		++Stats.Misses;
+	}
+
+	// Allocate the whole size class so that the buffer can be pooled again once released
+	TArray64<uint8> Buffer;
+	Buffer.Reserve(GetSizeClassBytes(SizeClassIndex));
+	return Buffer;
+}
+
+TArray64<uint8> FRuntimeChunkBufferPool::AcquireCopy(const uint8* Data, int64 Size)
+{
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+	TArray64<uint8> Buffer = Acquire(Size);
+	if (Data && Size > 0)
+	{
+		Buffer.Append(Data, Size);
+	}
+	return Buffer;
+}
+
+void FRuntimeChunkBufferPool::Release(TArray64<uint8>&& Buffer)
+{
+	const int32 SizeClassIndex = GetReleaseSizeClassIndex(Buffer.Max());
+
+	// Take ownership of the buffer so that the caller is left with an empty array in any case
+	TArray64<uint8> ReleasedBuffer = MoveTemp(Buffer);
+	ReleasedBuffer.Reset();
+
+	FScopeLock Lock(&CriticalSection);
+	if (SizeClassIndex == INDEX_NONE || Stats.PooledBytes + ReleasedBuffer.Max() > MaxPooledBytes)
+	{
+		++Stats.Discards;
+		return;
+	}
+
+	Stats.PooledBytes += ReleasedBuffer.Max();
+	Stats.PeakPooledBytes = FMath::Max(Stats.PeakPooledBytes, Stats.PooledBytes);
+	++Stats.Returns;
+	FreeBuffers[SizeClassIndex].Add(MoveTemp(ReleasedBuffer));
+}
+
+void FRuntimeChunkBufferPool::SetMaxPooledBytes(int64 InMaxPooledBytes)
+{
+	FScopeLock Lock(&CriticalSection);
+	MaxPooledBytes = FMath::Max<int64>(InMaxPooledBytes, 0);
+	TrimTo_Locked(MaxPooledBytes);
+}
+
+int64 FRuntimeChunkBufferPool::GetMaxPooledBytes() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return MaxPooledBytes;
+}
+
+FRuntimeChunkBufferPoolStats FRuntimeChunkBufferPool::GetStats() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return Stats;
+}
+
+void FRuntimeChunkBufferPool::ResetStats()
+{
+	FScopeLock Lock(&CriticalSection);
+	Stats.Hits = 0;
+	Stats.Misses = 0;
+	Stats.Returns = 0;
+	Stats.Discards = 0;
+	Stats.PeakPooledBytes = Stats.PooledBytes;
+}
+
+void FRuntimeChunkBufferPool::Trim()
+{
+	FScopeLock Lock(&CriticalSection);
+	TrimTo_Locked(0);
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Trimmed the chunk buffer pool. Hits: %lld, Misses: %lld, Returns: %lld, Discards: %lld, Peak pooled: %lld bytes"), Stats.Hits, Stats.Misses, Stats.Returns, Stats.Discards, Stats.PeakPooledBytes);
+}
+
+int32 FRuntimeChunkBufferPool::GetAcquireSizeClassIndex(int64 Size)
+{
+	for (int32 SizeClassIndex = 0; SizeClassIndex < NumSizeClasses; ++SizeClassIndex)
+	{
+		if (Size <= GetSizeClassBytes(SizeClassIndex))
+		{
+			return SizeClassIndex;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32 FRuntimeChunkBufferPool::GetReleaseSizeClassIndex(int64 Capacity)
+{
+	for (int32 SizeClassIndex = NumSizeClasses - 1; SizeClassIndex >= 0; --SizeClassIndex)
+	{
+		if (Capacity >= GetSizeClassBytes(SizeClassIndex))
+		{
+			// Buffers much larger than their size class would waste the pool footprint, so only keep buffers of up to twice the class size
+			return Capacity < GetSizeClassBytes(SizeClassIndex) * 2 ? SizeClassIndex : INDEX_NONE;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int64 FRuntimeChunkBufferPool::GetSizeClassBytes(int32 SizeClassIndex)
+{
+	return MinSizeClass << SizeClassIndex;
+}
+
+void FRuntimeChunkBufferPool::TrimTo_Locked(int64 TargetBytes)
+{
+	for (int32 SizeClassIndex = NumSizeClasses - 1; SizeClassIndex >= 0 && Stats.PooledBytes > TargetBytes; --SizeClassIndex)
+	{
+		TArray<TArray64<uint8>>& Buffers = FreeBuffers[SizeClassIndex];
+		while (Buffers.Num() > 0 && Stats.PooledBytes > TargetBytes)
+		{
+			Stats.PooledBytes -= Buffers.Last().Max();
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+			Buffers.Pop(EAllowShrinking::No);
+#else
+			Buffers.Pop(false);
+#endif
+		}
+	}
+}
@@ -2,361 +2,1862 @@
 
 #include "RuntimeChunkDownloader.h"
 
+#include "RuntimeByteRangesParser.h"
+#include "RuntimeChunkBufferPool.h"
+#include "RuntimeMappedFileWriter.h"
 #include "FileFromStorageUploader.h"
 #include "FileToMemoryDownloader.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "RuntimeNetworkSimulator.h"
+#include "RuntimeProgressAggregator.h"
+#include "RuntimeStallMonitor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "Misc/ScopeLock.h"
+
+/**
+ * Assembles the ranges of a multi-range download into a single buffer, in the order they were requested
+ */
+struct FRuntimeRangesAssembly
+{
+	explicit FRuntimeRangesAssembly(const TArray<FInt64Vector2>& InRanges)
+		: Ranges(InRanges)
+	{
+		for (const FInt64Vector2& Range : Ranges)
+		{
+			Offsets.Add(TotalSize);
+			TotalSize += Range.Y - Range.X + 1;
+		}
+		ReceivedIntervals.SetNum(Ranges.Num());
+		ProgressBytes.SetNumZeroed(Ranges.Num());
 
-FRuntimeChunkDownloader::FRuntimeChunkDownloader()
-	: bCanceled(false)
-{}
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+		Data.SetNumUninitialized(TotalSize);
+	}
 
-FRuntimeChunkDownloader::~FRuntimeChunkDownloader()
-{
-	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("FRuntimeChunkDownloader destroyed"));
-}
+	int64 GetRangeSize(int32 Index) const
+	{
+		return Ranges[Index].Y - Ranges[Index].X + 1;
+	}
 
-TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
-{
-	if (bCanceled)
+	bool IsRangeComplete(int32 Index) const
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
-		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}}).GetFuture();
+		FScopeLock Lock(&CriticalSection);
+
+		// The intervals are merged as they are received, so a complete range is covered by a single one
+		const TArray<FInt64Vector2>& Intervals = ReceivedIntervals[Index];
+		return Intervals.Num() == 1 && Intervals[0].X <= Ranges[Index].X && Intervals[0].Y >= Ranges[Index].Y;
 	}
 
-	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
-	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
-	GetContentSize(URL, Timeout, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers](int64 ContentSize) mutable
+	/**
+	 * Forget the bytes received for a range, so that the range can be received again as a whole
+	 */
+	void ResetRange(int32 Index)
 	{
-		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-		if (!SharedThis.IsValid())
+		FScopeLock Lock(&CriticalSection);
+		ReceivedIntervals[Index].Reset();
+	}
+
+	bool IsComplete() const
+	{
+		for (int32 Index = 0; Index < Ranges.Num(); ++Index)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
-			return;
+			if (!IsRangeComplete(Index))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Copy a piece of the file into every requested range it overlaps
+	 * The same bytes may be received more than once, e.g. if the server sends overlapping parts, so the received bytes are tracked as intervals rather than counted
+	 */
+	void Write(int64 Position, const uint8* PieceData, int64 PieceSize)
+	{
+		const int64 PieceEnd = Position + PieceSize - 1;
+		for (int32 Index = 0; Index < Ranges.Num(); ++Index)
+		{
+			const int64 OverlapStart = FMath::Max(Position, Ranges[Index].X);
+			const int64 OverlapEnd = FMath::Min(PieceEnd, Ranges[Index].Y);
+			if (OverlapStart <= OverlapEnd)
+			{
+				FMemory::Memcpy(Data.GetData() + Offsets[Index] + (OverlapStart - Ranges[Index].X), PieceData + (OverlapStart - Position), OverlapEnd - OverlapStart + 1);
+				AddReceivedInterval(Index, FInt64Vector2(OverlapStart, OverlapEnd));
+			}
 		}
+	}
 
-		if (SharedThis->bCanceled)
+	/**
+	 * Set the size of the whole file, if it is reported by a response and not known yet
+	 */
+	void SetFileSize(int64 InFileSize)
+	{
+		int64 Expected = -1;
+		if (InFileSize > 0)
+		{
+			FileSize.compare_exchange_strong(Expected, InFileSize);
+		}
+	}
+
+	/**
+	 * Resolve the promise with the assembled ranges, or with the failure. Only the first call has an effect
+	 */
+	void Finish(const TSharedPtr<TPromise<FRuntimeChunkDownloaderRangesResult>>& PromisePtr, EDownloadToMemoryResult Result)
+	{
+		if (bFinished.exchange(true))
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
 			return;
 		}
 
-		auto DownloadByPayload = [SharedThis, WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, Headers]()
+		TArray<FRuntimeSharedBuffer> RangeBuffers;
+		if (Result == EDownloadToMemoryResult::Success)
 		{
-			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress](FRuntimeChunkDownloaderResult Result) mutable
+			const FRuntimeSharedBuffer Buffer = FRuntimeSharedBuffer::MakeOwned(MoveTemp(Data));
+			for (int32 Index = 0; Index < Ranges.Num(); ++Index)
 			{
-				TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-				if (!SharedThis.IsValid())
-					{
-					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-					PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
-					return;
-				}
+				RangeBuffers.Add(Buffer.Slice(Offsets[Index], GetRangeSize(Index)));
+			}
+		}
+		PromisePtr->SetValue(FRuntimeChunkDownloaderRangesResult{Result, MoveTemp(RangeBuffers)});
 
-				if (SharedThis->bCanceled)
-				{
-					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-					PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
-					return;
-				}
+		if (Reservation.IsValid())
+		{
+			Reservation->Release();
+		}
+	}
 
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{Result.Result, MoveTemp(Result.Data)});
-			});
-		};
+private:
+	/**
+	 * Add an interval of received bytes to a range, merging it with the intervals it overlaps or adjoins
+	 */
+	void AddReceivedInterval(int32 Index, FInt64Vector2 Interval)
+	{
+		FScopeLock Lock(&CriticalSection);
 
-		// -304 is used by GetContentSize to signal that the HEAD request returned a "304 Not Modified" instead of a size.
-		if (ContentSize == -304)
+		TArray<FInt64Vector2>& Intervals = ReceivedIntervals[Index];
+		TArray<FInt64Vector2> MergedIntervals;
+		MergedIntervals.Reserve(Intervals.Num() + 1);
+		bool bInserted = false;
+		for (const FInt64Vector2& Existing : Intervals)
 		{
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::NotModified, {}, {}});
-			return;
+			if (Existing.Y + 1 < Interval.X)
+			{
+				MergedIntervals.Add(Existing);
+			}
+			else if (Interval.Y + 1 < Existing.X)
+			{
+				if (!bInserted)
+				{
+					MergedIntervals.Add(Interval);
+					bInserted = true;
+				}
+				MergedIntervals.Add(Existing);
+			}
+			else
+			{
+				Interval.X = FMath::Min(Interval.X, Existing.X);
+				Interval.Y = FMath::Max(Interval.Y, Existing.Y);
+			}
 		}
-		if (ContentSize <= 0)
+		if (!bInserted)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload"), *URL);
-			DownloadByPayload();
-			return;
+			MergedIntervals.Add(Interval);
 		}
+		Intervals = MoveTemp(MergedIntervals);
+	}
 
-		if (MaxChunkSize <= 0)
+	/** The received bytes of each range, as sorted and disjoint inclusive intervals */
+	TArray<TArray<FInt64Vector2>> ReceivedIntervals;
+
+	/** Guards the received intervals, which are written to by the single-range requests from the HTTP thread */
+	mutable FCriticalSection CriticalSection;
+
+public:
+	/** The requested ranges, as inclusive byte positions */
+	TArray<FInt64Vector2> Ranges;
+
+	/** The offset of each range in the buffer */
+	TArray<int64> Offsets;
+
+	/** The number of bytes received by the single-range request of each range, for progress reporting */
+	TArray<int64> ProgressBytes;
+
+	/** The buffer holding all ranges one after another */
+	TArray64<uint8> Data;
+
+	/** The overall size of the ranges in bytes */
+	int64 TotalSize = 0;
+
+	/** The memory reserved for the buffer */
+	FRuntimeDownloadMemoryBudget::FReservationPtr Reservation;
+
+	/** The size of the whole file as reported by the server, or -1 if it is not known */
+	std::atomic<int64> FileSize{-1};
+
+	/** The number of single-range requests still in flight */
+	std::atomic<int32> NumPendingRequests{0};
+
+	std::atomic<bool> bFinished{false};
+};
+
+/**
+ * A chunk of a parallel download in flight, requested by a connection and possibly hedged by a second request
+ */
+struct FRuntimeParallelChunk
+{
+	/** The range of the chunk, as inclusive byte positions */
+	FInt64Vector2 Range;
+
+	/** The time the chunk was requested, in FPlatformTime::Seconds */
+	double StartTime = 0;
+
+	/** Cancels the original request of the chunk */
+	FRuntimeRequestCancelerPtr Canceler;
+
+	/** Cancels the hedged request of the chunk. Only valid once the chunk has been hedged */
+	FRuntimeRequestCancelerPtr HedgeCanceler;
+
+	/** The number of requests of the chunk that have not completed yet */
+	int32 NumPendingRequests = 0;
+
+	/** Whether the chunk has been written by one of its requests */
+	bool bWritten = false;
+
+	/** Whether the chunk was written by its hedged request */
+	bool bHedgeWon = false;
+};
+
+/**
+ * Downloads a range of a file over several connections, each downloading its own part of the range chunk by chunk
+ * A connection that runs out of work takes over the second half of the largest part that has not been requested yet. The part is trimmed logically, by lowering its end, so no received data is discarded and all connections stay busy until the last chunk
+ * Splitting cannot help with a chunk that is already in flight, so with hedging enabled a chunk that straggles behind its peers is requested a second time and the first of the two requests to complete is used
+ */
+struct FRuntimeParallelDownload
+{
+	/** The smallest number of bytes taken over from another connection, since smaller pieces are not worth a request of their own */
+	static constexpr int64 MinSplitSize = 64 * 1024;
+
+	/** The number of chunks each connection splits its part into at least. Only the parts that have not been requested yet can be taken over, so a part requested as a single chunk would leave nothing for idle connections to take */
+	static constexpr int32 MinChunksPerConnection = 4;
+
+	/** The part of the range assigned to a connection */
+	struct FConnection
+	{
+		/** The position of the next byte to request */
+		int64 Next = 0;
+
+		/** The position of the last byte of the part, lowered when another connection takes over the end of the part */
+		int64 End = -1;
+
+		/** The number of bytes received by the original request of the chunk in flight, for progress reporting and the straggler detection */
+		int64 InFlightBytes = 0;
+
+		/** The chunk in flight, canceled if another chunk fails */
+		TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe> Chunk;
+	};
+
+	/**
+	 * Take the next chunk of a connection, taking over the end of another part if the connection has run out of work
+	 *
+	 * @return The chunk to request, or null if there is nothing left for the connection to request
+	 */
+	TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe> TakeNextChunk(int32 ConnectionIndex)
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (bFinished)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: MaxChunkSize is <= 0. Trying to download the file by payload"), *URL);
-			DownloadByPayload();
-			return;
+			return nullptr;
 		}
 
-		TSharedPtr<TArray64<uint8>> OverallDownloadedDataPtr = MakeShared<TArray64<uint8>>();
+		FConnection& Connection = Connections[ConnectionIndex];
+		Connection.InFlightBytes = 0;
+		Connection.Chunk.Reset();
+		if (Connection.Next > Connection.End)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Pre-allocating %lld bytes for file download from %s"), ContentSize, *URL);
-			OverallDownloadedDataPtr->SetNumUninitialized(ContentSize);
+			int32 VictimIndex = INDEX_NONE;
+			int64 VictimRemaining = 0;
+			for (int32 Index = 0; Index < Connections.Num(); ++Index)
+			{
+				const int64 Remaining = Connections[Index].End - Connections[Index].Next + 1;
+				if (Remaining > VictimRemaining)
+				{
+					VictimIndex = Index;
+					VictimRemaining = Remaining;
+				}
+			}
+
+			if (VictimIndex == INDEX_NONE || VictimRemaining < 2 * MinSplitSize)
+			{
+				return nullptr;
+			}
+
+			FConnection& Victim = Connections[VictimIndex];
+			const int64 SplitPosition = Victim.Next + VictimRemaining / 2;
+			Connection.Next = SplitPosition;
+			Connection.End = Victim.End;
+			Victim.End = SplitPosition - 1;
+			++NumSplits;
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Connection %d took over range {%lld; %lld} of %s from connection %d"), ConnectionIndex, Connection.Next, Connection.End, *URL, VictimIndex);
 		}
 
-		FInt64Vector2 ChunkRange;
+		TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe> Chunk = MakeShared<FRuntimeParallelChunk, ESPMode::ThreadSafe>();
+		Chunk->Range = FInt64Vector2(Connection.Next, FMath::Min(Connection.Next + MaxChunkSize, Connection.End + 1) - 1);
+		Chunk->StartTime = FPlatformTime::Seconds();
+		Chunk->Canceler = MakeShared<FRuntimeRequestCanceler, ESPMode::ThreadSafe>();
+		Chunk->NumPendingRequests = 1;
+		Connection.Next = Chunk->Range.Y + 1;
+		Connection.Chunk = Chunk;
+		return Chunk;
+	}
+
+	/**
+	 * Find the chunks in flight that straggle behind their peers and mark them as hedged
+	 *
+	 * @return The chunks to make a hedged request for
+	 */
+	TArray<TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>> TakeStragglers()
+	{
+		FScopeLock Lock(&CriticalSection);
+		TArray<TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>> Stragglers;
+		if (bFinished)
 		{
-			ChunkRange.X = 0;
-			ChunkRange.Y = FMath::Min(MaxChunkSize, ContentSize) - 1;
+			return Stragglers;
 		}
 
-		TSharedPtr<int64> ChunkOffsetPtr = MakeShared<int64>(ChunkRange.X);
-		TSharedPtr<bool> bChunkDownloadedFilledPtr = MakeShared<bool>(false);
+		const double Now = FPlatformTime::Seconds();
+		const double LatencyThreshold = HedgingSamples.GetLatencyThreshold(HedgingSettings);
 
-		auto OnChunkDownloadedFilled = [bChunkDownloadedFilledPtr]()
+		// Only chunks that are transferring have a meaningful throughput, negative for the others
+		TArray<double> Throughputs;
+		Throughputs.Init(-1, Connections.Num());
+		for (int32 Index = 0; Index < Connections.Num(); ++Index)
 		{
-			if (bChunkDownloadedFilledPtr.IsValid())
+			const FConnection& Connection = Connections[Index];
+			if (Connection.Chunk.IsValid() && !Connection.Chunk->bWritten && Connection.InFlightBytes > 0)
 			{
-				*bChunkDownloadedFilledPtr = true;
+				const double Elapsed = Now - Connection.Chunk->StartTime;
+				if (Elapsed >= HedgingSettings.MinElapsedTime)
+				{
+					Throughputs[Index] = Connection.InFlightBytes / Elapsed;
+				}
 			}
-		};
+		}
 
-		auto OnChunkDownloaded = [WeakThisPtr, PromisePtr, URL, ContentSize, Timeout, ContentType, OnProgress, DownloadByPayload, OverallDownloadedDataPtr, bChunkDownloadedFilledPtr, ChunkOffsetPtr, OnChunkDownloadedFilled](TArray64<uint8>&& ResultData) mutable
+		for (int32 Index = 0; Index < Connections.Num() && NumActiveHedges < HedgingSettings.MaxActiveHedges; ++Index)
 		{
-			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-			if (!SharedThis.IsValid())
+			const TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>& Chunk = Connections[Index].Chunk;
+			if (!Chunk.IsValid() || Chunk->bWritten || Chunk->HedgeCanceler.IsValid())
 			{
-				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
-				OnChunkDownloadedFilled();
-				return;
+				continue;
 			}
 
-			if (SharedThis->bCanceled)
+			const double Elapsed = Now - Chunk->StartTime;
+			if (Elapsed < HedgingSettings.MinElapsedTime)
 			{
-				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
-				OnChunkDownloadedFilled();
-				return;
+				continue;
 			}
 
-			// Calculate the currently size of the downloaded content in the result buffer
-			const int64 CurrentlyDownloadedSize = *ChunkOffsetPtr + ResultData.Num();
-
-			// Check if some values are out of range
+			bool bStraggling = Elapsed > LatencyThreshold;
+			if (!bStraggling && Throughputs[Index] >= 0)
 			{
-				if (*ChunkOffsetPtr < 0 || *ChunkOffsetPtr >= OverallDownloadedDataPtr->Num())
+				TArray<double> PeerThroughputs;
+				for (int32 PeerIndex = 0; PeerIndex < Throughputs.Num(); ++PeerIndex)
 				{
-					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: data offset is out of range (%lld, expected [0, %lld]). Trying to download the file by payload"), *URL, *ChunkOffsetPtr, OverallDownloadedDataPtr->Num());
-					DownloadByPayload();
-					OnChunkDownloadedFilled();
-					return;
+					if (PeerIndex != Index && Throughputs[PeerIndex] >= 0)
+					{
+						PeerThroughputs.Add(Throughputs[PeerIndex]);
+					}
 				}
+				bStraggling = HedgingSamples.IsThroughputStraggling(HedgingSettings, Throughputs[Index], MoveTemp(PeerThroughputs));
+			}
+
+			if (bStraggling)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Hedging straggling file chunk {%lld; %lld} of %s: %lld bytes received in %.2f seconds"), Chunk->Range.X, Chunk->Range.Y, *URL, Connections[Index].InFlightBytes, Elapsed);
+				Chunk->HedgeCanceler = MakeShared<FRuntimeRequestCanceler, ESPMode::ThreadSafe>();
+				++Chunk->NumPendingRequests;
+				++NumActiveHedges;
+				++NumHedges;
+				HedgedChunks.Add(Chunk);
+				Stragglers.Add(Chunk);
+			}
+		}
+		return Stragglers;
+	}
+
+	/**
+	 * Write a chunk received by one of its requests. The bytes of a chunk that has already been written by its other request are dropped
+	 *
+	 * @return False if the download has finished or the chunk could not be written
+	 */
+	bool WriteChunk(const TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>& Chunk, bool bHedge, const uint8* Data, int64 Size)
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (bFinished)
+		{
+			return false;
+		}
+		if (Chunk->bWritten)
+		{
+			return true;
+		}
+		if (!ContentWriter(Chunk->Range.X, Data, Size))
+		{
+			return false;
+		}
+
+		Chunk->bWritten = true;
+		Chunk->bHedgeWon = bHedge;
+		CompletedBytes += Size;
+		HedgingSamples.Add(FPlatformTime::Seconds() - Chunk->StartTime, Size);
+		for (FConnection& Connection : Connections)
+		{
+			if (Connection.Chunk == Chunk)
+			{
+				Connection.InFlightBytes = 0;
+			}
+		}
+		return true;
+	}
+
+	bool IsFinished() const
+	{
+		FScopeLock Lock(&CriticalSection);
+		return bFinished;
+	}
+
+	/**
+	 * Get the overall progress within the file
+	 */
+	int64 GetBytesReceived() const
+	{
+		FScopeLock Lock(&CriticalSection);
+		int64 BytesReceived = Range.X + CompletedBytes;
+		for (const FConnection& Connection : Connections)
+		{
+			BytesReceived += Connection.InFlightBytes;
+		}
+		return BytesReceived;
+	}
 
-				if (CurrentlyDownloadedSize > OverallDownloadedDataPtr->Num())
+	/**
+	 * Resolve the promise with the result and cancel the chunk requests still in flight. Only the first call has an effect
+	 */
+	void Finish(EDownloadToMemoryResult Result)
+	{
+		TArray<FRuntimeRequestCancelerPtr> Cancelers;
+		TArray<FString> FinalResponseHeaders;
+		{
+			FScopeLock Lock(&CriticalSection);
+			if (bFinished)
+			{
+				return;
+			}
+			bFinished = true;
+			FinalResponseHeaders = MoveTemp(ResponseHeaders);
+			for (const FConnection& Connection : Connections)
+			{
+				if (Connection.Chunk.IsValid())
 				{
-					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: overall downloaded size is out of range (%lld, expected [0, %lld]). Trying to download the file by payload"), *URL, CurrentlyDownloadedSize, OverallDownloadedDataPtr->Num());
-					DownloadByPayload();
-					OnChunkDownloadedFilled();
-					return;
+					Cancelers.Add(Connection.Chunk->Canceler);
+					Cancelers.Add(Connection.Chunk->HedgeCanceler);
 				}
 			}
 
-			// Append the downloaded chunk to the result data
-			FMemory::Memcpy(OverallDownloadedDataPtr->GetData() + *ChunkOffsetPtr, ResultData.GetData(), ResultData.Num());
+			// A hedged chunk may outlive the original request of its connection
+			for (const TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>& Chunk : HedgedChunks)
+			{
+				Cancelers.Add(Chunk->Canceler);
+				Cancelers.Add(Chunk->HedgeCanceler);
+			}
+		}
 
-			// If the download is complete, return the result data
-			if (*ChunkOffsetPtr + ResultData.Num() >= ContentSize)
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Finished downloading range {%lld; %lld} of %s over %d connections with %d splits and %d hedged chunks: %s"), Range.X, Range.Y, *URL, Connections.Num(), NumSplits, NumHedges, *UEnum::GetValueAsString(Result));
+		if (Result != EDownloadToMemoryResult::Success)
+		{
+			for (const FRuntimeRequestCancelerPtr& Canceler : Cancelers)
 			{
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(*OverallDownloadedDataPtr.Get())});
-				OnChunkDownloadedFilled();
-				return;
+				if (Canceler.IsValid())
+				{
+					Canceler->Cancel();
+				}
 			}
+		}
+		Promise.SetValue(FRuntimeChunkDownloaderResult{Result, {}, MoveTemp(FinalResponseHeaders)});
+	}
 
-			// Increase the offset by the size of the downloaded chunk
-			*ChunkOffsetPtr += ResultData.Num();
-		};
+	/**
+	 * Keep the headers of a chunk response that has been written, unless those of an earlier one are already kept
+	 */
+	void SetResponseHeaders(TArray<FString>&& InResponseHeaders)
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (!bFinished && ResponseHeaders.Num() == 0)
+		{
+			ResponseHeaders = MoveTemp(InResponseHeaders);
+		}
+	}
 
-		SharedThis->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, ChunkRange, OnProgress, OnChunkDownloaded, Headers).Next([PromisePtr, bChunkDownloadedFilledPtr, URL, OverallDownloadedDataPtr, OnChunkDownloadedFilled, DownloadByPayload](EDownloadToMemoryResult Result) mutable
+	FString URL;
+	float Timeout = 0;
+	FString ContentType;
+	int64 ContentSize = 0;
+	int64 MaxChunkSize = 0;
+	TFunction<void(int64, int64)> OnProgress;
+	TMap<FString, FString> Headers;
+
+	/** The range to download, as inclusive byte positions */
+	FInt64Vector2 Range;
+
+	/** Writes the chunks at their offset within the file. Only called under the critical section, and once per chunk */
+	FRuntimeChunkContentWriter ContentWriter;
+
+	/** The parts of the range assigned to each connection */
+	TArray<FConnection> Connections;
+
+	/** The number of bytes of the range received so far */
+	int64 CompletedBytes = 0;
+
+	/** The number of times a connection took over the end of another part */
+	int32 NumSplits = 0;
+
+	/** The hedging settings, fixed when the download is started */
+	FRuntimeHedgingSettings HedgingSettings;
+
+	/** The recently completed chunks, for the straggler detection */
+	FRuntimeHedgingSamples HedgingSamples;
+
+	/** The hedged chunks whose hedged request is in flight */
+	TArray<TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>> HedgedChunks;
+
+	/** The number of hedged requests in flight */
+	int32 NumActiveHedges = 0;
+
+	/** The number of chunks hedged so far */
+	int32 NumHedges = 0;
+
+	bool bFinished = false;
+
+	/** The headers of the first chunk response that was written, resolved along with the result */
+	TArray<FString> ResponseHeaders;
+
+	TPromise<FRuntimeChunkDownloaderResult> Promise;
+
+	mutable FCriticalSection CriticalSection;
+};
+
+/**
+ * State of a download delivering a file chunk by chunk, shared by all of its chunk requests
+ * The file is described and the callbacks are stored once, and the chunks are requested one after another from this state, so the cost of a chunk does not depend on the number of chunks before it
+ */
+struct FRuntimePerChunkDownload
+{
+	FString URL;
+	float Timeout = 0;
+	FString ContentType;
+	int64 ContentSize = 0;
+	int64 MaxChunkSize = 0;
+	TFunction<void(int64, int64)> OnProgress;
+	TFunction<void(TArray64<uint8>&&)> OnChunkDownloaded;
+	TMap<FString, FString> Headers;
+
+	/** Reports the progress of the chunk in flight within the file. Created once and passed to every chunk request */
+	TFunction<void(int64, int64)> OnChunkProgress;
+
+	/** The range of the chunk in flight, as inclusive byte positions */
+	FInt64Vector2 ChunkRange;
+
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr;
+};
+
+namespace RuntimeChunkDownloader
+{
+	FCriticalSection& GetDefaultSettingsCriticalSection()
+	{
+		static FCriticalSection CriticalSection;
+		return CriticalSection;
+	}
+
+	FRuntimeLowSpeedLimit& GetDefaultLowSpeedLimit()
+	{
+		static FRuntimeLowSpeedLimit LowSpeedLimit;
+		return LowSpeedLimit;
+	}
+
+	FRuntimeHedgingSettings& GetDefaultHedgingSettings()
+	{
+		static FRuntimeHedgingSettings HedgingSettings;
+		return HedgingSettings;
+	}
+
+	/** Get the directory containing the spill directories of all processes */
+	FString GetSpillRootDirectory()
+	{
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RuntimeFilesDownloader"), TEXT("Spill"));
+	}
+}
+
+std::atomic<bool> FRuntimeChunkDownloader::bFastStartByDefault{false};
+std::atomic<int32> FRuntimeChunkDownloader::MaxConnectionsByDefault{1};
+
+FRuntimeChunkDownloader::FRuntimeChunkDownloader()
+	: TelemetryRecorder(MakeShared<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>())
+	, bFastStart(bFastStartByDefault)
+	, MaxConnections(MaxConnectionsByDefault)
+	, bCanceled(false)
+{
+	FScopeLock Lock(&RuntimeChunkDownloader::GetDefaultSettingsCriticalSection());
+	LowSpeedLimit = RuntimeChunkDownloader::GetDefaultLowSpeedLimit();
+	HedgingSettings = RuntimeChunkDownloader::GetDefaultHedgingSettings();
+}
+
+FRuntimeChunkDownloader::~FRuntimeChunkDownloader()
+{
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("FRuntimeChunkDownloader destroyed"));
+}
+
+bool FRuntimeChunkDownloader::TryResetForReuse()
+{
+	FScopeLock Lock(&ActiveRequestsCriticalSection);
+	for (const auto& ActiveHttpRequest : ActiveHttpRequests)
+	{
+		if (ActiveHttpRequest.IsValid())
+		{
+			return false;
+		}
+	}
+
+	ActiveHttpRequests.Empty();
+	ActiveStreams.Empty();
+	HttpRequestPtr.Reset();
+	NumStartedRequests = 0;
+
+	// The global statistics may still hold the previous recorder, so the next download gets its own
+	TelemetryRecorder = MakeShared<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>();
+	bFastStart = bFastStartByDefault;
+	MaxConnections = MaxConnectionsByDefault;
+	bCanceled = false;
+
+	FScopeLock LowSpeedLimitLock(&RuntimeChunkDownloader::GetDefaultSettingsCriticalSection());
+	LowSpeedLimit = RuntimeChunkDownloader::GetDefaultLowSpeedLimit();
+	HedgingSettings = RuntimeChunkDownloader::GetDefaultHedgingSettings();
+	return true;
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFile);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}}).GetFuture();
+	}
+
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	if (!bFastStart || MaxChunkSize <= 0)
+	{
+		DownloadFileWithHead(PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers);
+		return PromisePtr->GetFuture();
+	}
+
+	// The first chunk is requested right away and the size of the file is taken from its Content-Range, which saves the round trip of the HEAD request
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	DownloadFirstChunk(URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers](FRuntimeChunkDownloaderFirstChunkResult&& FirstChunk) mutable
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
+			return;
+		}
+
+		if (FirstChunk.Result == EDownloadToMemoryResult::NotModified)
+		{
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::NotModified, {}, MoveTemp(FirstChunk.Headers)});
+			return;
+		}
+
+		if (FirstChunk.Result != EDownloadToMemoryResult::Success)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to start the download from %s with a range request. Getting the content size with a HEAD request"), *URL);
+			SharedThis->DownloadFileWithHead(PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers);
+			return;
+		}
+
+		// Small files, and servers without range support, deliver the whole file with the first response
+		if (FirstChunk.Data.Num() >= FirstChunk.ContentSize)
+		{
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(FirstChunk.Data), MoveTemp(FirstChunk.Headers)});
+			return;
+		}
+
+		SharedThis->DownloadFileOfSize(PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers, FirstChunk.ContentSize, MoveTemp(FirstChunk.Data));
+	});
+	return PromisePtr->GetFuture();
+}
+
+void FRuntimeChunkDownloader::DownloadFileWithHead(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	GetContentSize(URL, Timeout, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers](int64 ContentSize) mutable
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
+			return;
+		}
+
+		SharedThis->DownloadFileOfSize(PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers, ContentSize, {});
+	});
+}
+
+void FRuntimeChunkDownloader::DownloadFileOfSize(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers, int64 ContentSize, TArray64<uint8>&& FirstChunkData)
+{
+	TSharedPtr<FRuntimeChunkDownloader> SharedThis = AsShared();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = SharedThis;
+
+	auto DownloadByPayload = [SharedThis, WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, Headers]()
+	{
+		SharedThis->TelemetryRecorder->RecordPayloadFallback();
+		SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress](FRuntimeChunkDownloaderResult Result) mutable
+		{
+			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+				return;
+			}
+
+			if (SharedThis->bCanceled)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
+				return;
+			}
+
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{Result.Result, MoveTemp(Result.Data), MoveTemp(Result.Headers)});
+		});
+	};
+
+	// -304 is used by GetContentSize to signal that the HEAD request returned a "304 Not Modified" instead of a size.
+	if (ContentSize == -304)
+	{
+		PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::NotModified, {}, {}});
+		return;
+	}
+	if (ContentSize <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload"), *URL);
+		DownloadByPayload();
+		return;
+	}
+
+	if (MaxChunkSize <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: MaxChunkSize is <= 0. Trying to download the file by payload"), *URL);
+		DownloadByPayload();
+		return;
+	}
+
+	if (FirstChunkData.Num() >= ContentSize)
+	{
+		FirstChunkData.SetNum(ContentSize);
+		PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(FirstChunkData)});
+		return;
+	}
+	TSharedPtr<TArray64<uint8>> FirstChunkDataPtr = MakeShared<TArray64<uint8>>(MoveTemp(FirstChunkData));
+
+	// The whole-file buffer and the responses of the chunk requests in flight are reserved from the download memory budget. The chunks are written straight into the buffer, so their requests are not reserved again
+	const int64 ReservationSize = ContentSize + FMath::Min(MaxChunkSize, FMath::DivideAndRoundUp(ContentSize, static_cast<int64>(MaxConnections))) * MaxConnections;
+	FRuntimeDownloadMemoryBudget::Get().Reserve(ReservationSize, SharedThis->TelemetryRecorder, [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers, ContentSize, FirstChunkDataPtr, DownloadByPayload](const FRuntimeDownloadMemoryBudget::FReservationPtr& Reservation) mutable
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
+			return;
+		}
+
+		TSharedPtr<TArray64<uint8>> OverallDownloadedDataPtr = MakeShared<TArray64<uint8>>();
+		{
+			RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Pre-allocating %lld bytes for file download from %s"), ContentSize, *URL);
+			OverallDownloadedDataPtr->SetNumUninitialized(ContentSize);
+		}
+		TSharedPtr<FRuntimeBufferedBytesTrace> BufferedBytesTracePtr = MakeShared<FRuntimeBufferedBytesTrace>();
+
+		// The first chunk may have been received along with the size of the file, in which case the download continues after it
+		const int64 FirstChunkSize = FirstChunkDataPtr->Num();
+		if (FirstChunkSize > 0)
+		{
+			FMemory::Memcpy(OverallDownloadedDataPtr->GetData(), FirstChunkDataPtr->GetData(), FirstChunkSize);
+			FirstChunkDataPtr->Empty();
+		}
+
+		// The rest of the file is written straight into the buffer over the connections of this downloader, a single one downloading it chunk by chunk. The size is already known, so no further HEAD request is made
+		auto WriteChunk = [OverallDownloadedDataPtr, BufferedBytesTracePtr](int64 Offset, const uint8* Data, int64 Size)
+		{
+			FMemory::Memcpy(OverallDownloadedDataPtr->GetData() + Offset, Data, Size);
+			BufferedBytesTracePtr->Add(Size);
+			return true;
+		};
+
+		SharedThis->DownloadRangeParallel(URL, Timeout, ContentType, ContentSize, MaxChunkSize, FInt64Vector2(FirstChunkSize, ContentSize - 1), SharedThis->MaxConnections, WriteChunk, OnProgress, Headers).Next([PromisePtr, Reservation, URL, OverallDownloadedDataPtr, BufferedBytesTracePtr, DownloadByPayload](FRuntimeChunkDownloaderResult&& Result) mutable
+		{
+			BufferedBytesTracePtr->Reset();
+			if (Result.Result == EDownloadToMemoryResult::Success)
+			{
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(*OverallDownloadedDataPtr.Get()), MoveTemp(Result.Headers)});
+			}
+			else if (Result.Result == EDownloadToMemoryResult::Cancelled)
+			{
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
+			}
+			else
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: %s. Trying to download the file by payload"), *URL, *UEnum::GetValueAsString(Result.Result));
+				OverallDownloadedDataPtr->Empty();
+				DownloadByPayload();
+			}
+			Reservation->Release();
+		});
+	});
+}
+
+TFuture<FRuntimeChunkDownloaderSharedResult> FRuntimeChunkDownloader::DownloadFileShared(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, bool bForceByPayload, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	TFuture<FRuntimeChunkDownloaderResult> ResultFuture = bForceByPayload ? DownloadFileByPayload(URL, Timeout, ContentType, OnProgress, Headers) : DownloadFile(URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers);
+
+	// Ownership of the downloaded data is transferred into the shared buffer, so no further copies are made from here on
+	return ResultFuture.Next([](FRuntimeChunkDownloaderResult&& Result)
+	{
+		return FRuntimeChunkDownloaderSharedResult{Result.Result, FRuntimeSharedBuffer::MakeOwned(MoveTemp(Result.Data)), MoveTemp(Result.Headers)};
+	});
+}
+
+TFuture<FRuntimeChunkDownloaderSharedResult> FRuntimeChunkDownloader::DownloadFileHybrid(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 SpillThreshold, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderSharedResult>(FRuntimeChunkDownloaderSharedResult{EDownloadToMemoryResult::Cancelled, {}, {}}).GetFuture();
+	}
+
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderSharedResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderSharedResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	GetContentSize(URL, Timeout, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, SpillThreshold, OnProgress, Headers](int64 ContentSize)
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{EDownloadToMemoryResult::Cancelled, {}, {}});
+			return;
+		}
+
+		if (ContentSize == -304)
+		{
+			PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{EDownloadToMemoryResult::NotModified, {}, {}});
+			return;
+		}
+
+		// Small files, and files of unknown size, are downloaded into memory as usual, continuing from the size that is already known
+		if (ContentSize <= SpillThreshold || MaxChunkSize <= 0)
+		{
+			TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> InMemoryPromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+			InMemoryPromisePtr->GetFuture().Next([PromisePtr](FRuntimeChunkDownloaderResult&& Result)
+			{
+				PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{Result.Result, FRuntimeSharedBuffer::MakeOwned(MoveTemp(Result.Data)), MoveTemp(Result.Headers)});
+			});
+			SharedThis->DownloadFileOfSize(InMemoryPromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, Headers, ContentSize, {});
+			return;
+		}
+
+		const FString SpillFilePath = FPaths::Combine(GetSpillDirectory(), FGuid::NewGuid().ToString() + TEXT(".tmp"));
+		IFileManager::Get().MakeDirectory(*GetSpillDirectory(), true);
+
+		TUniquePtr<FRuntimeMappedFileWriter> FileWriter = FRuntimeMappedFileWriter::Create(SpillFilePath, ContentSize);
+		if (!FileWriter.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: unable to create a temporary file of %lld bytes to spill the data to"), *URL, ContentSize);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+			return;
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Content size of %s (%lld bytes) exceeds the spill threshold (%lld bytes), storing the data in '%s'"), *URL, ContentSize, SpillThreshold, *SpillFilePath);
+
+		TSharedPtr<FRuntimeMappedFileWriter, ESPMode::ThreadSafe> FileWriterPtr = MakeShareable(FileWriter.Release());
+		TSharedRef<std::atomic<int64>, ESPMode::ThreadSafe> WrittenSizePtr = MakeShared<std::atomic<int64>, ESPMode::ThreadSafe>(0);
+
+		// The chunks are written at their offset straight from the HTTP responses, without another request for the size
+		auto WriteChunk = [FileWriterPtr, WrittenSizePtr](int64 Offset, const uint8* Data, int64 Size)
+		{
+			if (!FileWriterPtr->Write(Offset, Data, Size))
+			{
+				return false;
+			}
+			*WrittenSizePtr += Size;
+			return true;
+		};
+
+		SharedThis->DownloadFileInto(URL, Timeout, ContentType, ContentSize, MaxChunkSize, SharedThis->MaxConnections, OnProgress, WriteChunk, Headers).Next([PromisePtr, URL, FileWriterPtr, WrittenSizePtr](FRuntimeChunkDownloaderResult&& IntoResult)
+		{
+			const EDownloadToMemoryResult Result = IntoResult.Result;
+			const int64 WrittenSize = *WrittenSizePtr;
+			if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
+			{
+				FileWriterPtr->Abort();
+				PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{Result, {}, MoveTemp(IntoResult.Headers)});
+				return;
+			}
+
+			if (WrittenSize != FileWriterPtr->GetFileSize() || !FileWriterPtr->Finalize())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: unable to write the data to the temporary file '%s' (written %lld of %lld bytes)"), *URL, *FileWriterPtr->GetFilePath(), WrittenSize, FileWriterPtr->GetFileSize());
+				FileWriterPtr->Abort();
+				PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+				return;
+			}
+
+			// The temporary file is deleted once the last reference to the buffer is released
+			FRuntimeSharedBuffer MappedBuffer = FRuntimeSharedBuffer::MakeMappedFile(FileWriterPtr->GetFilePath(), true);
+			if (MappedBuffer.IsEmpty())
+			{
+				FileWriterPtr->Abort();
+				PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+				return;
+			}
+
+			// The same result as the in-memory branch, the data only lives in a file instead
+			PromisePtr->SetValue(FRuntimeChunkDownloaderSharedResult{Result, MoveTemp(MappedBuffer), MoveTemp(IntoResult.Headers)});
+		});
+	});
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeChunkDownloaderSegmentedResult> FRuntimeChunkDownloader::DownloadFileSegmented(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	TSharedPtr<FRuntimeSegmentedBuffer> SegmentedBufferPtr = MakeShared<FRuntimeSegmentedBuffer>();
+
+	// The segments outlive the download, so a pooled buffer rounded up to its size class is only kept if it has no slack. Otherwise the chunk is copied into an exact-size segment and the buffer is returned to the pool
+	auto OnChunkDownloaded = [SegmentedBufferPtr](TArray64<uint8>&& ChunkData)
+	{
+		if (ChunkData.GetSlack() == 0)
+		{
+			SegmentedBufferPtr->AppendSegment(MoveTemp(ChunkData));
+			return;
+		}
+
+		TArray64<uint8> SegmentData;
+		SegmentData.Append(ChunkData.GetData(), ChunkData.Num());
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(ChunkData));
+		SegmentedBufferPtr->AppendSegment(MoveTemp(SegmentData));
+	};
+
+	return DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, FInt64Vector2(), OnProgress, OnChunkDownloaded, Headers).Next([SegmentedBufferPtr, URL](EDownloadToMemoryResult Result)
+	{
+		if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
+		{
+			return FRuntimeChunkDownloaderSegmentedResult{Result, {}};
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %lld bytes from %s into %d segments"), SegmentedBufferPtr->Num(), *URL, SegmentedBufferPtr->GetNumSegments());
+		return FRuntimeChunkDownloaderSegmentedResult{Result, MoveTemp(*SegmentedBufferPtr)};
+	});
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress, const TFunction<void(TArray64<uint8>&&)>& OnChunkDownloaded, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFilePerChunk);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
+	}
+
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	GetContentSize(URL, Timeout, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, OnChunkDownloaded, ChunkRange, Headers](int64 ContentSize) mutable
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+		
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			return;
+		}
+
+		if (ContentSize == -304)
+		{
+			PromisePtr->SetValue(EDownloadToMemoryResult::NotModified);
+			return;
+		}
+
+		if (ContentSize <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload"), *URL);
+			SharedThis->TelemetryRecorder->RecordPayloadFallback();
+			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnChunkDownloaded, OnProgress](FRuntimeChunkDownloaderResult Result) mutable
+			{
+				TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+				if (!SharedThis.IsValid())
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+					PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+					return;
+				}
+
+				if (SharedThis->bCanceled)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
+					PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+					return;
+				}
+
+				if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: %s"), *URL, *UEnum::GetValueAsString(Result.Result));
+					PromisePtr->SetValue(Result.Result);
+					return;
+				}
+
+				if (Result.Data.Num() <= 0)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: downloaded content is empty"), *URL);
+					PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+					return;
+				}
+
+				PromisePtr->SetValue(Result.Result);
+				{
+					RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::OnChunkDownloaded);
+					OnChunkDownloaded(MoveTemp(Result.Data));
+				}
+			});
+			return;
+		}
+
+		if (MaxChunkSize <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: max chunk size is <= 0"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+		SharedThis->TelemetryRecorder->RecordChunkSize(MaxChunkSize);
+
+		// If the chunk range is not specified, determine the range based on the max chunk size and the content size
+		if (ChunkRange.X == 0 && ChunkRange.Y == 0)
+		{
+			ChunkRange.Y = FMath::Min(MaxChunkSize, ContentSize) - 1;
+		}
+
+		if (ChunkRange.Y > ContentSize)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: chunk range is out of range (%lld, expected [0, %lld])"), *URL, ChunkRange.Y, ContentSize);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		TSharedPtr<FRuntimePerChunkDownload, ESPMode::ThreadSafe> Download = MakeShared<FRuntimePerChunkDownload, ESPMode::ThreadSafe>();
+		Download->URL = URL;
+		Download->Timeout = Timeout;
+		Download->ContentType = ContentType;
+		Download->ContentSize = ContentSize;
+		Download->MaxChunkSize = MaxChunkSize;
+		Download->OnProgress = MoveTemp(OnProgress);
+		Download->OnChunkDownloaded = MoveTemp(OnChunkDownloaded);
+		Download->Headers = MoveTemp(Headers);
+		Download->ChunkRange = ChunkRange;
+		Download->PromisePtr = PromisePtr;
+
+		// The state is referenced weakly, since it owns the function
+		TWeakPtr<FRuntimePerChunkDownload, ESPMode::ThreadSafe> WeakDownloadPtr = Download;
+		Download->OnChunkProgress = [WeakDownloadPtr](int64 BytesReceived, int64 ContentSize)
+		{
+			if (TSharedPtr<FRuntimePerChunkDownload, ESPMode::ThreadSafe> DownloadPtr = WeakDownloadPtr.Pin())
+			{
+				DownloadPtr->OnProgress(BytesReceived + DownloadPtr->ChunkRange.X, ContentSize);
+			}
+		};
+
+		SharedThis->RequestPerChunk(Download);
+	});
+
+	return PromisePtr->GetFuture();
+}
+
+void FRuntimeChunkDownloader::RequestPerChunk(const TSharedPtr<FRuntimePerChunkDownload, ESPMode::ThreadSafe>& Download)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::RequestPerChunk);
+
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	DownloadFileByChunk(Download->URL, Download->Timeout, Download->ContentType, Download->ContentSize, Download->ChunkRange, Download->OnChunkProgress, nullptr, nullptr, Download->Headers).Next([WeakThisPtr, Download](FRuntimeChunkDownloaderResult&& Result)
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *Download->URL);
+			Download->PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *Download->URL);
+			Download->PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			return;
+		}
+
+		if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: %s"), *Download->URL, *UEnum::GetValueAsString(Result.Result));
+			Download->PromisePtr->SetValue(Result.Result);
+			return;
+		}
+
+		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::OnChunkDownloaded);
+			Download->OnChunkDownloaded(MoveTemp(Result.Data));
+		}
+
+		// Check if the download is complete
+		if (Download->ContentSize <= Download->ChunkRange.Y + 1)
+		{
+			Download->PromisePtr->SetValue(EDownloadToMemoryResult::Success);
+			return;
+		}
+
+		const int64 ChunkStart = Download->ChunkRange.Y + 1;
+		Download->ChunkRange = FInt64Vector2(ChunkStart, FMath::Min(ChunkStart + Download->MaxChunkSize, Download->ContentSize) - 1);
+		SharedThis->RequestPerChunk(Download);
+	});
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileInto(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, int64 MaxChunkSize, int32 NumConnections, const TFunction<void(int64, int64)>& OnProgress, const FRuntimeChunkContentWriter& ContentWriter, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFileInto);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}}).GetFuture();
+	}
+
+	if (ContentSize <= 0 || MaxChunkSize <= 0 || !ContentWriter)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: invalid content size (%lld), max chunk size (%lld) or content writer"), *URL, ContentSize, MaxChunkSize);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
+	}
+
+	// The memory written to belongs to the owner of the writer, so only the responses of the chunk requests in flight are reserved
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	const int64 ReservationSize = FMath::Min(MaxChunkSize, FMath::DivideAndRoundUp(ContentSize, static_cast<int64>(FMath::Max(NumConnections, 1)))) * FMath::Max(NumConnections, 1);
+	FRuntimeDownloadMemoryBudget::Get().Reserve(ReservationSize, TelemetryRecorder, [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, MaxChunkSize, NumConnections, OnProgress, ContentWriter, Headers](const FRuntimeDownloadMemoryBudget::FReservationPtr& Reservation)
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+			return;
+		}
+
+		SharedThis->DownloadRangeParallel(URL, Timeout, ContentType, ContentSize, MaxChunkSize, FInt64Vector2(0, ContentSize - 1), NumConnections, ContentWriter, OnProgress, Headers).Next([PromisePtr, Reservation](FRuntimeChunkDownloaderResult&& Result)
+		{
+			Reservation->Release();
+			PromisePtr->SetValue(MoveTemp(Result));
+		});
+	});
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadRangeParallel(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, int64 MaxChunkSize, FInt64Vector2 Range, int32 NumConnections, const FRuntimeChunkContentWriter& ContentWriter, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadRangeParallel);
+
+	TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe> Download = MakeShared<FRuntimeParallelDownload, ESPMode::ThreadSafe>();
+	Download->URL = URL;
+	Download->Timeout = Timeout;
+	Download->ContentType = ContentType;
+	Download->ContentSize = ContentSize;
+	Download->OnProgress = OnProgress;
+	Download->Headers = Headers;
+	Download->Range = Range;
+	Download->ContentWriter = ContentWriter;
+	Download->HedgingSettings = HedgingSettings;
+
+	// The range is split evenly up front, the connections then rebalance the remaining work between themselves as they finish their parts
+	const int64 RangeSize = Range.Y - Range.X + 1;
+	NumConnections = static_cast<int32>(FMath::Clamp<int64>(NumConnections, 1, FMath::DivideAndRoundUp(RangeSize, FMath::Min(MaxChunkSize, FRuntimeParallelDownload::MinSplitSize))));
+
+	// Whole-file downloads pass the largest possible chunk size, which would have every connection request its part at once
+	if (NumConnections > 1)
+	{
+		MaxChunkSize = FMath::Min(MaxChunkSize, FMath::Max(FMath::DivideAndRoundUp(RangeSize, static_cast<int64>(NumConnections) * FRuntimeParallelDownload::MinChunksPerConnection), FRuntimeParallelDownload::MinSplitSize));
+	}
+	Download->MaxChunkSize = MaxChunkSize;
+
+	for (int32 ConnectionIndex = 0; ConnectionIndex < NumConnections; ++ConnectionIndex)
+	{
+		FRuntimeParallelDownload::FConnection& Connection = Download->Connections.AddDefaulted_GetRef();
+		Connection.Next = Range.X + RangeSize * ConnectionIndex / NumConnections;
+		Connection.End = Range.X + RangeSize * (ConnectionIndex + 1) / NumConnections - 1;
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloading range {%lld; %lld} of %s over %d connections"), Range.X, Range.Y, *URL, NumConnections);
+	TelemetryRecorder->RecordChunkSize(MaxChunkSize);
+
+	TFuture<FRuntimeChunkDownloaderResult> Future = Download->Promise.GetFuture();
+	for (int32 ConnectionIndex = 0; ConnectionIndex < NumConnections; ++ConnectionIndex)
+	{
+		RequestParallelChunk(Download, ConnectionIndex);
+	}
+
+	// Stragglers are looked for periodically, since a stalled request does not report any progress that could trigger the check
+	if (Download->HedgingSettings.bEnabled && !Download->IsFinished())
+	{
+		TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+		TWeakPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe> WeakDownloadPtr = Download;
+		auto TickerFunction = [WeakThisPtr, WeakDownloadPtr](float DeltaTime)
+		{
+			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+			TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe> DownloadPtr = WeakDownloadPtr.Pin();
+			return SharedThis.IsValid() && DownloadPtr.IsValid() && SharedThis->HedgeParallelStragglers(DownloadPtr);
+		};
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Download->HedgingSettings.CheckInterval);
+#else
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Download->HedgingSettings.CheckInterval);
+#endif
+	}
+	return Future;
+}
+
+void FRuntimeChunkDownloader::RequestParallelChunk(const TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe>& Download, int32 ConnectionIndex)
+{
+	const TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe> Chunk = Download->TakeNextChunk(ConnectionIndex);
+	if (Chunk.IsValid())
+	{
+		RequestParallelChunkRange(Download, Chunk, ConnectionIndex);
+	}
+}
+
+void FRuntimeChunkDownloader::RequestParallelChunkRange(const TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe>& Download, const TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>& Chunk, int32 ConnectionIndex)
+{
+	const bool bHedge = ConnectionIndex == INDEX_NONE;
+
+	// The hedged request does not report progress, so that the bytes of the chunk are not counted twice
+	TFunction<void(int64, int64)> OnChunkProgress = [](int64, int64) {};
+	if (!bHedge)
+	{
+		OnChunkProgress = [Download, Chunk, ConnectionIndex](int64 BytesReceived, int64 ContentSize)
+		{
+			{
+				FScopeLock Lock(&Download->CriticalSection);
+				if (Download->Connections[ConnectionIndex].Chunk == Chunk)
+				{
+					Download->Connections[ConnectionIndex].InFlightBytes = BytesReceived;
+				}
+			}
+			Download->OnProgress(Download->GetBytesReceived(), Download->ContentSize);
+		};
+	}
+
+	// The chunk is written straight from the HTTP response. The destination is handed over once the download has finished, so late chunks of a failed download are dropped
+	auto WriteChunk = [Download, Chunk, bHedge](int64 Offset, const uint8* Data, int64 Size)
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::AssembleParallelChunk);
+		return Download->WriteChunk(Chunk, bHedge, Data, Size);
+	};
+
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	const FRuntimeRequestCancelerPtr& Canceler = bHedge ? Chunk->HedgeCanceler : Chunk->Canceler;
+	DownloadFileByChunk(Download->URL, Download->Timeout, Download->ContentType, Download->ContentSize, Chunk->Range, OnChunkProgress, Canceler, WriteChunk, Download->Headers).Next([WeakThisPtr, Download, Chunk, ConnectionIndex, bHedge](FRuntimeChunkDownloaderResult&& Result)
+	{
+		bool bWritten, bOtherPending;
+		FRuntimeRequestCancelerPtr LoserCanceler;
+		{
+			FScopeLock Lock(&Download->CriticalSection);
+			--Chunk->NumPendingRequests;
+			if (bHedge)
+			{
+				--Download->NumActiveHedges;
+				Download->HedgedChunks.Remove(Chunk);
+			}
+			bWritten = Chunk->bWritten;
+			bOtherPending = Chunk->NumPendingRequests > 0;
+			if (bWritten && bOtherPending)
+			{
+				LoserCanceler = bHedge ? Chunk->Canceler : Chunk->HedgeCanceler;
+			}
+		}
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *Download->URL);
+			Download->Finish(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			Download->Finish(EDownloadToMemoryResult::Cancelled);
+			return;
+		}
+
+		if (!bWritten)
+		{
+			// A hedged chunk only fails once both of its requests have failed. The connection moves on, leaving the chunk to the other request
+			if (bOtherPending)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("A request for file chunk {%lld; %lld} from %s failed, waiting for the other request of the chunk: %s"), Chunk->Range.X, Chunk->Range.Y, *Download->URL, *UEnum::GetValueAsString(Result.Result));
+				if (!bHedge)
+				{
+					SharedThis->RequestParallelChunk(Download, ConnectionIndex);
+				}
+				return;
+			}
+
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk {%lld; %lld} from %s: %s"), Chunk->Range.X, Chunk->Range.Y, *Download->URL, *UEnum::GetValueAsString(Result.Result));
+			Download->Finish(Result.Result == EDownloadToMemoryResult::Cancelled ? EDownloadToMemoryResult::Cancelled : EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		// The request that lost the race is of no use anymore
+		if (LoserCanceler.IsValid())
+		{
+			LoserCanceler->Cancel();
+		}
+
+		if (Result.Result == EDownloadToMemoryResult::Success)
+		{
+			Download->SetResponseHeaders(MoveTemp(Result.Headers));
+		}
+
+		if (bHedge && Result.Result == EDownloadToMemoryResult::Success && Chunk->bHedgeWon)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Hedged request for file chunk {%lld; %lld} from %s completed first"), Chunk->Range.X, Chunk->Range.Y, *Download->URL);
+			SharedThis->TelemetryRecorder->RecordHedgeWon();
+		}
+
+		bool bComplete;
+		{
+			FScopeLock Lock(&Download->CriticalSection);
+			bComplete = Download->CompletedBytes >= Download->Range.Y - Download->Range.X + 1;
+		}
+
+		if (bComplete)
+		{
+			Download->Finish(EDownloadToMemoryResult::Success);
+			return;
+		}
+		if (!bHedge)
+		{
+			SharedThis->RequestParallelChunk(Download, ConnectionIndex);
+		}
+	});
+}
+
+bool FRuntimeChunkDownloader::HedgeParallelStragglers(const TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe>& Download)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::HedgeParallelStragglers);
+
+	// A hedged request may complete synchronously, so the stragglers are taken before any request is made
+	for (const TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>& Chunk : Download->TakeStragglers())
+	{
+		TelemetryRecorder->RecordHedge();
+		RequestParallelChunkRange(Download, Chunk, INDEX_NONE);
+	}
+	return !Download->IsFinished();
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFileStreamed(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int32 MaxOutstandingChunks, const TFunction<void(int64, int64)>& OnProgress, const TFunction<void(FRuntimeStreamedChunk&)>& OnChunkDownloaded, const TMap<FString, FString>& Headers)
+{
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk stream from %s"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
+	}
+
+	if (MaxChunkSize <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to stream file chunks from %s: max chunk size is <= 0"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::DownloadFailed).GetFuture();
+	}
+	TelemetryRecorder->RecordChunkSize(MaxChunkSize);
+
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	GetContentSize(URL, Timeout, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, MaxOutstandingChunks, OnProgress, OnChunkDownloaded, Headers](int64 ContentSize)
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to stream file chunks from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk stream from %s"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			return;
+		}
+
+		if (ContentSize == -304)
+		{
+			PromisePtr->SetValue(EDownloadToMemoryResult::NotModified);
+			return;
+		}
+
+		if (ContentSize <= 0)
+		{
+			// Without a known size the file cannot be split into ranges, so it is delivered as a single chunk that needs no acknowledgement
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload"), *URL);
+			SharedThis->TelemetryRecorder->RecordPayloadFallback();
+			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress, Headers).Next([PromisePtr, URL, OnChunkDownloaded](FRuntimeChunkDownloaderResult Result)
+			{
+				if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to stream file chunks from %s: %s"), *URL, *UEnum::GetValueAsString(Result.Result));
+					PromisePtr->SetValue(Result.Result);
+					return;
+				}
+
+				FRuntimeStreamedChunk Chunk;
+				Chunk.Data = MoveTemp(Result.Data);
+				OnChunkDownloaded(Chunk);
+				FRuntimeChunkBufferPool::Get().Release(MoveTemp(Chunk.Data));
+				PromisePtr->SetValue(Result.Result);
+			});
+			return;
+		}
+
+		TSharedRef<FRuntimeChunkStream, ESPMode::ThreadSafe> Stream = MakeShared<FRuntimeChunkStream, ESPMode::ThreadSafe>(SharedThis.ToSharedRef(), URL, Timeout, ContentType, ContentSize, MaxChunkSize, MaxOutstandingChunks, OnProgress, OnChunkDownloaded);
+		Stream->TelemetryRecorder = SharedThis->TelemetryRecorder;
+		Stream->Headers = Headers;
+		{
+			FScopeLock Lock(&SharedThis->ActiveRequestsCriticalSection);
+			SharedThis->ActiveStreams.RemoveAll([](const TWeakPtr<FRuntimeChunkStream, ESPMode::ThreadSafe>& ActiveStream)
+			{
+				return !ActiveStream.IsValid();
+			});
+			SharedThis->ActiveStreams.Add(Stream);
+		}
+
+		Stream->Start().Next([PromisePtr](EDownloadToMemoryResult Result)
+		{
+			PromisePtr->SetValue(Result);
+		});
+	});
+
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress)
+{
+	return DownloadFileByChunk(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, nullptr);
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress, const FRuntimeRequestCancelerPtr& Canceler, const FRuntimeChunkContentWriter& ContentWriter, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFileByChunk);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}}).GetFuture();
+	}
+
+	if (ChunkRange.X < 0 || ChunkRange.Y < 0 || ChunkRange.X > ChunkRange.Y)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: chunk range (%lld; %lld) is invalid"), *URL, ChunkRange.X, ChunkRange.Y);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
+	}
+
+	// The size of the file may be unknown, e.g. for the single-range fallback of a multi-range download
+	if (ContentSize > 0 && ChunkRange.Y >= ContentSize)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: chunk range (%lld; %lld) is out of range (%lld)"), *URL, ChunkRange.X, ChunkRange.Y, ContentSize);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
+	}
+
+	// A chunk handed to a content writer is never buffered here, the memory it is written to being accounted for by the owner of the writer
+	if (ContentWriter)
+	{
+		return StartChunkRequest(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, nullptr, Canceler, ContentWriter, Headers, 0);
+	}
+
+	const int64 ChunkSize = ChunkRange.Y - ChunkRange.X + 1;
+	if (FRuntimeDownloadMemoryBudget::FReservationPtr Reservation = FRuntimeDownloadMemoryBudget::Get().TryReserve(ChunkSize, TelemetryRecorder))
+	{
+		return StartChunkRequest(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, Reservation, Canceler, ContentWriter, Headers, 0);
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download of file chunk from %s is waiting for the download memory budget. Range: {%lld; %lld}"), *URL, ChunkRange.X, ChunkRange.Y);
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	FRuntimeDownloadMemoryBudget::Get().Reserve(ChunkSize, TelemetryRecorder, [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, Canceler, ContentWriter, Headers](const FRuntimeDownloadMemoryBudget::FReservationPtr& Reservation)
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+			return;
+		}
+
+		SharedThis->StartChunkRequest(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, Reservation, Canceler, ContentWriter, Headers, 0).Next([PromisePtr](FRuntimeChunkDownloaderResult&& Result)
+		{
+			PromisePtr->SetValue(MoveTemp(Result));
+		});
+	});
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::StartChunkRequest(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress, const FRuntimeDownloadMemoryBudget::FReservationPtr& Reservation, const FRuntimeRequestCancelerPtr& Canceler, const FRuntimeChunkContentWriter& ContentWriter, const TMap<FString, FString>& Headers, int32 NumStallRetries)
+{
+	// The download may have been canceled while waiting for the memory budget
+	if (bCanceled || (Canceler.IsValid() && Canceler->IsCanceled()))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}}).GetFuture();
+	}
+
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#else
+	const TSharedRef<IHttpRequest> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#endif
+
+	HttpRequestRef->SetVerb("GET");
+	HttpRequestRef->SetURL(URL);
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	HttpRequestRef->SetTimeout(Timeout);
+#else
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
+#endif
+
+	for (const auto& [Key, Value] : Headers)
+	{
+		HttpRequestRef->SetHeader(Key, Value);
+	}
+
+	if (!ContentType.IsEmpty())
+	{
+		HttpRequestRef->SetHeader(TEXT("Content-Type"), ContentType);
+	}
+
+	const FString RangeHeaderValue = FString::Format(TEXT("bytes={0}-{1}"), {ChunkRange.X, ChunkRange.Y});
+	HttpRequestRef->SetHeader(TEXT("Range"), RangeHeaderValue);
+
+	const int32 TransferIndex = TelemetryRecorder->BeginTransfer(ChunkRange.X);
+	TSharedRef<FRuntimeRequestTrace, ESPMode::ThreadSafe> RequestTrace = MakeShared<FRuntimeRequestTrace, ESPMode::ThreadSafe>();
+
+	// Progress is coalesced and dispatched once per frame at most, since the HTTP module may report it far more often than it is useful
+	const uint64 ProgressHandle = FRuntimeProgressAggregator::Get().Register(URL, [WeakThisPtr, OnProgress](int64 BytesReceived, int64 ContentSize)
+	{
+		if (WeakThisPtr.IsValid())
+		{
+			OnProgress(BytesReceived, ContentSize);
+		}
+	});
+
+	// Stalls are detected from the progress of the request, independently of the timeout of the whole request
+	TSharedRef<std::atomic<bool>, ESPMode::ThreadSafe> bStalledPtr = MakeShared<std::atomic<bool>, ESPMode::ThreadSafe>(false);
+	uint64 StallHandle = 0;
+	if (LowSpeedLimit.IsEnabled())
+	{
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+		TWeakPtr<IHttpRequest, ESPMode::ThreadSafe> WeakHttpRequestPtr = HttpRequestRef;
+#else
+		TWeakPtr<IHttpRequest> WeakHttpRequestPtr = HttpRequestRef;
+#endif
+		StallHandle = FRuntimeStallMonitor::Get().Register(URL, LowSpeedLimit, [WeakHttpRequestPtr, bStalledPtr]()
 		{
-			// Only return data if no chunk was downloaded
-			if (bChunkDownloadedFilledPtr.IsValid() && (*bChunkDownloadedFilledPtr.Get() == false))
+			*bStalledPtr = true;
+			if (auto HttpRequest = WeakHttpRequestPtr.Pin())
 			{
-				if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
-				{
-					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: download failed. Trying to download the file by payload"), *URL);
-					DownloadByPayload();
-					OnChunkDownloadedFilled();
-					return;
-				}
-				OverallDownloadedDataPtr->Shrink();
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{Result, MoveTemp(*OverallDownloadedDataPtr.Get())});
+				FRuntimeNetworkSimulator::Get().CancelRequest(HttpRequest.ToSharedRef());
 			}
 		});
-	});
-	return PromisePtr->GetFuture();
-}
+	}
 
-TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress, const TFunction<void(TArray64<uint8>&&)>& OnChunkDownloaded, const TMap<FString, FString>& Headers)
-{
-	if (bCanceled)
+	BindRequestProgress(HttpRequestRef, [ContentSize, ProgressHandle, StallHandle, TransferIndex, Telemetry = TelemetryRecorder, RequestTrace](FHttpRequestPtr Request, int64 BytesReceived)
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
-	}
+		RequestTrace->Progress(BytesReceived);
+		if (BytesReceived > 0)
+		{
+			Telemetry->RecordFirstByte(TransferIndex);
+		}
+		FRuntimeProgressAggregator::Get().Report(ProgressHandle, BytesReceived, ContentSize);
+		FRuntimeStallMonitor::Get().Report(StallHandle, BytesReceived);
+	});
 
-	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
-	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
-	GetContentSize(URL, Timeout, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, OnChunkDownloaded, ChunkRange, Headers](int64 ContentSize) mutable
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, ProgressHandle, StallHandle, bStalledPtr, NumStallRetries, TransferIndex, Telemetry = TelemetryRecorder, RequestTrace, Reservation, Canceler, ContentWriter, Headers](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
 	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFileByChunk::OnComplete);
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+		RequestTrace->Finish();
+		FRuntimeStallMonitor::Get().Unregister(StallHandle);
+
+		// The reserved memory is returned on failure. A downloaded chunk takes its reservation along, so that it is held for as long as the chunk data
+		ON_SCOPE_EXIT
+		{
+			if (Reservation.IsValid())
+			{
+				Reservation->Release();
+			}
+		};
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
+
+		const bool bTransferSucceeded = bSuccess && Response.IsValid() && Response->GetResponseCode() / 100 == 2;
+		Telemetry->EndTransfer(TransferIndex, bTransferSucceeded ? Response->GetContent().Num() : 0, bTransferSucceeded);
+
 		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 		if (!SharedThis.IsValid())
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
 			return;
 		}
-		
+
 		if (SharedThis->bCanceled)
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-			PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, Response->GetAllHeaders()});
 			return;
 		}
 
-		if (ContentSize == -304)
+		// Requests canceled on their own are expected to be canceled by their owner, so this is not a warning
+		if (Canceler.IsValid() && Canceler->IsCanceled())
 		{
-			PromisePtr->SetValue(EDownloadToMemoryResult::NotModified);
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Canceled file chunk request to %s. Range: {%lld; %lld}"), *URL, ChunkRange.X, ChunkRange.Y);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}});
 			return;
 		}
 
-		if (ContentSize <= 0)
+		// A response that completed while the stall was being handled is still used
+		if (*bStalledPtr && !bTransferSucceeded)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload"), *URL);
-			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress, Headers).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnChunkDownloaded, OnProgress](FRuntimeChunkDownloaderResult Result) mutable
+			if (NumStallRetries >= SharedThis->LowSpeedLimit.MaxRetries)
 			{
-				TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-				if (!SharedThis.IsValid())
-				{
-					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-					PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
-					return;
-				}
-
-				if (SharedThis->bCanceled)
-				{
-					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-					PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
-					return;
-				}
-
-				if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
-				{
-					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: %s"), *URL, *UEnum::GetValueAsString(Result.Result));
-					PromisePtr->SetValue(Result.Result);
-					return;
-				}
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: the request stalled %d times. Range: {%lld; %lld}"), *URL, NumStallRetries + 1, ChunkRange.X, ChunkRange.Y);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}});
+				return;
+			}
 
-				if (Result.Data.Num() <= 0)
-				{
-					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: downloaded content is empty"), *URL);
-					PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
-					return;
-				}
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("File chunk request to %s stalled, requesting the chunk again (retry %d of %d). Range: {%lld; %lld}"), *URL, NumStallRetries + 1, SharedThis->LowSpeedLimit.MaxRetries, ChunkRange.X, ChunkRange.Y);
+			Telemetry->RecordRetry();
 
-				PromisePtr->SetValue(Result.Result);
-				OnChunkDownloaded(MoveTemp(Result.Data));
+			// The reserved memory is handed over to the new request instead of being returned
+			const FRuntimeDownloadMemoryBudget::FReservationPtr RetryReservation = MoveTemp(Reservation);
+			SharedThis->StartChunkRequest(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, RetryReservation, Canceler, ContentWriter, Headers, NumStallRetries + 1).Next([PromisePtr](FRuntimeChunkDownloaderResult&& Result)
+			{
+				PromisePtr->SetValue(MoveTemp(Result));
 			});
 			return;
 		}
 
-		if (MaxChunkSize <= 0)
+		if (!bSuccess || !Response.IsValid())
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: max chunk size is <= 0"), *URL);
-			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: request failed"), *Request->GetURL());
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
 			return;
 		}
 
-		// If the chunk range is not specified, determine the range based on the max chunk size and the content size
-		if (ChunkRange.X == 0 && ChunkRange.Y == 0)
+		if (Response->GetResponseCode() / 100 != 2)
 		{
-			ChunkRange.Y = FMath::Min(MaxChunkSize, ContentSize) - 1;
+
+			if (Response->GetResponseCode() == 304)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Response code to GET for downloading file chunk from %s by payload: %d %s"), *URL, Response->GetResponseCode(), *Response->GetContentAsString());
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::NotModified, {}, Response->GetAllHeaders()});
+			}
+			else
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Response code to GET for downloading file chunk from %s by payload: %d %s"), *URL, Response->GetResponseCode(), *Response->GetContentAsString());
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
+			}
+			return;
 		}
 
-		if (ChunkRange.Y > ContentSize)
+		if (Response->GetContentLength() <= 0)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: chunk range is out of range (%lld, expected [0, %lld])"), *URL, ChunkRange.Y, ContentSize);
-			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length is 0"), *Request->GetURL());
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
 			return;
 		}
 
-		auto OnProgressInternal = [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnChunkDownloaded, OnProgress, ChunkRange](int64 BytesReceived, int64 ContentSize) mutable
-		{
-			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-			if (SharedThis.IsValid())
-			{
-				const float Progress = ContentSize <= 0 ? 0.0f : static_cast<float>(BytesReceived + ChunkRange.X) / ContentSize;
-				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %lld bytes of file chunk from %s. Range: {%lld; %lld}, Overall: %lld, Progress: %f"), BytesReceived, *URL, ChunkRange.X, ChunkRange.Y, ContentSize, Progress);
-				OnProgress(BytesReceived + ChunkRange.X, ContentSize);
-			}
-		};
+		const int64 ContentLength = FCString::Atoi64(*Response->GetHeader("Content-Length"));
 
-		SharedThis->DownloadFileByChunk(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgressInternal).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, MaxChunkSize, OnChunkDownloaded, OnProgress, ChunkRange, Headers](FRuntimeChunkDownloaderResult&& Result)
+		if (ContentLength != ChunkRange.Y - ChunkRange.X + 1)
 		{
-			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-			if (!SharedThis.IsValid())
-			{
-				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-				PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
-				return;
-			}
-
-			if (SharedThis->bCanceled)
-			{
-				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-				PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
-				return;
-			}
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length (%lld) does not match the expected length (%lld)"), *Request->GetURL(), ContentLength, ChunkRange.Y - ChunkRange.X + 1);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
+			return;
+		}
 
-			if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file chunk from %s. Range: {%lld; %lld}, Overall: %lld"), *Request->GetURL(), ChunkRange.X, ChunkRange.Y, ContentLength);
+		if (ContentWriter)
+		{
+			const TArray<uint8>& ResponseContent = Response->GetContent();
+			if (ResponseContent.Num() != ContentLength || !ContentWriter(ChunkRange.X, ResponseContent.GetData(), ResponseContent.Num()))
 			{
-				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: %s"), *URL, *UEnum::GetValueAsString(Result.Result));
-				PromisePtr->SetValue(Result.Result);
+				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("File chunk from %s was not written. Range: {%lld; %lld}"), *URL, ChunkRange.X, ChunkRange.Y);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
 				return;
 			}
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, {}, Response->GetAllHeaders()});
+			return;
+		}
 
-			OnChunkDownloaded(MoveTemp(Result.Data));
-
-			// Check if the download is complete
-			if (ContentSize > ChunkRange.Y + 1)
-			{
-				const int64 ChunkStart = ChunkRange.Y + 1;
-				const int64 ChunkEnd = FMath::Min(ChunkStart + MaxChunkSize, ContentSize) - 1;
-
-				SharedThis->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, FInt64Vector2(ChunkStart, ChunkEnd), OnProgress, OnChunkDownloaded, Headers).Next([WeakThisPtr, PromisePtr](EDownloadToMemoryResult Result)
-				{
-					PromisePtr->SetValue(Result);
-				});
-			}
-			else
-			{
-				PromisePtr->SetValue(EDownloadToMemoryResult::Success);
-			}
-		});
+		TArray64<uint8> ChunkData;
+		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::CopyChunk);
+			const TArray<uint8>& ResponseContent = Response->GetContent();
+			ChunkData = FRuntimeChunkBufferPool::Get().AcquireCopy(ResponseContent.GetData(), ResponseContent.Num());
+		}
+		PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(ChunkData), Response->GetAllHeaders(), MoveTemp(Reservation)});
 	});
 
+	FRuntimeNetworkSimulator::Get().ShapeRequest(HttpRequestRef, Timeout);
+	if (!HttpRequestRef->ProcessRequest())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: request failed"), *URL);
+		TelemetryRecorder->EndTransfer(TransferIndex, 0, false);
+		RequestTrace->Finish();
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
+		FRuntimeStallMonitor::Get().Unregister(StallHandle);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
+	}
+
+	TrackHttpRequest(HttpRequestRef);
+	if (Canceler.IsValid())
+	{
+		Canceler->SetHttpRequest(HttpRequestRef);
+	}
 	return PromisePtr->GetFuture();
 }
 
-TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress)
+TFuture<FRuntimeChunkDownloaderRangesResult> FRuntimeChunkDownloader::DownloadFileRanges(const FString& URL, float Timeout, const TArray<FInt64Vector2>& Ranges, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
 {
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFileRanges);
+
 	if (bCanceled)
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
-		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, {}}).GetFuture();
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderRangesResult>(FRuntimeChunkDownloaderRangesResult{EDownloadToMemoryResult::Cancelled, {}}).GetFuture();
 	}
 
-	if (ChunkRange.X < 0 || ChunkRange.Y <= 0 || ChunkRange.X > ChunkRange.Y)
+	if (Ranges.Num() <= 0)
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: chunk range (%lld; %lld) is invalid"), *URL, ChunkRange.X, ChunkRange.Y);
-		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: no ranges were specified"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderRangesResult>(FRuntimeChunkDownloaderRangesResult{EDownloadToMemoryResult::DownloadFailed, {}}).GetFuture();
 	}
 
-	if (ChunkRange.Y - ChunkRange.X + 1 > ContentSize)
+	int64 TotalSize = 0;
+	for (const FInt64Vector2& Range : Ranges)
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: chunk range (%lld; %lld) is out of range (%lld)"), *URL, ChunkRange.X, ChunkRange.Y, ContentSize);
-		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
+		if (Range.X < 0 || Range.X > Range.Y)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: range (%lld; %lld) is invalid"), *URL, Range.X, Range.Y);
+			return MakeFulfilledPromise<FRuntimeChunkDownloaderRangesResult>(FRuntimeChunkDownloaderRangesResult{EDownloadToMemoryResult::DownloadFailed, {}}).GetFuture();
+		}
+		TotalSize += Range.Y - Range.X + 1;
 	}
 
+	// The buffer of all ranges is reserved from the download memory budget. The single-range requests of the fallback write straight into it, so they are not reserved again
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderRangesResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderRangesResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	FRuntimeDownloadMemoryBudget::Get().Reserve(TotalSize, TelemetryRecorder, [WeakThisPtr, PromisePtr, URL, Timeout, Ranges, OnProgress, Headers](const FRuntimeDownloadMemoryBudget::FReservationPtr& Reservation)
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file ranges from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderRangesResult{EDownloadToMemoryResult::DownloadFailed, {}});
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file ranges download from %s"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderRangesResult{EDownloadToMemoryResult::Cancelled, {}});
+			return;
+		}
+
+		TSharedPtr<FRuntimeRangesAssembly, ESPMode::ThreadSafe> Assembly = MakeShared<FRuntimeRangesAssembly, ESPMode::ThreadSafe>(Ranges);
+		Assembly->Reservation = Reservation;
+		SharedThis->RequestRanges(PromisePtr, URL, Timeout, Assembly, OnProgress, Headers);
+	});
+	return PromisePtr->GetFuture();
+}
+
+void FRuntimeChunkDownloader::RequestRanges(const TSharedPtr<TPromise<FRuntimeChunkDownloaderRangesResult>>& PromisePtr, const FString& URL, float Timeout, const TSharedPtr<FRuntimeRangesAssembly, ESPMode::ThreadSafe>& Assembly, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::RequestRanges);
+
 	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
 
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
 	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
 #else
@@ -365,6 +1866,10 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByCh
 
 	HttpRequestRef->SetVerb("GET");
 	HttpRequestRef->SetURL(URL);
+	for (const auto& [Key, Value] : Headers)
+	{
+		HttpRequestRef->SetHeader(Key, Value);
+	}
 
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
 	HttpRequestRef->SetTimeout(Timeout);
@@ -372,98 +1877,225 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByCh
 	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
 #endif
 
-	if (!ContentType.IsEmpty())
+	TArray<FString> RangeSpecifiers;
+	for (const FInt64Vector2& Range : Assembly->Ranges)
 	{
-		HttpRequestRef->SetHeader(TEXT("Content-Type"), ContentType);
+		RangeSpecifiers.Add(FString::Printf(TEXT("%lld-%lld"), Range.X, Range.Y));
 	}
+	HttpRequestRef->SetHeader(TEXT("Range"), TEXT("bytes=") + FString::Join(RangeSpecifiers, TEXT(",")));
 
-	const FString RangeHeaderValue = FString::Format(TEXT("bytes={0}-{1}"), {ChunkRange.X, ChunkRange.Y});
-	HttpRequestRef->SetHeader(TEXT("Range"), RangeHeaderValue);
+	const int32 TransferIndex = TelemetryRecorder->BeginTransfer(Assembly->Ranges[0].X);
+	TSharedRef<FRuntimeRequestTrace, ESPMode::ThreadSafe> RequestTrace = MakeShared<FRuntimeRequestTrace, ESPMode::ThreadSafe>();
 
-	HttpRequestRef->OnRequestProgress().BindLambda([WeakThisPtr, ContentSize, ChunkRange, OnProgress](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+	const uint64 ProgressHandle = FRuntimeProgressAggregator::Get().Register(URL, [WeakThisPtr, OnProgress](int64 BytesReceived, int64 ContentSize)
 	{
-		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-		if (SharedThis.IsValid())
+		if (WeakThisPtr.IsValid())
 		{
-			const float Progress = ContentSize <= 0 ? 0.0f : static_cast<float>(BytesReceived) / ContentSize;
-			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %d bytes of file chunk from %s. Range: {%lld; %lld}, Overall: %lld, Progress: %f"), BytesReceived, *Request->GetURL(), ChunkRange.X, ChunkRange.Y, ContentSize, Progress);
 			OnProgress(BytesReceived, ContentSize);
 		}
 	});
 
-	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
-	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, ChunkRange](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
+	BindRequestProgress(HttpRequestRef, [ProgressHandle, TransferIndex, TotalSize = Assembly->TotalSize, Telemetry = TelemetryRecorder, RequestTrace](FHttpRequestPtr Request, int64 BytesReceived)
+	{
+		RequestTrace->Progress(BytesReceived);
+		if (BytesReceived > 0)
+		{
+			Telemetry->RecordFirstByte(TransferIndex);
+		}
+
+		// The multipart framing adds a few bytes on top of the ranges themselves
+		FRuntimeProgressAggregator::Get().Report(ProgressHandle, FMath::Min(BytesReceived, TotalSize), TotalSize);
+	});
+
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, Timeout, Assembly, OnProgress, Headers, ProgressHandle, TransferIndex, Telemetry = TelemetryRecorder, RequestTrace](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
 	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::RequestRanges::OnComplete);
+		RequestTrace->Finish();
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
+
+		const bool bTransferSucceeded = bSuccess && Response.IsValid() && Response->GetResponseCode() / 100 == 2;
+		Telemetry->EndTransfer(TransferIndex, bTransferSucceeded ? Response->GetContent().Num() : 0, bTransferSucceeded);
+
 		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 		if (!SharedThis.IsValid())
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file ranges from %s: downloader has been destroyed"), *URL);
+			Assembly->Finish(PromisePtr, EDownloadToMemoryResult::DownloadFailed);
 			return;
 		}
 
 		if (SharedThis->bCanceled)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, {}, Response->GetAllHeaders()});
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file ranges download from %s"), *URL);
+			Assembly->Finish(PromisePtr, EDownloadToMemoryResult::Cancelled);
 			return;
 		}
 
 		if (!bSuccess || !Response.IsValid())
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: request failed"), *Request->GetURL());
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: request failed"), *URL);
+			Assembly->Finish(PromisePtr, EDownloadToMemoryResult::DownloadFailed);
 			return;
 		}
 
-		if (Response->GetResponseCode() / 100 != 2)
+		const int32 ResponseCode = Response->GetResponseCode();
+		const TArray<uint8>& ResponseContent = Response->GetContent();
+		if (ResponseCode == 304)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Response code to GET for downloading file ranges from %s: %d"), *URL, ResponseCode);
+			Assembly->Finish(PromisePtr, EDownloadToMemoryResult::NotModified);
+			return;
+		}
+		if (ResponseCode == 416)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: the ranges are not satisfiable"), *URL);
+			Assembly->Finish(PromisePtr, EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (ResponseCode == 200)
+		{
+			// The server ignored the ranges and sent the whole file, which contains all of them
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The server of %s does not support range requests, the ranges are taken from the whole file"), *URL);
+			Assembly->SetFileSize(ResponseContent.Num());
+			Assembly->Write(0, ResponseContent.GetData(), ResponseContent.Num());
+		}
+		else if (ResponseCode == 206)
 		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::ParseRanges);
 
-			if (Response->GetResponseCode() == 304)
+			FString Boundary;
+			if (FRuntimeByteRangesParser::GetBoundary(Response->GetHeader(TEXT("Content-Type")), Boundary))
 			{
-				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Response code to GET for downloading file chunk from %s by payload: %d %s"), *URL, Response->GetResponseCode(), *Response->GetContentAsString());
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::NotModified, {}, Response->GetAllHeaders()});
+				FRuntimeByteRangesParser Parser(Boundary, [&Assembly](int64 Position, const uint8* PartData, int64 PartSize)
+				{
+					Assembly->Write(Position, PartData, PartSize);
+				});
+				if (!Parser.Feed(ResponseContent.GetData(), ResponseContent.Num()) || !Parser.IsComplete())
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The multipart/byteranges response from %s is malformed or truncated"), *URL);
+				}
+				Assembly->SetFileSize(Parser.GetFileSize());
 			}
 			else
 			{
-				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Response code to GET for downloading file chunk from %s by payload: %d %s"), *URL, Response->GetResponseCode(), *Response->GetContentAsString());
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
+				// A single part is sent if the server merged the ranges or only serves the first one
+				int64 RangeStart, RangeEnd, FileSize;
+				if (ParseContentRange(Response->GetHeader(TEXT("Content-Range")), RangeStart, RangeEnd, FileSize))
+				{
+					Assembly->SetFileSize(FileSize);
+					if (RangeEnd - RangeStart + 1 == ResponseContent.Num())
+					{
+						Assembly->Write(RangeStart, ResponseContent.GetData(), ResponseContent.Num());
+					}
+				}
 			}
-			return;
+		}
+		else
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Response code to the multi-range request for %s: %d"), *URL, ResponseCode);
 		}
 
-		if (Response->GetContentLength() <= 0)
+		if (Assembly->IsComplete())
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length is 0"), *Request->GetURL());
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded %d file ranges from %s. Overall: %lld"), Assembly->Ranges.Num(), *URL, Assembly->TotalSize);
+			Assembly->Finish(PromisePtr, EDownloadToMemoryResult::Success);
 			return;
 		}
 
-		const int64 ContentLength = FCString::Atoi64(*Response->GetHeader("Content-Length"));
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The response from %s does not contain all requested ranges. Downloading the missing ranges with separate requests"), *URL);
+		SharedThis->RequestRangesSeparately(PromisePtr, URL, Timeout, Assembly, OnProgress, Headers);
+	});
+
+	FRuntimeNetworkSimulator::Get().ShapeRequest(HttpRequestRef, Timeout);
+	if (!HttpRequestRef->ProcessRequest())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: request failed"), *URL);
+		TelemetryRecorder->EndTransfer(TransferIndex, 0, false);
+		RequestTrace->Finish();
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
+		Assembly->Finish(PromisePtr, EDownloadToMemoryResult::DownloadFailed);
+		return;
+	}
+
+	TrackHttpRequest(HttpRequestRef);
+}
+
+void FRuntimeChunkDownloader::RequestRangesSeparately(const TSharedPtr<TPromise<FRuntimeChunkDownloaderRangesResult>>& PromisePtr, const FString& URL, float Timeout, const TSharedPtr<FRuntimeRangesAssembly, ESPMode::ThreadSafe>& Assembly, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::RequestRangesSeparately);
+
+	// Partially received ranges are requested again as a whole
+	TArray<int32> MissingRangeIndices;
+	for (int32 Index = 0; Index < Assembly->Ranges.Num(); ++Index)
+	{
+		if (!Assembly->IsRangeComplete(Index))
+		{
+			Assembly->ResetRange(Index);
+			MissingRangeIndices.Add(Index);
+		}
+		else
+		{
+			Assembly->ProgressBytes[Index] = Assembly->GetRangeSize(Index);
+		}
+	}
+
+	if (MissingRangeIndices.Num() == 0)
+	{
+		Assembly->Finish(PromisePtr, EDownloadToMemoryResult::Success);
+		return;
+	}
+
+	Assembly->NumPendingRequests = MissingRangeIndices.Num();
+	for (const int32 Index : MissingRangeIndices)
+	{
+		const FInt64Vector2 Range = Assembly->Ranges[Index];
+
+		// Progress is dispatched on the game thread, so the progress of the requests is summed up there
+		auto OnRangeProgress = [Assembly, Index, OnProgress](int64 BytesReceived, int64 ContentSize)
+		{
+			Assembly->ProgressBytes[Index] = BytesReceived;
+			int64 OverallBytesReceived = 0;
+			for (const int64 RangeBytesReceived : Assembly->ProgressBytes)
+			{
+				OverallBytesReceived += RangeBytesReceived;
+			}
+			OnProgress(OverallBytesReceived, Assembly->TotalSize);
+		};
 
-		if (ContentLength != ChunkRange.Y - ChunkRange.X + 1)
+		// The range is written straight into the reserved buffer of the assembly
+		auto WriteRange = [Assembly](int64 Offset, const uint8* Data, int64 Size)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length (%lld) does not match the expected length (%lld)"), *Request->GetURL(), ContentLength, ChunkRange.Y - ChunkRange.X + 1);
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, Response->GetAllHeaders()});
-			return;
-		}
+			if (Assembly->bFinished)
+			{
+				return false;
+			}
+			Assembly->Write(Offset, Data, Size);
+			return true;
+		};
 
-		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file chunk from %s. Range: {%lld; %lld}, Overall: %lld"), *Request->GetURL(), ChunkRange.X, ChunkRange.Y, ContentLength);
-		PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, TArray64<uint8>(Response->GetContent()), Response->GetAllHeaders()});
-	});
+		// The size of the file is only known if a response reported it, otherwise the range is not checked against it
+		DownloadFileByChunk(URL, Timeout, FString(), FMath::Max<int64>(Assembly->FileSize, 0), Range, OnRangeProgress, nullptr, WriteRange, Headers).Next([PromisePtr, URL, Assembly, Range](FRuntimeChunkDownloaderResult&& Result)
+		{
+			if (Result.Result != EDownloadToMemoryResult::Success)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file range (%lld; %lld) from %s: %s"), Range.X, Range.Y, *URL, *UEnum::GetValueAsString(Result.Result));
+				Assembly->Finish(PromisePtr, Result.Result == EDownloadToMemoryResult::Cancelled ? EDownloadToMemoryResult::Cancelled : EDownloadToMemoryResult::DownloadFailed);
+				return;
+			}
 
-	if (!HttpRequestRef->ProcessRequest())
-	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: request failed"), *URL);
-		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
+			if (--Assembly->NumPendingRequests == 0)
+			{
+				Assembly->Finish(PromisePtr, Assembly->IsComplete() ? EDownloadToMemoryResult::Success : EDownloadToMemoryResult::DownloadFailed);
+			}
+		});
 	}
-
-	HttpRequestPtr = HttpRequestRef;
-	return PromisePtr->GetFuture();
 }
 
 TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByPayload(const FString& URL, float Timeout, const FString& ContentType, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
 {
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFileByPayload);
+
 	if (bCanceled)
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
@@ -472,6 +2104,7 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByPa
 
 	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
 
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
 	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
 #else
@@ -491,21 +2124,41 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByPa
 	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
 #endif
 
-	HttpRequestRef->OnRequestProgress().BindLambda([WeakThisPtr, OnProgress](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+	const int32 TransferIndex = TelemetryRecorder->BeginTransfer(0);
+	TSharedRef<FRuntimeRequestTrace, ESPMode::ThreadSafe> RequestTrace = MakeShared<FRuntimeRequestTrace, ESPMode::ThreadSafe>();
+
+	const uint64 ProgressHandle = FRuntimeProgressAggregator::Get().Register(URL, [WeakThisPtr, OnProgress](int64 BytesReceived, int64 ContentLength)
 	{
-		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-		if (SharedThis.IsValid())
+		if (WeakThisPtr.IsValid())
 		{
-			const int64 ContentLength = Request->GetContentLength();
-			const float Progress = ContentLength <= 0 ? 0.0f : static_cast<float>(BytesReceived) / ContentLength;
-			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %d bytes of file chunk from %s by payload. Overall: %lld, Progress: %f"), BytesReceived, *Request->GetURL(), static_cast<int64>(Request->GetContentLength()), Progress);
 			OnProgress(BytesReceived, ContentLength);
 		}
 	});
 
+	BindRequestProgress(HttpRequestRef, [ProgressHandle, TransferIndex, Telemetry = TelemetryRecorder, RequestTrace](FHttpRequestPtr Request, int64 BytesReceived)
+	{
+		RequestTrace->Progress(BytesReceived);
+		if (BytesReceived > 0)
+		{
+			Telemetry->RecordFirstByte(TransferIndex);
+		}
+
+		// The overall size comes from the response, since the content length of the request is the size of its own body
+		const FHttpResponsePtr Response = Request->GetResponse();
+		const int64 ContentLength = Response.IsValid() ? static_cast<int64>(Response->GetContentLength()) : 0;
+		FRuntimeProgressAggregator::Get().Report(ProgressHandle, BytesReceived, ContentLength);
+	});
+
 	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
-	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, ProgressHandle, TransferIndex, Telemetry = TelemetryRecorder, RequestTrace](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
 	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFileByPayload::OnComplete);
+		RequestTrace->Finish();
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
+
+		const bool bTransferSucceeded = bSuccess && Response.IsValid() && Response->GetResponseCode() / 100 == 2;
+		Telemetry->EndTransfer(TransferIndex, bTransferSucceeded ? Response->GetContent().Num() : 0, bTransferSucceeded);
+
 		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 		TArray<FString> ResponseHeaders = Response ? Response->GetAllHeaders() : TArray<FString>();
 		if (!SharedThis.IsValid())
@@ -551,21 +2204,34 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByPa
 		}
 
 		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file from %s by payload. Overall: %lld"), *Request->GetURL(), static_cast<int64>(Response->GetContentLength()));
-		return PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::SucceededByPayload, TArray64<uint8>(Response->GetContent()), ResponseHeaders});
+		TArray64<uint8> PayloadData;
+		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::CopyPayload);
+			// The payload is usually kept by the caller as the final result, so it is allocated at its exact size instead of being leased from the chunk buffer pool
+			const TArray<uint8>& ResponseContent = Response->GetContent();
+			PayloadData.Append(ResponseContent.GetData(), ResponseContent.Num());
+		}
+		return PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::SucceededByPayload, MoveTemp(PayloadData), ResponseHeaders});
 	});
 
+	FRuntimeNetworkSimulator::Get().ShapeRequest(HttpRequestRef, Timeout);
 	if (!HttpRequestRef->ProcessRequest())
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: request failed"), *URL);
+		TelemetryRecorder->EndTransfer(TransferIndex, 0, false);
+		RequestTrace->Finish();
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
 		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, {}, {}}).GetFuture();
 	}
 
-	HttpRequestPtr = HttpRequestRef;
+	TrackHttpRequest(HttpRequestRef);
 	return PromisePtr->GetFuture();
 }
 
 TFuture<int64> FRuntimeChunkDownloader::GetContentSize(const FString& URL, float Timeout, const TMap<FString, FString>& Headers)
 {
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::GetContentSize);
+
 	TSharedPtr<TPromise<int64>> PromisePtr = MakeShared<TPromise<int64>>();
 
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
@@ -587,8 +2253,14 @@ TFuture<int64> FRuntimeChunkDownloader::GetContentSize(const FString& URL, float
 	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
 #endif
 
-	HttpRequestRef->OnProcessRequestComplete().BindLambda([PromisePtr, URL](const FHttpRequestPtr& Request, const FHttpResponsePtr& Response, const bool bSucceeded)
+	const double StartTime = FPlatformTime::Seconds();
+	TSharedRef<FRuntimeRequestTrace, ESPMode::ThreadSafe> RequestTrace = MakeShared<FRuntimeRequestTrace, ESPMode::ThreadSafe>();
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([PromisePtr, URL, StartTime, Telemetry = TelemetryRecorder, RequestTrace](const FHttpRequestPtr& Request, const FHttpResponsePtr& Response, const bool bSucceeded)
 	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::GetContentSize::OnComplete);
+		RequestTrace->Finish();
+		Telemetry->RecordHeadLatency(FPlatformTime::Seconds() - StartTime);
+
 		if (!bSucceeded || !Response.IsValid())
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: request failed"), *URL);
@@ -622,37 +2294,394 @@ TFuture<int64> FRuntimeChunkDownloader::GetContentSize(const FString& URL, float
 		PromisePtr->SetValue(ContentLength);
 	});
 
+	FRuntimeNetworkSimulator::Get().ShapeRequest(HttpRequestRef, Timeout);
 	if (!HttpRequestRef->ProcessRequest())
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: request failed"), *URL);
+		RequestTrace->Finish();
 		return MakeFulfilledPromise<int64>(0).GetFuture();
 	}
 
-	HttpRequestPtr = HttpRequestRef;
+	TrackHttpRequest(HttpRequestRef);
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeChunkDownloaderFirstChunkResult> FRuntimeChunkDownloader::DownloadFirstChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFirstChunk);
+
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#else
+	const TSharedRef<IHttpRequest> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#endif
+
+	HttpRequestRef->SetVerb("GET");
+	HttpRequestRef->SetURL(URL);
+	for (const auto& [Key, Value] : Headers)
+	{
+		HttpRequestRef->SetHeader(Key, Value);
+	}
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	HttpRequestRef->SetTimeout(Timeout);
+#else
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
+#endif
+
+	if (!ContentType.IsEmpty())
+	{
+		HttpRequestRef->SetHeader(TEXT("Content-Type"), ContentType);
+	}
+
+	HttpRequestRef->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=0-%lld"), MaxChunkSize - 1));
+
+	const int32 TransferIndex = TelemetryRecorder->BeginTransfer(0);
+	TSharedRef<FRuntimeRequestTrace, ESPMode::ThreadSafe> RequestTrace = MakeShared<FRuntimeRequestTrace, ESPMode::ThreadSafe>();
+
+	const uint64 ProgressHandle = FRuntimeProgressAggregator::Get().Register(URL, [WeakThisPtr, OnProgress](int64 BytesReceived, int64 ContentSize)
+	{
+		if (WeakThisPtr.IsValid())
+		{
+			OnProgress(BytesReceived, ContentSize);
+		}
+	});
+
+	BindRequestProgress(HttpRequestRef, [ProgressHandle, TransferIndex, Telemetry = TelemetryRecorder, RequestTrace](FHttpRequestPtr Request, int64 BytesReceived)
+	{
+		RequestTrace->Progress(BytesReceived);
+		if (BytesReceived > 0)
+		{
+			Telemetry->RecordFirstByte(TransferIndex);
+		}
+
+		// The overall size is only known once the Content-Range header of the response has been received
+		int64 ContentSize = 0;
+		const FHttpResponsePtr Response = Request->GetResponse();
+		if (Response.IsValid())
+		{
+			int64 RangeStart, RangeEnd;
+			if (!ParseContentRange(Response->GetHeader(TEXT("Content-Range")), RangeStart, RangeEnd, ContentSize))
+			{
+				ContentSize = Response->GetContentLength();
+			}
+		}
+		FRuntimeProgressAggregator::Get().Report(ProgressHandle, BytesReceived, ContentSize);
+	});
+
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderFirstChunkResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderFirstChunkResult>>();
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([PromisePtr, URL, MaxChunkSize, ProgressHandle, TransferIndex, Telemetry = TelemetryRecorder, RequestTrace](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::DownloadFirstChunk::OnComplete);
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+		RequestTrace->Finish();
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
+
+		const bool bTransferSucceeded = bSuccess && Response.IsValid() && Response->GetResponseCode() / 100 == 2;
+		Telemetry->EndTransfer(TransferIndex, bTransferSucceeded ? Response->GetContent().Num() : 0, bTransferSucceeded);
+
+		if (!bSuccess || !Response.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download the first chunk of file from %s: request failed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderFirstChunkResult{EDownloadToMemoryResult::DownloadFailed, {}, 0, {}});
+			return;
+		}
+
+		if (Response->GetResponseCode() == 304)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Response code to GET for downloading the first chunk of file from %s: %d %s"), *URL, Response->GetResponseCode(), *Response->GetContentAsString());
+			PromisePtr->SetValue(FRuntimeChunkDownloaderFirstChunkResult{EDownloadToMemoryResult::NotModified, {}, 0, Response->GetAllHeaders()});
+			return;
+		}
+
+		// Other failures, such as "416 Range Not Satisfiable" for empty files, are left to the download with a HEAD request
+		if (Response->GetResponseCode() / 100 != 2)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Response code to GET for downloading the first chunk of file from %s: %d"), *URL, Response->GetResponseCode());
+			PromisePtr->SetValue(FRuntimeChunkDownloaderFirstChunkResult{EDownloadToMemoryResult::DownloadFailed, {}, 0, Response->GetAllHeaders()});
+			return;
+		}
+
+		const TArray<uint8>& ResponseContent = Response->GetContent();
+		int64 ContentSize = ResponseContent.Num();
+
+		// A "206 Partial Content" response carries the size of the file, whereas a "200 OK" response means that the server ignored the range and sent the whole file
+		if (Response->GetResponseCode() == 206)
+		{
+			int64 RangeStart, RangeEnd;
+			if (!ParseContentRange(Response->GetHeader(TEXT("Content-Range")), RangeStart, RangeEnd, ContentSize) || RangeStart != 0 || RangeEnd + 1 != ResponseContent.Num() || RangeEnd >= MaxChunkSize || ContentSize <= RangeEnd)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download the first chunk of file from %s: Content-Range '%s' does not match the received %d bytes"), *URL, *Response->GetHeader(TEXT("Content-Range")), ResponseContent.Num());
+				PromisePtr->SetValue(FRuntimeChunkDownloaderFirstChunkResult{EDownloadToMemoryResult::DownloadFailed, {}, 0, Response->GetAllHeaders()});
+				return;
+			}
+		}
+
+		if (ContentSize <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download the first chunk of file from %s: content is empty"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderFirstChunkResult{EDownloadToMemoryResult::DownloadFailed, {}, 0, Response->GetAllHeaders()});
+			return;
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded the first chunk of file from %s. Received: %d, Overall: %lld"), *URL, ResponseContent.Num(), ContentSize);
+		TArray64<uint8> ChunkData;
+		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::CopyChunk);
+			ChunkData.Append(ResponseContent.GetData(), ResponseContent.Num());
+		}
+		PromisePtr->SetValue(FRuntimeChunkDownloaderFirstChunkResult{EDownloadToMemoryResult::Success, MoveTemp(ChunkData), ContentSize, Response->GetAllHeaders()});
+	});
+
+	FRuntimeNetworkSimulator::Get().ShapeRequest(HttpRequestRef, Timeout);
+	if (!HttpRequestRef->ProcessRequest())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download the first chunk of file from %s: request failed"), *URL);
+		TelemetryRecorder->EndTransfer(TransferIndex, 0, false);
+		RequestTrace->Finish();
+		FRuntimeProgressAggregator::Get().Unregister(ProgressHandle);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderFirstChunkResult>(FRuntimeChunkDownloaderFirstChunkResult{EDownloadToMemoryResult::DownloadFailed, {}, 0, {}}).GetFuture();
+	}
+
+	TrackHttpRequest(HttpRequestRef);
 	return PromisePtr->GetFuture();
 }
 
+bool FRuntimeChunkDownloader::ParseContentRange(const FString& ContentRange, int64& OutStart, int64& OutEnd, int64& OutTotalSize)
+{
+	// Expected format: "bytes <start>-<end>/<total>", where the total may be "*" if unknown
+	FString Range = ContentRange.TrimStartAndEnd();
+	FString Bounds, Total, Start, End;
+	if (!Range.RemoveFromStart(TEXT("bytes "), ESearchCase::IgnoreCase) || !Range.Split(TEXT("/"), &Bounds, &Total) || !Bounds.Split(TEXT("-"), &Start, &End))
+	{
+		return false;
+	}
+
+	Start.TrimStartAndEndInline();
+	End.TrimStartAndEndInline();
+	Total.TrimStartAndEndInline();
+	if (!Start.IsNumeric() || !End.IsNumeric() || !Total.IsNumeric())
+	{
+		return false;
+	}
+
+	OutStart = FCString::Atoi64(*Start);
+	OutEnd = FCString::Atoi64(*End);
+	OutTotalSize = FCString::Atoi64(*Total);
+	return OutStart <= OutEnd && OutEnd < OutTotalSize;
+}
+
+void FRuntimeRequestCanceler::Cancel()
+{
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+#else
+	TSharedPtr<IHttpRequest> HttpRequest;
+#endif
+	{
+		FScopeLock Lock(&CriticalSection);
+		bCanceled = true;
+		HttpRequest = HttpRequestPtr.Pin();
+		HttpRequestPtr.Reset();
+	}
+
+	// Canceling may complete the request synchronously, so this is done outside of the lock
+	if (HttpRequest.IsValid())
+	{
+		FRuntimeNetworkSimulator::Get().CancelRequest(HttpRequest.ToSharedRef());
+	}
+}
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+void FRuntimeRequestCanceler::SetHttpRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest)
+#else
+void FRuntimeRequestCanceler::SetHttpRequest(const TSharedRef<IHttpRequest>& HttpRequest)
+#endif
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (!bCanceled)
+		{
+			HttpRequestPtr = HttpRequest;
+			return;
+		}
+	}
+	FRuntimeNetworkSimulator::Get().CancelRequest(HttpRequest);
+}
+
 void FRuntimeChunkDownloader::CancelDownload()
 {
 	bCanceled = true;
-	if (HttpRequestPtr.IsValid())
-	{
+
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
-		const TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = HttpRequestPtr.Pin();
+	TArray<TSharedPtr<IHttpRequest, ESPMode::ThreadSafe>> HttpRequests;
 #else
-		const TSharedPtr<IHttpRequest> HttpRequest = HttpRequestPtr.Pin();
+	TArray<TSharedPtr<IHttpRequest>> HttpRequests;
 #endif
+	TArray<TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe>> Streams;
+	{
+		FScopeLock Lock(&ActiveRequestsCriticalSection);
 
-		HttpRequest->CancelRequest();
+		// The canceled requests stay tracked until the HTTP module releases them, so that the downloader is not reused while they may still complete
+		for (const auto& ActiveHttpRequest : ActiveHttpRequests)
+		{
+			if (auto HttpRequest = ActiveHttpRequest.Pin())
+			{
+				HttpRequests.Add(MoveTemp(HttpRequest));
+			}
+		}
+
+		for (const TWeakPtr<FRuntimeChunkStream, ESPMode::ThreadSafe>& ActiveStream : ActiveStreams)
+		{
+			if (TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> Stream = ActiveStream.Pin())
+			{
+				Streams.Add(MoveTemp(Stream));
+			}
+		}
+		ActiveStreams.Empty();
+	}
+
+	// Canceling may complete the requests synchronously, so this is done outside of the lock
+	for (const auto& HttpRequest : HttpRequests)
+	{
+		FRuntimeNetworkSimulator::Get().CancelRequest(HttpRequest.ToSharedRef());
+	}
+
+	for (const TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe>& Stream : Streams)
+	{
+		Stream->RunOnGameThread([](FRuntimeChunkStream& InStream)
+		{
+			InStream.Finish(EDownloadToMemoryResult::Cancelled);
+		});
 	}
 	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Download canceled"));
 }
 
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+void FRuntimeChunkDownloader::TrackHttpRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest)
+#else
+void FRuntimeChunkDownloader::TrackHttpRequest(const TSharedRef<IHttpRequest>& HttpRequest)
+#endif
+{
+	FScopeLock Lock(&ActiveRequestsCriticalSection);
+
+	// Completed requests are released by the HTTP module, so their weak pointers can be dropped
+	ActiveHttpRequests.RemoveAll([](const auto& ActiveHttpRequest)
+	{
+		return !ActiveHttpRequest.IsValid();
+	});
+	ActiveHttpRequests.Add(HttpRequest);
+	HttpRequestPtr = HttpRequest;
+
+	// The download shows up in the global statistics once it makes its first request
+	if (NumStartedRequests++ == 0)
+	{
+		FRuntimeDownloadStats::Get().Register(TelemetryRecorder);
+	}
+	TelemetryRecorder->RecordRequestStarted(HttpRequest->GetURL());
+}
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+void FRuntimeChunkDownloader::BindRequestProgress(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest, TFunction<void(FHttpRequestPtr, int64)> OnBytesReceived)
+#else
+void FRuntimeChunkDownloader::BindRequestProgress(const TSharedRef<IHttpRequest>& HttpRequest, TFunction<void(FHttpRequestPtr, int64)> OnBytesReceived)
+#endif
+{
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	HttpRequest->OnRequestProgress64().BindLambda([OnBytesReceived = MoveTemp(OnBytesReceived)](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
+	{
+		OnBytesReceived(Request, static_cast<int64>(BytesReceived));
+	});
+#else
+	// The wrap-arounds are counted assuming that less than 4 GB is received between two progress calls
+	HttpRequest->OnRequestProgress().BindLambda([OnBytesReceived = MoveTemp(OnBytesReceived), LastBytesReceived = static_cast<int64>(0)](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived) mutable
+	{
+		int64 BytesReceived64 = (LastBytesReceived & ~static_cast<int64>(MAX_uint32)) | static_cast<uint32>(BytesReceived);
+		if (BytesReceived64 < LastBytesReceived)
+		{
+			BytesReceived64 += static_cast<int64>(MAX_uint32) + 1;
+		}
+		LastBytesReceived = BytesReceived64;
+		OnBytesReceived(Request, BytesReceived64);
+	});
+#endif
+}
+
+void FRuntimeChunkDownloader::SetFastStart(bool bInFastStart)
+{
+	bFastStart = bInFastStart;
+}
+
+void FRuntimeChunkDownloader::SetFastStartByDefault(bool bInFastStart)
+{
+	bFastStartByDefault = bInFastStart;
+}
+
+void FRuntimeChunkDownloader::SetMaxConnections(int32 InMaxConnections)
+{
+	MaxConnections = FMath::Max(1, InMaxConnections);
+}
+
+void FRuntimeChunkDownloader::SetMaxConnectionsByDefault(int32 InMaxConnections)
+{
+	MaxConnectionsByDefault = FMath::Max(1, InMaxConnections);
+}
+
+void FRuntimeChunkDownloader::SetLowSpeedLimit(const FRuntimeLowSpeedLimit& InLowSpeedLimit)
+{
+	LowSpeedLimit = InLowSpeedLimit;
+}
+
+void FRuntimeChunkDownloader::SetLowSpeedLimitByDefault(const FRuntimeLowSpeedLimit& InLowSpeedLimit)
+{
+	FScopeLock Lock(&RuntimeChunkDownloader::GetDefaultSettingsCriticalSection());
+	RuntimeChunkDownloader::GetDefaultLowSpeedLimit() = InLowSpeedLimit;
+}
+
+void FRuntimeChunkDownloader::SetHedgingSettings(const FRuntimeHedgingSettings& InHedgingSettings)
+{
+	HedgingSettings = InHedgingSettings;
+}
+
+FRuntimeHedgingSettings FRuntimeChunkDownloader::GetHedgingSettings() const
+{
+	return HedgingSettings;
+}
+
+void FRuntimeChunkDownloader::SetHedgingSettingsByDefault(const FRuntimeHedgingSettings& InHedgingSettings)
+{
+	FScopeLock Lock(&RuntimeChunkDownloader::GetDefaultSettingsCriticalSection());
+	RuntimeChunkDownloader::GetDefaultHedgingSettings() = InHedgingSettings;
+}
+
+FRuntimeHedgingSettings FRuntimeChunkDownloader::GetHedgingSettingsByDefault()
+{
+	FScopeLock Lock(&RuntimeChunkDownloader::GetDefaultSettingsCriticalSection());
+	return RuntimeChunkDownloader::GetDefaultHedgingSettings();
+}
+
+FRuntimeDownloadTelemetry FRuntimeChunkDownloader::GetTelemetry() const
+{
+	return TelemetryRecorder->GetTelemetry();
+}
+
+int64 FRuntimeChunkDownloader::GetNumStartedRequests() const
+{
+	FScopeLock Lock(&ActiveRequestsCriticalSection);
+	return NumStartedRequests;
+}
+
 TFuture<FRuntimeChunkUploaderResult> FRuntimeChunkDownloader::UploadFile(
 	const FString& URL, float Timeout, TArray<uint8>& Body, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
 {
 	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
 
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::UploadFile);
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+
 	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
 	HttpRequestRef->SetVerb("PUT");
 	HttpRequestRef->SetURL(URL);
@@ -663,6 +2692,7 @@ TFuture<FRuntimeChunkUploaderResult> FRuntimeChunkDownloader::UploadFile(
 	}
 	HttpRequestRef->SetContent(Body);
 	auto ContentSize = Body.Num();
+	TSharedRef<FRuntimeRequestTrace, ESPMode::ThreadSafe> RequestTrace = MakeShared<FRuntimeRequestTrace, ESPMode::ThreadSafe>();
 
 	HttpRequestRef->OnRequestProgress().BindLambda(
 		[WeakThisPtr, ContentSize, OnProgress](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived) {
@@ -680,7 +2710,10 @@ TFuture<FRuntimeChunkUploaderResult> FRuntimeChunkDownloader::UploadFile(
 	TSharedPtr<TPromise<FRuntimeChunkUploaderResult>> PromisePtr = MakeShared<TPromise<
 		FRuntimeChunkUploaderResult>>();
 	HttpRequestRef->OnProcessRequestComplete().BindLambda(
-		[WeakThisPtr, PromisePtr, URL](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable {
+		[WeakThisPtr, PromisePtr, URL, RequestTrace](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable {
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkDownloader::UploadFile::OnComplete);
+			RequestTrace->Finish();
+
 			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 			if (!SharedThis.IsValid())
 			{
@@ -723,11 +2756,42 @@ TFuture<FRuntimeChunkUploaderResult> FRuntimeChunkDownloader::UploadFile(
 	if (!HttpRequestRef->ProcessRequest())
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to upload file to %s: request failed"), *URL);
+		RequestTrace->Finish();
 		return MakeFulfilledPromise<FRuntimeChunkUploaderResult>(FRuntimeChunkUploaderResult{
 			EUploadFromStorageResult::UploadFailed
 		}).GetFuture();
 	}
 
-	HttpRequestPtr = HttpRequestRef;
+	TrackHttpRequest(HttpRequestRef);
 	return PromisePtr->GetFuture();
 }
+
+FString FRuntimeChunkDownloader::GetSpillDirectory()
+{
+	return FPaths::Combine(RuntimeChunkDownloader::GetSpillRootDirectory(), FString::Printf(TEXT("%u"), FPlatformProcess::GetCurrentProcessId()));
+}
+
+void FRuntimeChunkDownloader::DeleteStaleSpillDirectories()
+{
+	const FString SpillRootDirectory = RuntimeChunkDownloader::GetSpillRootDirectory();
+	TArray<FString> ProcessDirectories;
+	IFileManager::Get().FindFiles(ProcessDirectories, *FPaths::Combine(SpillRootDirectory, TEXT("*")), false, true);
+
+	for (const FString& ProcessDirectory : ProcessDirectories)
+	{
+		if (!ProcessDirectory.IsNumeric())
+		{
+			continue;
+		}
+
+		// The files of running processes, such as other instances sharing the saved directory, may still be mapped
+		const uint32 ProcessId = static_cast<uint32>(FCString::Strtoui64(*ProcessDirectory, nullptr, 10));
+		if (ProcessId == FPlatformProcess::GetCurrentProcessId() || FPlatformProcess::IsApplicationRunning(ProcessId))
+		{
+			continue;
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Deleting the spilled files left over by process %u"), ProcessId);
+		IFileManager::Get().DeleteDirectory(*FPaths::Combine(SpillRootDirectory, ProcessDirectory), false, true);
+	}
+}
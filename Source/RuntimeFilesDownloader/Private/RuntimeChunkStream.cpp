@@ -0,0 +1,441 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeChunkStream.h"
+#include "RuntimeChunkBufferPool.h"
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadTelemetry.h"
+#include "FileToMemoryDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+void FRuntimeStreamedChunk::Acknowledge() const
+{
+	if (TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> StreamPtr = Stream.Pin())
+	{
+		StreamPtr->Acknowledge(Index);
+	}
+}
+
+FRuntimeChunkStream::FRuntimeChunkStream(const TSharedRef<FRuntimeChunkDownloader>& InDownloader, const FString& InURL, float InTimeout, const FString& InContentType, int64 InContentSize, int64 InMaxChunkSize, int32 InMaxOutstandingChunks, const TFunction<void(int64, int64)>& InOnProgress, const TFunction<void(FRuntimeStreamedChunk&)>& InOnChunkDownloaded)
+	: DownloaderPtr(InDownloader)
+	, URL(InURL)
+	, Timeout(InTimeout)
+	, ContentType(InContentType)
+	, ContentSize(InContentSize)
+	, MaxChunkSize(InMaxChunkSize)
+	, MaxOutstandingChunks(FMath::Max(1, InMaxOutstandingChunks))
+	, OnProgress(InOnProgress)
+	, OnChunkDownloaded(InOnChunkDownloaded)
+	, HedgingSettings(InDownloader->GetHedgingSettings())
+{
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeChunkStream::Start()
+{
+	TFuture<EDownloadToMemoryResult> Future = Promise.GetFuture();
+	SelfReference = AsShared();
+
+	if (ContentSize <= 0 || MaxChunkSize <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to stream file chunks from %s: invalid content size (%lld) or max chunk size (%lld)"), *URL, ContentSize, MaxChunkSize);
+		RunOnGameThread([](FRuntimeChunkStream& Stream)
+		{
+			Stream.Finish(EDownloadToMemoryResult::DownloadFailed);
+		});
+		return Future;
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Streaming %lld chunks from %s with at most %d outstanding chunks"), GetNumChunks(), *URL, MaxOutstandingChunks);
+	RunOnGameThread([](FRuntimeChunkStream& Stream)
+	{
+		Stream.RequestChunks();
+
+		// Stragglers are looked for periodically, since a stalled request does not report any progress that could trigger the check
+		if (Stream.HedgingSettings.bEnabled && !Stream.bFinished)
+		{
+			TWeakPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> WeakStreamPtr = Stream.AsShared();
+			auto TickerFunction = [WeakStreamPtr](float DeltaTime)
+			{
+				TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> SharedStream = WeakStreamPtr.Pin();
+				return SharedStream.IsValid() && SharedStream->CheckStragglers();
+			};
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+			Stream.HedgingTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Stream.HedgingSettings.CheckInterval);
+#else
+			Stream.HedgingTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Stream.HedgingSettings.CheckInterval);
+#endif
+		}
+	});
+	return Future;
+}
+
+void FRuntimeChunkStream::Acknowledge(int64 ChunkIndex)
+{
+	RunOnGameThread([ChunkIndex](FRuntimeChunkStream& Stream)
+	{
+		if (Stream.UnacknowledgedChunks.Remove(ChunkIndex) > 0)
+		{
+			--Stream.NumOutstandingChunks;
+			Stream.RequestChunks();
+		}
+	});
+}
+
+void FRuntimeChunkStream::Cancel()
+{
+	RunOnGameThread([](FRuntimeChunkStream& Stream)
+	{
+		Stream.Finish(EDownloadToMemoryResult::Cancelled);
+	});
+}
+
+int64 FRuntimeChunkStream::GetNumChunks() const
+{
+	return MaxChunkSize <= 0 ? 0 : (ContentSize + MaxChunkSize - 1) / MaxChunkSize;
+}
+
+int64 FRuntimeChunkStream::FInFlightChunk::GetBytesReceived() const
+{
+	int64 BytesReceived = 0;
+	for (const FChunkRequest& Request : Requests)
+	{
+		BytesReceived = FMath::Max(BytesReceived, Request.BytesReceived);
+	}
+	return BytesReceived;
+}
+
+void FRuntimeChunkStream::RunOnGameThread(TFunction<void(FRuntimeChunkStream&)>&& Function)
+{
+	if (IsInGameThread())
+	{
+		Function(*this);
+		return;
+	}
+
+	AsyncTask(ENamedThreads::GameThread, [SharedThis = AsShared(), Function = MoveTemp(Function)]()
+	{
+		Function(*SharedThis);
+	});
+}
+
+void FRuntimeChunkStream::RequestChunks()
+{
+	const int64 NumChunks = GetNumChunks();
+	while (!bFinished && NextChunkToRequest < NumChunks && NumOutstandingChunks < MaxOutstandingChunks)
+	{
+		TSharedPtr<FRuntimeChunkDownloader> Downloader = DownloaderPtr.Pin();
+		if (!Downloader.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to stream file chunks from %s: downloader has been destroyed"), *URL);
+			Finish(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		const int64 ChunkIndex = NextChunkToRequest++;
+		++NumOutstandingChunks;
+		FInFlightChunk& Chunk = InFlightChunks.Add(ChunkIndex);
+		Chunk.StartTime = FPlatformTime::Seconds();
+		RequestChunk(ChunkIndex);
+	}
+}
+
+void FRuntimeChunkStream::RequestChunk(int64 ChunkIndex)
+{
+	TSharedPtr<FRuntimeChunkDownloader> Downloader = DownloaderPtr.Pin();
+	FInFlightChunk* Chunk = InFlightChunks.Find(ChunkIndex);
+	if (!Downloader.IsValid() || !Chunk)
+	{
+		return;
+	}
+
+	const int32 RequestIndex = Chunk->Requests.Num();
+	FChunkRequest& Request = Chunk->Requests.AddDefaulted_GetRef();
+	Request.Canceler = MakeShared<FRuntimeRequestCanceler, ESPMode::ThreadSafe>();
+	const FRuntimeRequestCancelerPtr Canceler = Request.Canceler;
+
+	const FInt64Vector2 ChunkRange(ChunkIndex * MaxChunkSize, FMath::Min((ChunkIndex + 1) * MaxChunkSize, ContentSize) - 1);
+	TWeakPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> WeakThisPtr = AsShared();
+	Downloader->DownloadFileByChunk(URL, Timeout, ContentType, ContentSize, ChunkRange, [WeakThisPtr, ChunkIndex, RequestIndex](int64 BytesReceived, int64 ContentSize)
+	{
+		TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> SharedThis = WeakThisPtr.Pin();
+		if (SharedThis.IsValid())
+		{
+			SharedThis->RunOnGameThread([ChunkIndex, RequestIndex, BytesReceived](FRuntimeChunkStream& Stream)
+			{
+				FInFlightChunk* InFlightChunk = Stream.InFlightChunks.Find(ChunkIndex);
+				if (InFlightChunk && InFlightChunk->Requests.IsValidIndex(RequestIndex))
+				{
+					InFlightChunk->Requests[RequestIndex].BytesReceived = BytesReceived;
+					Stream.ReportProgress();
+				}
+			});
+		}
+	}, Canceler, nullptr, Headers).Next([WeakThisPtr, ChunkIndex, RequestIndex](FRuntimeChunkDownloaderResult&& Result)
+	{
+		TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(Result.Data));
+			return;
+		}
+
+		SharedThis->RunOnGameThread([ChunkIndex, RequestIndex, ChunkResult = Result.Result, Data = MoveTemp(Result.Data), Reservation = MoveTemp(Result.Reservation)](FRuntimeChunkStream& Stream) mutable
+		{
+			Stream.OnChunkComplete(ChunkIndex, RequestIndex, ChunkResult, MoveTemp(Data), MoveTemp(Reservation));
+		});
+	});
+}
+
+bool FRuntimeChunkStream::CheckStragglers()
+{
+	if (bFinished)
+	{
+		return false;
+	}
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkStream::CheckStragglers);
+
+	const double Now = FPlatformTime::Seconds();
+
+	// Chunks taking longer than most of the completed chunks did are stragglers regardless of their throughput
+	const double LatencyThreshold = HedgingSamples.GetLatencyThreshold(HedgingSettings);
+
+	// Only chunks that are transferring have a meaningful throughput, the others may still be waiting for a connection
+	TMap<int64, double> Throughputs;
+	for (const TPair<int64, FInFlightChunk>& Chunk : InFlightChunks)
+	{
+		const double Elapsed = Now - Chunk.Value.StartTime;
+		const int64 BytesReceived = Chunk.Value.GetBytesReceived();
+		if (Elapsed >= HedgingSettings.MinElapsedTime && BytesReceived > 0)
+		{
+			Throughputs.Add(Chunk.Key, BytesReceived / Elapsed);
+		}
+	}
+
+	TArray<int64> Stragglers;
+	for (const TPair<int64, FInFlightChunk>& Chunk : InFlightChunks)
+	{
+		const double Elapsed = Now - Chunk.Value.StartTime;
+		if (NumActiveHedges + Stragglers.Num() >= HedgingSettings.MaxActiveHedges)
+		{
+			break;
+		}
+		if (Chunk.Value.Requests.Num() > 1 || Elapsed < HedgingSettings.MinElapsedTime)
+		{
+			continue;
+		}
+
+		bool bStraggling = Elapsed > LatencyThreshold;
+		const double* Throughput = Throughputs.Find(Chunk.Key);
+		if (!bStraggling && Throughput)
+		{
+			TArray<double> PeerThroughputs;
+			for (const TPair<int64, double>& PeerThroughput : Throughputs)
+			{
+				if (PeerThroughput.Key != Chunk.Key)
+				{
+					PeerThroughputs.Add(PeerThroughput.Value);
+				}
+			}
+			bStraggling = HedgingSamples.IsThroughputStraggling(HedgingSettings, *Throughput, MoveTemp(PeerThroughputs));
+		}
+
+		if (bStraggling)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Hedging straggling file chunk %lld from %s: %lld bytes received in %.2f seconds"), Chunk.Key, *URL, Chunk.Value.GetBytesReceived(), Elapsed);
+			Stragglers.Add(Chunk.Key);
+		}
+	}
+
+	// A hedged request may complete synchronously, so the chunks are not iterated while hedging
+	for (const int64 ChunkIndex : Stragglers)
+	{
+		++NumActiveHedges;
+		if (TelemetryRecorder.IsValid())
+		{
+			TelemetryRecorder->RecordHedge();
+		}
+		RequestChunk(ChunkIndex);
+	}
+	return !bFinished;
+}
+
+void FRuntimeChunkStream::OnChunkComplete(int64 ChunkIndex, int32 RequestIndex, EDownloadToMemoryResult Result, TArray64<uint8>&& Data, TSharedPtr<FRuntimeMemoryReservation, ESPMode::ThreadSafe>&& Reservation)
+{
+	FInFlightChunk* Chunk = InFlightChunks.Find(ChunkIndex);
+	if (!Chunk)
+	{
+		// Another request of the hedged chunk has already completed
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(Data));
+		return;
+	}
+
+	const bool bSucceeded = Result == EDownloadToMemoryResult::Success || Result == EDownloadToMemoryResult::SucceededByPayload;
+	if (!bSucceeded && !bFinished)
+	{
+		// A hedged chunk only fails once all of its requests have failed
+		Chunk->Requests[RequestIndex].bFailed = true;
+		if (Chunk->Requests.ContainsByPredicate([](const FChunkRequest& Request) { return !Request.bFailed; }))
+		{
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(Data));
+			return;
+		}
+	}
+
+	const FInFlightChunk CompletedChunk = MoveTemp(*Chunk);
+	InFlightChunks.Remove(ChunkIndex);
+	if (CompletedChunk.Requests.Num() > 1)
+	{
+		--NumActiveHedges;
+	}
+
+	// The requests that lost the race are of no use anymore
+	for (int32 Index = 0; Index < CompletedChunk.Requests.Num(); ++Index)
+	{
+		if (Index != RequestIndex && !CompletedChunk.Requests[Index].bFailed)
+		{
+			CompletedChunk.Requests[Index].Canceler->Cancel();
+		}
+	}
+
+	if (bFinished)
+	{
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(Data));
+		return;
+	}
+
+	if (!bSucceeded)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to stream file chunk %lld from %s: %s"), ChunkIndex, *URL, *UEnum::GetValueAsString(Result));
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(Data));
+		Finish(Result);
+		return;
+	}
+
+	if (RequestIndex > 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Hedged request for file chunk %lld from %s completed first"), ChunkIndex, *URL);
+		if (TelemetryRecorder.IsValid())
+		{
+			TelemetryRecorder->RecordHedgeWon();
+		}
+	}
+
+	HedgingSamples.Add(FPlatformTime::Seconds() - CompletedChunk.StartTime, Data.Num());
+
+	CompletedBytes += Data.Num();
+	RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_ADD(BufferedBytes, Data.Num());
+	ReorderWindow.Add(ChunkIndex, FBufferedChunk{MoveTemp(Data), MoveTemp(Reservation)});
+	ReportProgress();
+	DeliverChunks();
+}
+
+void FRuntimeChunkStream::DeliverChunks()
+{
+	// A chunk acknowledged during its delivery may complete another chunk synchronously, which is then delivered by the outer loop
+	if (bDelivering)
+	{
+		return;
+	}
+	TGuardValue<bool> DeliveringGuard(bDelivering, true);
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeChunkStream::DeliverChunks);
+
+	const int64 NumChunks = GetNumChunks();
+	while (!bFinished)
+	{
+		FBufferedChunk* BufferedChunk = ReorderWindow.Find(NextChunkToDeliver);
+		if (!BufferedChunk)
+		{
+			break;
+		}
+
+		// The reservation is held until the chunk buffer is back in the pool
+		const TSharedPtr<FRuntimeMemoryReservation, ESPMode::ThreadSafe> Reservation = MoveTemp(BufferedChunk->Reservation);
+		FRuntimeStreamedChunk Chunk;
+		Chunk.Data = MoveTemp(BufferedChunk->Data);
+		Chunk.Index = NextChunkToDeliver;
+		Chunk.Offset = NextChunkToDeliver * MaxChunkSize;
+		Chunk.Stream = AsShared();
+		ReorderWindow.Remove(NextChunkToDeliver);
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(BufferedBytes, Chunk.Data.Num());
+		UnacknowledgedChunks.Add(NextChunkToDeliver);
+		++NextChunkToDeliver;
+
+		OnChunkDownloaded(Chunk);
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(Chunk.Data));
+		if (Reservation.IsValid())
+		{
+			Reservation->Release();
+		}
+
+		if (NextChunkToDeliver >= NumChunks)
+		{
+			Finish(EDownloadToMemoryResult::Success);
+		}
+	}
+}
+
+void FRuntimeChunkStream::ReportProgress() const
+{
+	int64 BytesReceived = CompletedBytes;
+	for (const TPair<int64, FInFlightChunk>& Chunk : InFlightChunks)
+	{
+		BytesReceived += Chunk.Value.GetBytesReceived();
+	}
+	OnProgress(FMath::Min(BytesReceived, ContentSize), ContentSize);
+}
+
+void FRuntimeChunkStream::Finish(EDownloadToMemoryResult Result)
+{
+	if (bFinished)
+	{
+		return;
+	}
+	bFinished = true;
+
+	if (HedgingTickerHandle.IsValid())
+	{
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		FTSTicker::GetCoreTicker().RemoveTicker(HedgingTickerHandle);
+#else
+		FTicker::GetCoreTicker().RemoveTicker(HedgingTickerHandle);
+#endif
+		HedgingTickerHandle.Reset();
+	}
+
+	for (TPair<int64, FBufferedChunk>& BufferedChunk : ReorderWindow)
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(BufferedBytes, BufferedChunk.Value.Data.Num());
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(BufferedChunk.Value.Data));
+	}
+	ReorderWindow.Empty();
+	UnacknowledgedChunks.Empty();
+
+	// The requests still in flight are of no use anymore. Only the requests of this stream are canceled, since the downloader may be shared with other downloads
+	// A canceled request may complete synchronously, so the chunks are removed before their requests are canceled
+	TArray<FRuntimeRequestCancelerPtr> Cancelers;
+	for (const TPair<int64, FInFlightChunk>& Chunk : InFlightChunks)
+	{
+		for (const FChunkRequest& Request : Chunk.Value.Requests)
+		{
+			if (!Request.bFailed)
+			{
+				Cancelers.Add(Request.Canceler);
+			}
+		}
+	}
+	InFlightChunks.Empty();
+	NumActiveHedges = 0;
+	for (const FRuntimeRequestCancelerPtr& Canceler : Cancelers)
+	{
+		Canceler->Cancel();
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Finished streaming file chunks from %s: %s"), *URL, *UEnum::GetValueAsString(Result));
+	Promise.SetValue(Result);
+
+	// The caller always holds a strong reference, so the stream is not destroyed while this function is running
+	SelfReference.Reset();
+}
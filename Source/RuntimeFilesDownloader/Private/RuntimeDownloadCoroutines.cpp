@@ -0,0 +1,51 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadCoroutines.h"
+
+#if RUNTIMEFILESDOWNLOADER_WITH_COROUTINES
+
+namespace RuntimeDownloadCoroutines
+{
+	/** Progress functions are optional for awaitable operations, while the downloader calls them unconditionally */
+	TFunction<void(int64, int64)> GetProgressFunction(const TFunction<void(int64, int64)>& OnProgress)
+	{
+		return OnProgress ? OnProgress : [](int64, int64) {};
+	}
+}
+
+FRuntimeAwaitableDownloader::FRuntimeAwaitableDownloader()
+	: Downloader(MakeShared<FRuntimeChunkDownloader>())
+{
+}
+
+TRuntimeFutureAwaiter<int64> FRuntimeAwaitableDownloader::GetContentSize(const FString& URL, float Timeout, const TMap<FString, FString>& Headers)
+{
+	return RuntimeAwait(Downloader->GetContentSize(URL, Timeout, Headers));
+}
+
+TRuntimeFutureAwaiter<FRuntimeChunkDownloaderResult> FRuntimeAwaitableDownloader::FetchRange(const FString& URL, float Timeout, int64 ContentSize, FInt64Vector2 Range, const TFunction<void(int64, int64)>& OnProgress)
+{
+	return RuntimeAwait(Downloader->DownloadFileByChunk(URL, Timeout, FString(), ContentSize, Range, RuntimeDownloadCoroutines::GetProgressFunction(OnProgress)));
+}
+
+TRuntimeFutureAwaiter<FRuntimeChunkDownloaderResult> FRuntimeAwaitableDownloader::FetchFile(const FString& URL, float Timeout, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	return RuntimeAwait(Downloader->DownloadFile(URL, Timeout, FString(), MaxChunkSize, RuntimeDownloadCoroutines::GetProgressFunction(OnProgress), Headers));
+}
+
+TRuntimeFutureAwaiter<FRuntimeChunkDownloaderResult> FRuntimeAwaitableDownloader::FetchPayload(const FString& URL, float Timeout, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers)
+{
+	return RuntimeAwait(Downloader->DownloadFileByPayload(URL, Timeout, FString(), RuntimeDownloadCoroutines::GetProgressFunction(OnProgress), Headers));
+}
+
+void FRuntimeAwaitableDownloader::Cancel()
+{
+	Downloader->CancelDownload();
+}
+
+bool FRuntimeAwaitableDownloader::IsCanceled() const
+{
+	return Downloader->IsCanceled();
+}
+
+#endif
@@ -0,0 +1,230 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadHandle.h"
+#include "FileToMemoryDownloader.h"
+#include "FileToStorageDownloader.h"
+#include "RuntimeFileIOQueue.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "RuntimeSharedBuffer.h"
+#include "Misc/ScopeLock.h"
+
+namespace RuntimeDownloadHandle
+{
+	/** The downloader calls progress functions unconditionally, while they are optional in the native API */
+	TFunction<void(int64, int64)> GetProgressFunction(TFunction<void(int64, int64)>&& OnProgress)
+	{
+		return OnProgress ? MoveTemp(OnProgress) : [](int64, int64) {};
+	}
+
+	EDownloadToStorageResult ToStorageResult(EDownloadToMemoryResult Result)
+	{
+		switch (Result)
+		{
+		case EDownloadToMemoryResult::Success:
+			return EDownloadToStorageResult::Success;
+		case EDownloadToMemoryResult::SucceededByPayload:
+			return EDownloadToStorageResult::SucceededByPayload;
+		case EDownloadToMemoryResult::NotModified:
+			return EDownloadToStorageResult::NotModified;
+		case EDownloadToMemoryResult::Cancelled:
+			return EDownloadToStorageResult::Cancelled;
+		case EDownloadToMemoryResult::InvalidURL:
+			return EDownloadToStorageResult::InvalidURL;
+		default:
+			return EDownloadToStorageResult::DownloadFailed;
+		}
+	}
+}
+
+FRuntimeDownloaderPool& FRuntimeDownloaderPool::Get()
+{
+	static FRuntimeDownloaderPool Pool;
+	return Pool;
+}
+
+TSharedRef<FRuntimeChunkDownloader> FRuntimeDownloaderPool::Acquire()
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		for (int32 Index = 0; Index < PooledDownloaders.Num(); ++Index)
+		{
+			// Downloaders still referenced by the continuations of their last download, or with requests still in flight, are left for later
+			if (PooledDownloaders[Index].IsUnique() && PooledDownloaders[Index]->TryResetForReuse())
+			{
+				TSharedRef<FRuntimeChunkDownloader> Downloader = PooledDownloaders[Index];
+				PooledDownloaders.RemoveAtSwap(Index);
+				return Downloader;
+			}
+		}
+	}
+	return MakeShared<FRuntimeChunkDownloader>();
+}
+
+void FRuntimeDownloaderPool::Release(TSharedRef<FRuntimeChunkDownloader>&& Downloader)
+{
+	FScopeLock Lock(&CriticalSection);
+	if (PooledDownloaders.Num() < MaxPooledDownloaders)
+	{
+		PooledDownloaders.Add(MoveTemp(Downloader));
+	}
+}
+
+void FRuntimeDownloaderPool::SetMaxPooledDownloaders(int32 InMaxPooledDownloaders)
+{
+	FScopeLock Lock(&CriticalSection);
+	MaxPooledDownloaders = FMath::Max(0, InMaxPooledDownloaders);
+	if (PooledDownloaders.Num() > MaxPooledDownloaders)
+	{
+		PooledDownloaders.RemoveAt(MaxPooledDownloaders, PooledDownloaders.Num() - MaxPooledDownloaders);
+	}
+}
+
+void FRuntimeDownloaderPool::Trim()
+{
+	FScopeLock Lock(&CriticalSection);
+	PooledDownloaders.Empty();
+}
+
+void FRuntimeDownloadHandle::Cancel() const
+{
+	if (!State.IsValid())
+	{
+		return;
+	}
+
+	TSharedPtr<FRuntimeChunkDownloader> Downloader;
+	{
+		FScopeLock Lock(&State->CriticalSection);
+		Downloader = State->Downloader;
+	}
+
+	// Canceling completes the requests in flight, whose completion takes the lock again
+	if (Downloader.IsValid())
+	{
+		Downloader->CancelDownload();
+	}
+}
+
+bool FRuntimeDownloadHandle::IsActive() const
+{
+	if (!State.IsValid())
+	{
+		return false;
+	}
+	FScopeLock Lock(&State->CriticalSection);
+	return State->Downloader.IsValid();
+}
+
+FRuntimeDownloadTelemetry FRuntimeDownloadHandle::GetTelemetry() const
+{
+	if (!State.IsValid())
+	{
+		return FRuntimeDownloadTelemetry();
+	}
+	FScopeLock Lock(&State->CriticalSection);
+	return State->Downloader.IsValid() ? State->Downloader->GetTelemetry() : State->Telemetry;
+}
+
+void FRuntimeDownloadHandle::Finish() const
+{
+	TSharedPtr<FRuntimeChunkDownloader> Downloader;
+	{
+		FScopeLock Lock(&State->CriticalSection);
+		Downloader = MoveTemp(State->Downloader);
+		if (Downloader.IsValid())
+		{
+			State->Telemetry = Downloader->GetTelemetry();
+		}
+	}
+
+	if (Downloader.IsValid())
+	{
+		FRuntimeDownloaderPool::Get().Release(Downloader.ToSharedRef());
+	}
+}
+
+FRuntimeDownloadHandle FRuntimeDownloads::StartDownload()
+{
+	TSharedRef<FRuntimeDownloadHandle::FState, ESPMode::ThreadSafe> State = MakeShared<FRuntimeDownloadHandle::FState, ESPMode::ThreadSafe>();
+	State->Downloader = FRuntimeDownloaderPool::Get().Acquire();
+	return FRuntimeDownloadHandle(State);
+}
+
+FRuntimeDownloadHandle FRuntimeDownloads::DownloadToMemory(const FRuntimeDownloadRequest& Request, TFunction<void(FRuntimeChunkDownloaderResult&&)> OnComplete, TFunction<void(int64, int64)> OnProgress)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeDownloads::DownloadToMemory);
+
+	FRuntimeDownloadHandle Handle = StartDownload();
+	const TSharedPtr<FRuntimeChunkDownloader> Downloader = Handle.State->Downloader;
+	TFunction<void(int64, int64)> OnProgressInternal = RuntimeDownloadHandle::GetProgressFunction(MoveTemp(OnProgress));
+
+	TFuture<FRuntimeChunkDownloaderResult> Future = Request.bForceByPayload
+		? Downloader->DownloadFileByPayload(Request.URL, Request.Timeout, Request.ContentType, OnProgressInternal, Request.Headers)
+		: Downloader->DownloadFile(Request.URL, Request.Timeout, Request.ContentType, Request.MaxChunkSize, OnProgressInternal, Request.Headers);
+
+	Future.Next([Handle, Executor = Request.CallbackExecutor, OnComplete = MoveTemp(OnComplete)](FRuntimeChunkDownloaderResult&& Result) mutable
+	{
+		Handle.Finish();
+		FRuntimeCallbackDispatcher::Get().Dispatch(Executor, [OnComplete = MoveTemp(OnComplete), Result = MoveTemp(Result)]() mutable
+		{
+			OnComplete(MoveTemp(Result));
+		});
+	});
+	return Handle;
+}
+
+FRuntimeDownloadHandle FRuntimeDownloads::DownloadToStorage(const FRuntimeDownloadRequest& Request, const FString& SavePath, TFunction<void(EDownloadToStorageResult, const FString&)> OnComplete, TFunction<void(int64, int64)> OnProgress)
+{
+	if (SavePath.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a path to save the file"));
+		FRuntimeCallbackDispatcher::Get().Dispatch(Request.CallbackExecutor, [OnComplete = MoveTemp(OnComplete)]()
+		{
+			OnComplete(EDownloadToStorageResult::InvalidSavePath, FString());
+		});
+		return FRuntimeDownloadHandle();
+	}
+
+	// The data is handed over to the file I/O queue right away, and only the final result is dispatched to the executor of the request
+	FRuntimeDownloadRequest MemoryRequest = Request;
+	MemoryRequest.CallbackExecutor = ERuntimeCallbackExecutor::HttpThread;
+
+	return DownloadToMemory(MemoryRequest, [SavePath, Executor = Request.CallbackExecutor, OnComplete = MoveTemp(OnComplete)](FRuntimeChunkDownloaderResult&& Result) mutable
+	{
+		if ((Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload) || Result.Data.Num() == 0)
+		{
+			const EDownloadToStorageResult FailureResult = Result.Result == EDownloadToMemoryResult::Success ? EDownloadToStorageResult::DownloadFailed : RuntimeDownloadHandle::ToStorageResult(Result.Result);
+			FRuntimeCallbackDispatcher::Get().Dispatch(Executor, [SavePath, FailureResult, OnComplete = MoveTemp(OnComplete)]()
+			{
+				OnComplete(FailureResult, SavePath);
+			});
+			return;
+		}
+
+		const EDownloadToStorageResult SuccessResult = RuntimeDownloadHandle::ToStorageResult(Result.Result);
+		FRuntimeFileIOQueue::Get().SaveArrayToFile(FRuntimeSharedBuffer::MakeOwned(MoveTemp(Result.Data)), SavePath, true, [SavePath, Executor, SuccessResult, OnComplete = MoveTemp(OnComplete)](bool bSuccess) mutable
+		{
+			FRuntimeCallbackDispatcher::Get().Dispatch(Executor, [SavePath, SuccessResult, bSuccess, OnComplete = MoveTemp(OnComplete)]()
+			{
+				OnComplete(bSuccess ? SuccessResult : EDownloadToStorageResult::SaveFailed, SavePath);
+			});
+		});
+	}, MoveTemp(OnProgress));
+}
+
+FRuntimeDownloadHandle FRuntimeDownloads::GetContentSize(const FRuntimeDownloadRequest& Request, TFunction<void(int64)> OnComplete)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeDownloads::GetContentSize);
+
+	FRuntimeDownloadHandle Handle = StartDownload();
+	Handle.State->Downloader->GetContentSize(Request.URL, Request.Timeout, Request.Headers).Next([Handle, Executor = Request.CallbackExecutor, OnComplete = MoveTemp(OnComplete)](int64 ContentSize) mutable
+	{
+		Handle.Finish();
+		FRuntimeCallbackDispatcher::Get().Dispatch(Executor, [OnComplete = MoveTemp(OnComplete), ContentSize]()
+		{
+			OnComplete(ContentSize);
+		});
+	});
+	return Handle;
+}
@@ -0,0 +1,148 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadMemoryBudget.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "Misc/ScopeLock.h"
+
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+LLM_DEFINE_TAG(RuntimeFilesDownloader);
+#endif
+
+FRuntimeMemoryReservation::FRuntimeMemoryReservation(int64 InSize, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& InRecorder)
+	: Size(InSize)
+	, Recorder(InRecorder)
+{
+	if (Recorder.IsValid())
+	{
+		Recorder->RecordMemoryReserved(Size);
+	}
+}
+
+FRuntimeMemoryReservation::~FRuntimeMemoryReservation()
+{
+	Release();
+}
+
+void FRuntimeMemoryReservation::Release()
+{
+	if (bReleased.exchange(true))
+	{
+		return;
+	}
+
+	if (Recorder.IsValid())
+	{
+		Recorder->RecordMemoryReserved(-Size);
+	}
+	FRuntimeDownloadMemoryBudget::Get().Release(Size);
+}
+
+FRuntimeDownloadMemoryBudget& FRuntimeDownloadMemoryBudget::Get()
+{
+	static FRuntimeDownloadMemoryBudget MemoryBudget;
+	return MemoryBudget;
+}
+
+FRuntimeDownloadMemoryBudget::FReservationPtr FRuntimeDownloadMemoryBudget::TryReserve(int64 Size, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	// Reservations are granted in submission order, so nothing can skip the queue
+	if (PendingReservations.Num() > 0 || !Fits_Locked(Size))
+	{
+		return nullptr;
+	}
+	return Reserve_Locked(Size, Recorder);
+}
+
+void FRuntimeDownloadMemoryBudget::Reserve(int64 Size, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder, TFunction<void(const FReservationPtr&)>&& OnReserved)
+{
+	FReservationPtr Reservation = TryReserve(Size, Recorder);
+	if (Reservation.IsValid())
+	{
+		OnReserved(Reservation);
+		return;
+	}
+
+	{
+		FScopeLock Lock(&CriticalSection);
+		PendingReservations.Add(FPendingReservation{Size, Recorder, MoveTemp(OnReserved)});
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Queued a reservation of %lld bytes: %lld of %lld bytes of the download memory budget are in use, %d reservations are queued"), Size, UsedBytes, Budget, PendingReservations.Num());
+	}
+
+	// Memory may have been released between the two locks, in which case nobody else would start the queued reservation
+	Release(0);
+}
+
+void FRuntimeDownloadMemoryBudget::SetBudget(int64 InBudget)
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		Budget = FMath::Max<int64>(0, InBudget);
+	}
+	Release(0);
+}
+
+int64 FRuntimeDownloadMemoryBudget::GetBudget() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return Budget;
+}
+
+int64 FRuntimeDownloadMemoryBudget::GetUsedBytes() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return UsedBytes;
+}
+
+int64 FRuntimeDownloadMemoryBudget::GetPeakUsedBytes() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return PeakUsedBytes;
+}
+
+int32 FRuntimeDownloadMemoryBudget::GetNumQueued() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return PendingReservations.Num();
+}
+
+void FRuntimeDownloadMemoryBudget::Release(int64 Size)
+{
+	TArray<TPair<FReservationPtr, TFunction<void(const FReservationPtr&)>>> Reservations;
+	{
+		FScopeLock Lock(&CriticalSection);
+		UsedBytes -= Size;
+		TakeFittingReservations_Locked(Reservations);
+	}
+
+	// The queued functions usually start requests, so they are called outside of the lock
+	for (TPair<FReservationPtr, TFunction<void(const FReservationPtr&)>>& Reservation : Reservations)
+	{
+		Reservation.Value(Reservation.Key);
+	}
+}
+
+FRuntimeDownloadMemoryBudget::FReservationPtr FRuntimeDownloadMemoryBudget::Reserve_Locked(int64 Size, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder)
+{
+	UsedBytes += Size;
+	PeakUsedBytes = FMath::Max(PeakUsedBytes, UsedBytes);
+	return MakeShared<FRuntimeMemoryReservation, ESPMode::ThreadSafe>(Size, Recorder);
+}
+
+bool FRuntimeDownloadMemoryBudget::Fits_Locked(int64 Size) const
+{
+	return Budget <= 0 || UsedBytes == 0 || UsedBytes + Size <= Budget;
+}
+
+void FRuntimeDownloadMemoryBudget::TakeFittingReservations_Locked(TArray<TPair<FReservationPtr, TFunction<void(const FReservationPtr&)>>>& OutReservations)
+{
+	int32 NumTaken = 0;
+	while (NumTaken < PendingReservations.Num() && Fits_Locked(PendingReservations[NumTaken].Size))
+	{
+		FPendingReservation& PendingReservation = PendingReservations[NumTaken];
+		OutReservations.Emplace(Reserve_Locked(PendingReservation.Size, PendingReservation.Recorder), MoveTemp(PendingReservation.OnReserved));
+		++NumTaken;
+	}
+	PendingReservations.RemoveAt(0, NumTaken);
+}
@@ -0,0 +1,219 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadTelemetry.h"
+#include "RuntimeDownloadMemoryBudget.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+void FRuntimeDownloadTelemetryRecorder::RecordRequestStarted(const FString& URL)
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (Telemetry.NumRequests == 0)
+		{
+			Telemetry.URL = URL;
+			StartTime = FPlatformTime::Seconds();
+		}
+		++Telemetry.NumRequests;
+	}
+
+	FRuntimeDownloadStats& Stats = FRuntimeDownloadStats::Get();
+	FScopeLock StatsLock(&Stats.CriticalSection);
+	++Stats.Totals.NumRequests;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordHeadLatency(double Latency)
+{
+	FScopeLock Lock(&CriticalSection);
+	Telemetry.HeadLatency = Latency;
+	LastCompletionTime = FPlatformTime::Seconds();
+}
+
+int32 FRuntimeDownloadTelemetryRecorder::BeginTransfer(int64 Offset)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	FRuntimeChunkTelemetry& Chunk = Telemetry.Chunks.AddDefaulted_GetRef();
+	Chunk.Offset = Offset;
+
+	FTransferTimes& Times = TransferTimes.AddDefaulted_GetRef();
+	Times.StartTime = FPlatformTime::Seconds();
+
+	return TransferTimes.Num() - 1;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordFirstByte(int32 TransferIndex)
+{
+	FScopeLock Lock(&CriticalSection);
+	if (!TransferTimes.IsValidIndex(TransferIndex) || TransferTimes[TransferIndex].FirstByteTime > 0)
+	{
+		return;
+	}
+
+	FTransferTimes& Times = TransferTimes[TransferIndex];
+	Times.FirstByteTime = FPlatformTime::Seconds();
+	Telemetry.Chunks[TransferIndex].TimeToFirstByte = Times.FirstByteTime - Times.StartTime;
+
+	if (Telemetry.TimeToFirstByte < 0)
+	{
+		Telemetry.TimeToFirstByte = Times.FirstByteTime - StartTime;
+	}
+}
+
+void FRuntimeDownloadTelemetryRecorder::EndTransfer(int32 TransferIndex, int64 Size, bool bSucceeded)
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (!TransferTimes.IsValidIndex(TransferIndex))
+		{
+			return;
+		}
+
+		FTransferTimes& Times = TransferTimes[TransferIndex];
+		Times.EndTime = FPlatformTime::Seconds();
+		LastCompletionTime = Times.EndTime;
+
+		FRuntimeChunkTelemetry& Chunk = Telemetry.Chunks[TransferIndex];
+		Chunk.Size = Size;
+		Chunk.Duration = Times.EndTime - Times.StartTime;
+		Chunk.BytesPerSecond = Chunk.Duration > 0 ? Size / Chunk.Duration : 0;
+		Chunk.bSucceeded = bSucceeded;
+
+		Telemetry.BytesReceived += Size;
+	}
+
+	FRuntimeDownloadStats& Stats = FRuntimeDownloadStats::Get();
+	FScopeLock StatsLock(&Stats.CriticalSection);
+	Stats.Totals.BytesReceived += Size;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordRetry()
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		++Telemetry.NumRetries;
+	}
+
+	FRuntimeDownloadStats& Stats = FRuntimeDownloadStats::Get();
+	FScopeLock StatsLock(&Stats.CriticalSection);
+	++Stats.Totals.NumRetries;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordPayloadFallback()
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		++Telemetry.NumPayloadFallbacks;
+	}
+
+	FRuntimeDownloadStats& Stats = FRuntimeDownloadStats::Get();
+	FScopeLock StatsLock(&Stats.CriticalSection);
+	++Stats.Totals.NumPayloadFallbacks;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordHedge()
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		++Telemetry.NumHedgedRequests;
+	}
+
+	FRuntimeDownloadStats& Stats = FRuntimeDownloadStats::Get();
+	FScopeLock StatsLock(&Stats.CriticalSection);
+	++Stats.Totals.NumHedgedRequests;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordHedgeWon()
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		++Telemetry.NumHedgeWins;
+	}
+
+	FRuntimeDownloadStats& Stats = FRuntimeDownloadStats::Get();
+	FScopeLock StatsLock(&Stats.CriticalSection);
+	++Stats.Totals.NumHedgeWins;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordChunkSize(int64 ChunkSize)
+{
+	FScopeLock Lock(&CriticalSection);
+	Telemetry.ChunkSize = ChunkSize;
+}
+
+void FRuntimeDownloadTelemetryRecorder::RecordMemoryReserved(int64 Delta)
+{
+	FScopeLock Lock(&CriticalSection);
+	Telemetry.MemoryBytes += Delta;
+	Telemetry.PeakMemoryBytes = FMath::Max(Telemetry.PeakMemoryBytes, Telemetry.MemoryBytes);
+}
+
+FRuntimeDownloadTelemetry FRuntimeDownloadTelemetryRecorder::GetTelemetry() const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	FRuntimeDownloadTelemetry Result = Telemetry;
+	Result.Duration = LastCompletionTime > StartTime ? LastCompletionTime - StartTime : 0;
+	Result.BytesPerSecond = Result.Duration > 0 ? Result.BytesReceived / Result.Duration : 0;
+	return Result;
+}
+
+FRuntimeDownloadStats& FRuntimeDownloadStats::Get()
+{
+	static FRuntimeDownloadStats Stats;
+	return Stats;
+}
+
+void FRuntimeDownloadStats::Register(const TSharedRef<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder)
+{
+	FScopeLock Lock(&CriticalSection);
+	++Totals.NumDownloads;
+	RecentRecorders.Add(Recorder);
+	if (RecentRecorders.Num() > MaxRecentDownloads)
+	{
+		RecentRecorders.RemoveAt(0, RecentRecorders.Num() - MaxRecentDownloads);
+	}
+}
+
+TArray<FRuntimeDownloadTelemetry> FRuntimeDownloadStats::GetRecentDownloads() const
+{
+	// The recorders are copied first so that their locks are never taken while holding the stats lock
+	TArray<TSharedRef<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>> Recorders;
+	{
+		FScopeLock Lock(&CriticalSection);
+		Recorders = RecentRecorders;
+	}
+
+	TArray<FRuntimeDownloadTelemetry> Downloads;
+	Downloads.Reserve(Recorders.Num());
+	for (const TSharedRef<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder : Recorders)
+	{
+		Downloads.Add(Recorder->GetTelemetry());
+	}
+	return Downloads;
+}
+
+FRuntimeDownloadStatsTotals FRuntimeDownloadStats::GetTotals() const
+{
+	FRuntimeDownloadStatsTotals Result;
+	{
+		FScopeLock Lock(&CriticalSection);
+		Result = Totals;
+	}
+
+	const FRuntimeDownloadMemoryBudget& MemoryBudget = FRuntimeDownloadMemoryBudget::Get();
+	Result.MemoryBytes = MemoryBudget.GetUsedBytes();
+	Result.PeakMemoryBytes = MemoryBudget.GetPeakUsedBytes();
+	Result.NumQueuedForMemory = MemoryBudget.GetNumQueued();
+	return Result;
+}
+
+void FRuntimeDownloadStats::SetMaxRecentDownloads(int32 InMaxRecentDownloads)
+{
+	FScopeLock Lock(&CriticalSection);
+	MaxRecentDownloads = FMath::Max(0, InMaxRecentDownloads);
+	if (RecentRecorders.Num() > MaxRecentDownloads)
+	{
+		RecentRecorders.RemoveAt(0, RecentRecorders.Num() - MaxRecentDownloads);
+	}
+}
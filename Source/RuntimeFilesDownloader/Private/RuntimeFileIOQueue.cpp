@@ -0,0 +1,249 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeFileIOQueue.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeDownloadMemoryBudget.h"
+#include "RuntimeTextDecoder.h"
+#include "Async/Async.h"
+#include "Async/AsyncFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Misc/Guid.h"
+#include "Misc/ScopeLock.h"
+
+namespace RuntimeFileIOQueue
+{
+	/** The size of a single read request. Several requests are issued at once so the platform layer can keep the device busy */
+	constexpr int64 ReadBlockSize = 16 * 1024 * 1024;
+}
+
+FRuntimeFileIOQueue& FRuntimeFileIOQueue::Get()
+{
+	static FRuntimeFileIOQueue Queue;
+	return Queue;
+}
+
+void FRuntimeFileIOQueue::LoadFileToArray(const FString& FilePath, TFunction<void(bool, TArray64<uint8>&&)> OnComplete)
+{
+	Enqueue([FilePath, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		TArray64<uint8> Data;
+		const bool bSuccess = ReadFile(FilePath, Data);
+		if (!bSuccess)
+		{
+			Data.Empty();
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [OnComplete = MoveTemp(OnComplete), bSuccess, Data = MoveTemp(Data)]() mutable
+		{
+			OnComplete(bSuccess, MoveTemp(Data));
+		});
+	});
+}
+
+void FRuntimeFileIOQueue::LoadFileToString(const FString& FilePath, TFunction<void(bool, FString&&)> OnComplete)
+{
+	Enqueue([FilePath, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		FString String;
+		bool bSuccess;
+		{
+			TArray64<uint8> Data;
+			bSuccess = ReadFile(FilePath, Data);
+			if (bSuccess)
+			{
+				String = FRuntimeTextDecoder::Decode(Data.GetData(), Data.Num());
+			}
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [OnComplete = MoveTemp(OnComplete), bSuccess, String = MoveTemp(String)]() mutable
+		{
+			OnComplete(bSuccess, MoveTemp(String));
+		});
+	});
+}
+
+void FRuntimeFileIOQueue::SaveArrayToFile(const FRuntimeSharedBuffer& Data, const FString& FilePath, bool bAtomic, TFunction<void(bool)> OnComplete)
+{
+	Enqueue([Data, FilePath, bAtomic, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		const bool bSuccess = WriteFile(FilePath, bAtomic, [&Data](const FString& WritePath)
+		{
+			TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*WritePath));
+			if (!Writer.IsValid())
+			{
+				return false;
+			}
+			Writer->Serialize(const_cast<uint8*>(Data.GetData()), Data.Num());
+			return Writer->Close();
+		});
+
+		// Release the data on the worker thread since it may be the last reference to a large buffer
+		Data = FRuntimeSharedBuffer();
+
+		AsyncTask(ENamedThreads::GameThread, [OnComplete = MoveTemp(OnComplete), bSuccess]()
+		{
+			OnComplete(bSuccess);
+		});
+	});
+}
+
+void FRuntimeFileIOQueue::SaveStringToFile(FString String, const FString& FilePath, bool bAtomic, TFunction<void(bool)> OnComplete)
+{
+	Enqueue([String = MoveTemp(String), FilePath, bAtomic, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		const bool bSuccess = WriteFile(FilePath, bAtomic, [&String](const FString& WritePath)
+		{
+			return FFileHelper::SaveStringToFile(String, *WritePath);
+		});
+
+		AsyncTask(ENamedThreads::GameThread, [OnComplete = MoveTemp(OnComplete), bSuccess]()
+		{
+			OnComplete(bSuccess);
+		});
+	});
+}
+
+void FRuntimeFileIOQueue::SetMaxConcurrentOperations(int32 InMaxConcurrentOperations)
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		MaxConcurrentOperations = FMath::Max(1, InMaxConcurrentOperations);
+	}
+	StartPendingOperations();
+}
+
+int32 FRuntimeFileIOQueue::GetMaxConcurrentOperations() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return MaxConcurrentOperations;
+}
+
+int32 FRuntimeFileIOQueue::GetNumPendingOperations() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return PendingOperations.Num();
+}
+
+void FRuntimeFileIOQueue::Enqueue(TFunction<void()>&& Operation)
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		PendingOperations.Add(MoveTemp(Operation));
+	}
+	StartPendingOperations();
+}
+
+void FRuntimeFileIOQueue::StartPendingOperations()
+{
+	FScopeLock Lock(&CriticalSection);
+	while (PendingOperations.Num() > 0 && NumActiveOperations < MaxConcurrentOperations)
+	{
+		++NumActiveOperations;
+		TFunction<void()> Operation = MoveTemp(PendingOperations[0]);
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+		PendingOperations.RemoveAt(0, 1, EAllowShrinking::No);
+#else
+		PendingOperations.RemoveAt(0, 1, false);
+#endif
+
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, Operation = MoveTemp(Operation)]()
+		{
+			Operation();
+
+			{
+				FScopeLock Lock(&CriticalSection);
+				--NumActiveOperations;
+			}
+			StartPendingOperations();
+		});
+	}
+}
+
+bool FRuntimeFileIOQueue::ReadFile(const FString& FilePath, TArray64<uint8>& OutData)
+{
+	TUniquePtr<IAsyncReadFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenAsyncRead(*FilePath));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the file '%s' for reading"), *FilePath);
+		return false;
+	}
+
+	int64 FileSize;
+	{
+		TUniquePtr<IAsyncReadRequest> SizeRequest(FileHandle->SizeRequest());
+		if (!SizeRequest.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to request the size of the file '%s'"), *FilePath);
+			return false;
+		}
+		SizeRequest->WaitCompletion();
+		FileSize = SizeRequest->GetSizeResults();
+	}
+
+	if (FileSize < 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the file '%s': the file does not exist"), *FilePath);
+		return false;
+	}
+
+	{
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+		OutData.SetNumUninitialized(FileSize);
+	}
+
+	// All read requests must be destroyed before the file handle is
+	bool bSuccess = true;
+	{
+		TArray<TUniquePtr<IAsyncReadRequest>> ReadRequests;
+		for (int64 Offset = 0; Offset < FileSize; Offset += RuntimeFileIOQueue::ReadBlockSize)
+		{
+			const int64 BlockSize = FMath::Min(RuntimeFileIOQueue::ReadBlockSize, FileSize - Offset);
+			ReadRequests.Emplace(FileHandle->ReadRequest(Offset, BlockSize, AIOP_Normal, nullptr, OutData.GetData() + Offset));
+		}
+
+		for (TUniquePtr<IAsyncReadRequest>& ReadRequest : ReadRequests)
+		{
+			if (!ReadRequest.IsValid())
+			{
+				bSuccess = false;
+				continue;
+			}
+			ReadRequest->WaitCompletion();
+			bSuccess &= ReadRequest->GetReadResults() != nullptr;
+		}
+	}
+
+	if (!bSuccess)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read %lld bytes from the file '%s'"), FileSize, *FilePath);
+	}
+	return bSuccess;
+}
+
+bool FRuntimeFileIOQueue::WriteFile(const FString& FilePath, bool bAtomic, TFunctionRef<bool(const FString&)> WriteFunction)
+{
+	// The temporary file is placed next to the destination so that the rename does not cross volumes
+	const FString WritePath = bAtomic ? FString::Printf(TEXT("%s.%s.tmp"), *FilePath, *FGuid::NewGuid().ToString()) : FilePath;
+
+	if (!WriteFunction(WritePath))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to write the file '%s'"), *WritePath);
+		if (bAtomic)
+		{
+			IFileManager::Get().Delete(*WritePath, false, true, true);
+		}
+		return false;
+	}
+
+	if (bAtomic && !IFileManager::Get().Move(*FilePath, *WritePath, true, true))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to move the temporary file '%s' to '%s'"), *WritePath, *FilePath);
+		IFileManager::Get().Delete(*WritePath, false, true, true);
+		return false;
+	}
+
+	return true;
+}
@@ -2,19 +2,39 @@
 
 #include "RuntimeFilesDownloader.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeCallbackDispatcher.h"
+#include "RuntimeChunkBufferPool.h"
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadHandle.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "RuntimeProgressAggregator.h"
+#include "RuntimeStallMonitor.h"
 
 #define LOCTEXT_NAMESPACE "FRuntimeFilesDownloaderModule"
 
 void FRuntimeFilesDownloaderModule::StartupModule()
 {
+	// Remove temporary files of spilled downloads left over by previous sessions, leaving those of running processes alone
+	FRuntimeChunkDownloader::DeleteStaleSpillDirectories();
 }
 
 void FRuntimeFilesDownloaderModule::ShutdownModule()
 {
+	FRuntimeProgressAggregator::Get().Shutdown();
+	FRuntimeStallMonitor::Get().Shutdown();
+	FRuntimeCallbackDispatcher::Get().Shutdown();
+	FRuntimeChunkBufferPool::Get().Trim();
+	FRuntimeDownloaderPool::Get().Trim();
 }
 
 #undef LOCTEXT_NAMESPACE
 	
 IMPLEMENT_MODULE(FRuntimeFilesDownloaderModule, RuntimeFilesDownloader)
 
-DEFINE_LOG_CATEGORY(LogRuntimeFilesDownloader);
\ No newline at end of file
+DEFINE_LOG_CATEGORY(LogRuntimeFilesDownloader);
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+TRACE_DECLARE_INT_COUNTER(RuntimeFilesDownloader_BytesInFlight, TEXT("RuntimeFilesDownloader/BytesInFlight"));
+TRACE_DECLARE_INT_COUNTER(RuntimeFilesDownloader_ActiveRequests, TEXT("RuntimeFilesDownloader/ActiveRequests"));
+TRACE_DECLARE_INT_COUNTER(RuntimeFilesDownloader_BufferedBytes, TEXT("RuntimeFilesDownloader/BufferedBytes"));
+#endif
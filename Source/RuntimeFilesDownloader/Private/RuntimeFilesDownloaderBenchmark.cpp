@@ -0,0 +1,722 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeFilesDownloaderDefines.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "RuntimeChunkBufferPool.h"
+#include "RuntimeChunkDownloader.h"
+#include "FileFromStorageUploader.h"
+#include "FileToMemoryDownloader.h"
+#include "RuntimeDownloadHandle.h"
+#include "RuntimeNetworkSimulator.h"
+#include "RuntimeStallMonitor.h"
+#include "RuntimeTextDecoder.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/MemoryBase.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/**
+ * Benchmark of the download and upload paths, run with the "RuntimeFilesDownloader.Benchmark" console command against any HTTP server (e.g. a local one serving files of different sizes)
+ * Each scenario uses a fresh downloader and reports throughput, requests per second, peak memory and allocations per MB as JSON in the Saved directory
+ * Scenarios delivering the file chunk by chunk also report the allocations and the time per chunk, to measure the overhead of the chunk engine independently of the file size
+ * The decode scenarios compare FRuntimeTextDecoder with the per-character loop BytesToString used before it, timing only the decoding of the downloaded file
+ * The "RuntimeFilesDownloader.NetworkScenario" console command runs the same scenarios under simulated network conditions and checks them against a time and memory budget
+ * The "RuntimeFilesDownloader.RequestOverheadBenchmark" console command compares the per-request overhead of the UObject downloaders with the native download handles
+ * The "RuntimeFilesDownloader.StallHitchCheck" console command checks that the stall monitor tells a hitch of the game thread from a stalled request, without any server
+ */
+namespace RuntimeFilesDownloaderBenchmark
+{
+	/** The timeout used for every request of the benchmark, in seconds */
+	constexpr float Timeout = 600.f;
+
+	/** The outcome of running a single scenario */
+	struct FScenarioOutcome
+	{
+		bool bSuccess = false;
+		int64 Bytes = 0;
+
+		/** The number of chunks delivered, 0 if the scenario does not deliver chunks */
+		int64 Chunks = 0;
+
+		/** Whether the scenario measured its time and allocations itself, e.g. to leave out the download of the data it processes */
+		bool bSelfMeasured = false;
+		double Seconds = 0;
+		uint64 Allocations = 0;
+	};
+
+	/** A scenario, started with a fresh downloader and a function to be called on progress */
+	using FScenario = TFunction<TFuture<FScenarioOutcome>(const TSharedRef<FRuntimeChunkDownloader>&, const TFunction<void(int64, int64)>&)>;
+
+	/** A named scenario along with the URL it transfers from or to */
+	struct FScenarioDesc
+	{
+		FString Name;
+		FString URL;
+		FScenario Run;
+
+		/** The time the scenario is expected to complete in, in seconds, 0 for no limit */
+		double MaxSeconds = 0;
+
+		/** The peak memory the scenario is expected to stay under, in bytes, 0 for no limit */
+		int64 MaxPeakMemoryBytes = 0;
+	};
+
+	/** The measured result of a scenario */
+	struct FScenarioResult
+	{
+		FString Name;
+		FString URL;
+		bool bSuccess = false;
+		int64 Bytes = 0;
+		int64 Chunks = 0;
+		int64 Requests = 0;
+		double Seconds = 0;
+		int64 PeakMemoryBytes = 0;
+		uint64 Allocations = 0;
+
+		/** Whether the scenario succeeded within its time and memory budget */
+		bool bPassed = false;
+	};
+
+	uint64 GetTotalAllocations()
+	{
+		return static_cast<uint64>(FMalloc::TotalMallocCalls) + static_cast<uint64>(FMalloc::TotalReallocCalls);
+	}
+
+	int64 GetUsedMemory()
+	{
+		return static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical);
+	}
+
+	bool IsSuccess(EDownloadToMemoryResult Result)
+	{
+		return Result == EDownloadToMemoryResult::Success || Result == EDownloadToMemoryResult::SucceededByPayload;
+	}
+
+	/**
+	 * Runs the scenarios one after another and writes the results once all of them have finished
+	 */
+	class FBenchmarkRun : public TSharedFromThis<FBenchmarkRun>
+	{
+	public:
+		explicit FBenchmarkRun(TArray<FScenarioDesc>&& InScenarios, TFunction<void()> InOnFinished = nullptr)
+			: Scenarios(MoveTemp(InScenarios))
+			, OnFinished(MoveTemp(InOnFinished))
+		{
+		}
+
+		void RunNextScenario()
+		{
+			if (Results.Num() >= Scenarios.Num())
+			{
+				WriteResults();
+				if (OnFinished)
+				{
+					OnFinished();
+				}
+				return;
+			}
+
+			const FScenarioDesc& Scenario = Scenarios[Results.Num()];
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Benchmark: running '%s' (%s)"), *Scenario.Name, *Scenario.URL);
+
+			TSharedRef<FRuntimeChunkDownloader> Downloader = MakeShared<FRuntimeChunkDownloader>();
+			const TSharedRef<FBenchmarkRun> SharedThis = AsShared();
+			const TSharedRef<int64> BaselineMemory = MakeShared<int64>(GetUsedMemory());
+			const TSharedRef<int64> PeakMemory = MakeShared<int64>(*BaselineMemory);
+			const uint64 StartAllocations = GetTotalAllocations();
+			const double StartTime = FPlatformTime::Seconds();
+
+			Scenario.Run(Downloader, [PeakMemory](int64 BytesReceived, int64 ContentSize)
+			{
+				*PeakMemory = FMath::Max(*PeakMemory, GetUsedMemory());
+			}).Next([SharedThis, Downloader, BaselineMemory, PeakMemory, StartAllocations, StartTime](FScenarioOutcome Outcome)
+			{
+				const FScenarioDesc& Scenario = SharedThis->Scenarios[SharedThis->Results.Num()];
+
+				FScenarioResult Result;
+				Result.Name = Scenario.Name;
+				Result.URL = Scenario.URL;
+				Result.bSuccess = Outcome.bSuccess;
+				Result.Bytes = Outcome.Bytes;
+				Result.Chunks = Outcome.Chunks;
+				Result.Requests = Downloader->GetNumStartedRequests();
+				Result.Seconds = Outcome.bSelfMeasured ? Outcome.Seconds : FPlatformTime::Seconds() - StartTime;
+				Result.PeakMemoryBytes = FMath::Max<int64>(0, FMath::Max(*PeakMemory, GetUsedMemory()) - *BaselineMemory);
+				Result.Allocations = Outcome.bSelfMeasured ? Outcome.Allocations : GetTotalAllocations() - StartAllocations;
+				Result.bPassed = Result.bSuccess
+					&& (Scenario.MaxSeconds <= 0 || Result.Seconds <= Scenario.MaxSeconds)
+					&& (Scenario.MaxPeakMemoryBytes <= 0 || Result.PeakMemoryBytes <= Scenario.MaxPeakMemoryBytes);
+
+				UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Benchmark: '%s' %s, %lld bytes in %.3f s (%.2f MB/s, %.1f requests/s)"), *Result.Name, Result.bSuccess ? TEXT("succeeded") : TEXT("failed"), Result.Bytes, Result.Seconds, GetMegabytesPerSecond(Result), GetRequestsPerSecond(Result));
+				if (!Result.bPassed && (Scenario.MaxSeconds > 0 || Scenario.MaxPeakMemoryBytes > 0))
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Benchmark: '%s' FAILED its budget (%.3f s of %.3f s allowed, %lld bytes of peak memory of %lld allowed)"), *Result.Name, Result.Seconds, Scenario.MaxSeconds, Result.PeakMemoryBytes, Scenario.MaxPeakMemoryBytes);
+				}
+
+				if (Result.Chunks > 0)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Benchmark: '%s' delivered %lld chunks, %.1f allocations and %.3f ms per chunk"), *Result.Name, Result.Chunks, GetAllocationsPerChunk(Result), GetMillisecondsPerChunk(Result));
+				}
+
+				SharedThis->Results.Add(MoveTemp(Result));
+				SharedThis->RunNextScenario();
+			});
+		}
+
+	private:
+		static double GetMegabytesPerSecond(const FScenarioResult& Result)
+		{
+			return Result.Seconds > 0 ? Result.Bytes / (1024.0 * 1024.0) / Result.Seconds : 0;
+		}
+
+		static double GetRequestsPerSecond(const FScenarioResult& Result)
+		{
+			return Result.Seconds > 0 ? Result.Requests / Result.Seconds : 0;
+		}
+
+		static double GetAllocationsPerChunk(const FScenarioResult& Result)
+		{
+			return Result.Chunks > 0 ? static_cast<double>(Result.Allocations) / Result.Chunks : 0;
+		}
+
+		static double GetMillisecondsPerChunk(const FScenarioResult& Result)
+		{
+			return Result.Chunks > 0 ? Result.Seconds * 1000 / Result.Chunks : 0;
+		}
+
+		void WriteResults() const
+		{
+			FString Json = TEXT("{\n\t\"scenarios\": [\n");
+			for (int32 Index = 0; Index < Results.Num(); ++Index)
+			{
+				const FScenarioResult& Result = Results[Index];
+				const double Megabytes = Result.Bytes / (1024.0 * 1024.0);
+				Json += FString::Printf(TEXT("\t\t{\"name\": \"%s\", \"url\": \"%s\", \"success\": %s, \"bytes\": %lld, \"seconds\": %.6f, \"mb_per_sec\": %.3f, \"requests\": %lld, \"requests_per_sec\": %.3f, \"peak_memory_bytes\": %lld, \"allocations\": %llu, \"allocations_per_mb\": %.3f, \"chunks\": %lld, \"allocations_per_chunk\": %.3f, \"ms_per_chunk\": %.3f, \"passed\": %s}%s\n"),
+					*Result.Name, *Result.URL.ReplaceCharWithEscapedChar(), Result.bSuccess ? TEXT("true") : TEXT("false"), Result.Bytes, Result.Seconds, GetMegabytesPerSecond(Result), Result.Requests, GetRequestsPerSecond(Result), Result.PeakMemoryBytes, Result.Allocations, Megabytes > 0 ? Result.Allocations / Megabytes : 0.0, Result.Chunks, GetAllocationsPerChunk(Result), GetMillisecondsPerChunk(Result), Result.bPassed ? TEXT("true") : TEXT("false"),
+					Index + 1 < Results.Num() ? TEXT(",") : TEXT(""));
+			}
+			Json += TEXT("\t]\n}\n");
+
+			const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RuntimeFilesDownloader"), TEXT("Benchmark"), FString::Printf(TEXT("%s.json"), *FDateTime::Now().ToString()));
+			if (FFileHelper::SaveStringToFile(Json, *FilePath))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Benchmark: results written to %s"), *FilePath);
+			}
+			else
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Benchmark: unable to write the results to %s"), *FilePath);
+			}
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("%s"), *Json);
+		}
+
+		TArray<FScenarioDesc> Scenarios;
+		TArray<FScenarioResult> Results;
+
+		/** Called once all scenarios have finished and the results have been written */
+		TFunction<void()> OnFinished;
+	};
+
+	/**
+	 * Add the scenarios transferring a single file: by payload, by chunks of different sizes, into a temporary file and as a backpressured stream
+	 */
+	void AddFileScenarios(TArray<FScenarioDesc>& Scenarios, const FString& URL)
+	{
+		Scenarios.Add({TEXT("payload"), URL, [URL](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+		{
+			return Downloader->DownloadFileByPayload(URL, Timeout, FString(), OnProgress).Next([](FRuntimeChunkDownloaderResult Result)
+			{
+				return FScenarioOutcome{IsSuccess(Result.Result), Result.Data.Num()};
+			});
+		}});
+
+		for (const int64 ChunkSize : {1024 * 1024, 8 * 1024 * 1024, 64 * 1024 * 1024})
+		{
+			Scenarios.Add({FString::Printf(TEXT("chunked_memory_%lldMB"), ChunkSize / (1024 * 1024)), URL, [URL, ChunkSize](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+			{
+				return Downloader->DownloadFile(URL, Timeout, FString(), ChunkSize, OnProgress).Next([](FRuntimeChunkDownloaderResult Result)
+				{
+					return FScenarioOutcome{IsSuccess(Result.Result), Result.Data.Num()};
+				});
+			}});
+		}
+
+		// Small chunks make the per-chunk overhead of the chunk engine dominate the transfer itself
+		for (const int64 ChunkSize : {64 * 1024, 1024 * 1024})
+		{
+			Scenarios.Add({FString::Printf(TEXT("per_chunk_%lldKB"), ChunkSize / 1024), URL, [URL, ChunkSize](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+			{
+				TSharedRef<FScenarioOutcome> Outcome = MakeShared<FScenarioOutcome>();
+				return Downloader->DownloadFilePerChunk(URL, Timeout, FString(), ChunkSize, FInt64Vector2(), OnProgress, [Outcome](TArray64<uint8>&& Chunk)
+				{
+					Outcome->Bytes += Chunk.Num();
+					++Outcome->Chunks;
+					FRuntimeChunkBufferPool::Get().Release(MoveTemp(Chunk));
+				}).Next([Outcome](EDownloadToMemoryResult Result)
+				{
+					Outcome->bSuccess = IsSuccess(Result);
+					return *Outcome;
+				});
+			}});
+		}
+
+		Scenarios.Add({TEXT("chunked_storage_8MB"), URL, [URL](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+		{
+			// A spill threshold of 0 writes every download to a temporary file
+			return Downloader->DownloadFileHybrid(URL, Timeout, FString(), 8 * 1024 * 1024, 0, OnProgress).Next([](FRuntimeChunkDownloaderSharedResult Result)
+			{
+				return FScenarioOutcome{IsSuccess(Result.Result), Result.Data.Num()};
+			});
+		}});
+
+		Scenarios.Add({TEXT("streamed_8MB_x4"), URL, [URL](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+		{
+			TSharedRef<int64> StreamedBytes = MakeShared<int64>(0);
+			return Downloader->DownloadFileStreamed(URL, Timeout, FString(), 8 * 1024 * 1024, 4, OnProgress, [StreamedBytes](FRuntimeStreamedChunk& Chunk)
+			{
+				*StreamedBytes += Chunk.Data.Num();
+				Chunk.Acknowledge();
+			}).Next([StreamedBytes](EDownloadToMemoryResult Result)
+			{
+				return FScenarioOutcome{IsSuccess(Result), *StreamedBytes};
+			});
+		}});
+	}
+
+	/**
+	 * Add the scenario downloading many small ranges of a file at the same time, standing in for many small files
+	 */
+	void AddManySmallFilesScenario(TArray<FScenarioDesc>& Scenarios, const FString& URL)
+	{
+		constexpr int32 NumFiles = 64;
+		constexpr int64 FileSize = 16 * 1024;
+
+		Scenarios.Add({TEXT("many_small_files_64x16KB"), URL, [URL](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+		{
+			TSharedRef<TPromise<FScenarioOutcome>> Promise = MakeShared<TPromise<FScenarioOutcome>>();
+			Downloader->GetContentSize(URL, Timeout, {}).Next([Downloader, Promise, URL, OnProgress](int64 ContentSize)
+			{
+				if (ContentSize <= 0)
+				{
+					Promise->SetValue(FScenarioOutcome{false, 0});
+					return;
+				}
+
+				TSharedRef<FScenarioOutcome> Outcome = MakeShared<FScenarioOutcome>(FScenarioOutcome{true, 0});
+				TSharedRef<int32> NumRemaining = MakeShared<int32>(NumFiles);
+				for (int32 Index = 0; Index < NumFiles; ++Index)
+				{
+					const int64 Start = (Index * FileSize) % ContentSize;
+					const int64 End = FMath::Min(Start + FileSize, ContentSize) - 1;
+					Downloader->DownloadFileByChunk(URL, Timeout, FString(), ContentSize, FInt64Vector2(Start, End), OnProgress).Next([Promise, Outcome, NumRemaining](FRuntimeChunkDownloaderResult Result)
+					{
+						Outcome->bSuccess &= IsSuccess(Result.Result);
+						Outcome->Bytes += Result.Data.Num();
+						if (--*NumRemaining == 0)
+						{
+							Promise->SetValue(*Outcome);
+						}
+					});
+				}
+			});
+			return Promise->GetFuture();
+		}});
+	}
+
+	/**
+	 * Add the scenarios decoding a downloaded file into a string several times, with the per-character loop BytesToString used before FRuntimeTextDecoder and with the decoder
+	 */
+	void AddDecodeScenarios(TArray<FScenarioDesc>& Scenarios, const FString& URL)
+	{
+		constexpr int32 NumIterations = 8;
+
+		auto AddDecodeScenario = [&Scenarios, &URL](const TCHAR* Name, TFunction<FString(const TArray64<uint8>&)> Decode)
+		{
+			Scenarios.Add({Name, URL, [URL, Decode](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+			{
+				return Downloader->DownloadFileByPayload(URL, Timeout, FString(), OnProgress).Next([Decode](FRuntimeChunkDownloaderResult Result)
+				{
+					FScenarioOutcome Outcome{IsSuccess(Result.Result) && Result.Data.Num() > 0, 0};
+					Outcome.bSelfMeasured = true;
+
+					const uint64 StartAllocations = GetTotalAllocations();
+					const double StartTime = FPlatformTime::Seconds();
+					for (int32 Iteration = 0; Outcome.bSuccess && Iteration < NumIterations; ++Iteration)
+					{
+						Outcome.bSuccess = !Decode(Result.Data).IsEmpty();
+						Outcome.Bytes += Result.Data.Num();
+					}
+					Outcome.Seconds = FPlatformTime::Seconds() - StartTime;
+					Outcome.Allocations = GetTotalAllocations() - StartAllocations;
+					return Outcome;
+				});
+			}});
+		};
+
+		AddDecodeScenario(TEXT("decode_per_character"), [](const TArray64<uint8>& Bytes)
+		{
+			FString Text;
+			for (int64 Index = 0; Index < Bytes.Num(); ++Index)
+			{
+				Text += static_cast<TCHAR>(Bytes[Index]);
+			}
+			return Text;
+		});
+
+		AddDecodeScenario(TEXT("decode_text_decoder"), [](const TArray64<uint8>& Bytes)
+		{
+			return FRuntimeTextDecoder::Decode(Bytes.GetData(), Bytes.Num());
+		});
+	}
+
+	/**
+	 * Add the scenario uploading a generated body
+	 */
+	void AddUploadScenario(TArray<FScenarioDesc>& Scenarios, const FString& URL)
+	{
+		constexpr int32 BodySize = 8 * 1024 * 1024;
+
+		Scenarios.Add({TEXT("upload_8MB"), URL, [URL](const TSharedRef<FRuntimeChunkDownloader>& Downloader, const TFunction<void(int64, int64)>& OnProgress)
+		{
+			TArray<uint8> Body;
+			Body.SetNumUninitialized(BodySize);
+			for (int32 Index = 0; Index < BodySize; ++Index)
+			{
+				Body[Index] = static_cast<uint8>(Index * 31);
+			}
+			return Downloader->UploadFile(URL, Timeout, Body, OnProgress).Next([](FRuntimeChunkUploaderResult Result)
+			{
+				return FScenarioOutcome{Result.Result == EUploadFromStorageResult::Success, Result.Result == EUploadFromStorageResult::Success ? BodySize : 0};
+			});
+		}});
+	}
+
+	void Run(const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Usage: RuntimeFilesDownloader.Benchmark <URL>[,<URL>...] [UploadURL]\nServe files of the sizes of interest (e.g. 1 KB to 4 GB) from a local HTTP server with Range and HEAD support and pass their URLs"));
+			return;
+		}
+
+		TArray<FString> URLs;
+		Args[0].ParseIntoArray(URLs, TEXT(","));
+
+		TArray<FScenarioDesc> Scenarios;
+		for (const FString& URL : URLs)
+		{
+			AddFileScenarios(Scenarios, URL);
+		}
+		if (URLs.Num() > 0)
+		{
+			AddManySmallFilesScenario(Scenarios, URLs[0]);
+			AddDecodeScenarios(Scenarios, URLs[0]);
+		}
+		if (Args.Num() > 1)
+		{
+			AddUploadScenario(Scenarios, Args[1]);
+		}
+
+		MakeShared<FBenchmarkRun>(MoveTemp(Scenarios))->RunNextScenario();
+	}
+
+	/**
+	 * Run the file scenarios under the conditions of a network simulation profile, checking each one against a time and memory budget
+	 * The previous simulated conditions are restored once all scenarios have finished
+	 */
+	void RunNetworkScenario(const TArray<FString>& Args)
+	{
+		FRuntimeNetworkConditions Conditions;
+		if (Args.Num() < 2 || !FRuntimeNetworkSimulator::GetProfile(Args[0], Conditions))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Usage: RuntimeFilesDownloader.NetworkScenario <off|mobile|lossy|stalls|wrong_length> <URL>[,<URL>...] [MaxSeconds] [MaxPeakMemoryMB]"));
+			return;
+		}
+
+		TArray<FString> URLs;
+		Args[1].ParseIntoArray(URLs, TEXT(","));
+		const double MaxSeconds = Args.Num() > 2 ? FCString::Atod(*Args[2]) : 0;
+		const int64 MaxPeakMemoryBytes = Args.Num() > 3 ? FCString::Atoi64(*Args[3]) * 1024 * 1024 : 0;
+
+		TArray<FScenarioDesc> Scenarios;
+		for (const FString& URL : URLs)
+		{
+			AddFileScenarios(Scenarios, URL);
+		}
+		for (FScenarioDesc& Scenario : Scenarios)
+		{
+			Scenario.Name = FString::Printf(TEXT("%s_%s"), *Args[0], *Scenario.Name);
+			Scenario.MaxSeconds = MaxSeconds;
+			Scenario.MaxPeakMemoryBytes = MaxPeakMemoryBytes;
+		}
+
+		const FRuntimeNetworkConditions PreviousConditions = FRuntimeNetworkSimulator::Get().GetConditions();
+		FRuntimeNetworkSimulator::Get().SetConditions(Conditions);
+		MakeShared<FBenchmarkRun>(MoveTemp(Scenarios), [PreviousConditions]()
+		{
+			FRuntimeNetworkSimulator::Get().SetConditions(PreviousConditions);
+		})->RunNextScenario();
+	}
+
+	/**
+	 * Issues the same number of small downloads through the UObject downloaders and then through the native download handles, measuring the cost of issuing them
+	 */
+	class FRequestOverheadRun : public TSharedFromThis<FRequestOverheadRun>
+	{
+	public:
+		FRequestOverheadRun(const FString& InURL, int32 InNumRequests)
+			: URL(InURL)
+			, NumRequests(InNumRequests)
+		{
+		}
+
+		void RunUObjectPath()
+		{
+			const TSharedRef<FRequestOverheadRun> SharedThis = AsShared();
+			Begin(TEXT("UObject"));
+			for (int32 Index = 0; Index < NumRequests; ++Index)
+			{
+				UFileToMemoryDownloader::DownloadFileToMemory(URL, Timeout, FString(), true, FOnDownloadProgressNative(), FOnFileToMemoryDownloadCompleteNative::CreateLambda([SharedThis](const TArray64<uint8>& Data, EDownloadToMemoryResult Result)
+				{
+					SharedThis->OnRequestComplete(IsSuccess(Result), [SharedThis]()
+					{
+						SharedThis->RunNativePath();
+					});
+				}));
+			}
+			EndIssuing();
+		}
+
+		void RunNativePath()
+		{
+			const TSharedRef<FRequestOverheadRun> SharedThis = AsShared();
+			FRuntimeDownloadRequest Request;
+			Request.URL = URL;
+			Request.Timeout = Timeout;
+			Request.bForceByPayload = true;
+
+			Begin(TEXT("Native"));
+			for (int32 Index = 0; Index < NumRequests; ++Index)
+			{
+				FRuntimeDownloads::DownloadToMemory(Request, [SharedThis](FRuntimeChunkDownloaderResult&& Result)
+				{
+					SharedThis->OnRequestComplete(IsSuccess(Result.Result), []() {});
+				});
+			}
+			EndIssuing();
+		}
+
+	private:
+		void Begin(const TCHAR* InPathName)
+		{
+			PathName = InPathName;
+			NumCompleted = 0;
+			NumSucceeded = 0;
+			StartAllocations = GetTotalAllocations();
+			StartTime = FPlatformTime::Seconds();
+		}
+
+		void EndIssuing()
+		{
+			const double IssueSeconds = FPlatformTime::Seconds() - StartTime;
+			const uint64 IssueAllocations = GetTotalAllocations() - StartAllocations;
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Request overhead benchmark: '%s' issued %d requests in %.3f ms (%.2f us and %.1f allocations per request)"), *PathName, NumRequests, IssueSeconds * 1000, IssueSeconds * 1000000 / NumRequests, static_cast<double>(IssueAllocations) / NumRequests);
+		}
+
+		void OnRequestComplete(bool bSuccess, TFunction<void()>&& OnAllComplete)
+		{
+			++NumCompleted;
+			NumSucceeded += bSuccess ? 1 : 0;
+			if (NumCompleted < NumRequests)
+			{
+				return;
+			}
+
+			const double Seconds = FPlatformTime::Seconds() - StartTime;
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Request overhead benchmark: '%s' completed %d requests (%d succeeded) in %.3f s, %.1f allocations per request in total"), *PathName, NumCompleted, NumSucceeded, Seconds, static_cast<double>(GetTotalAllocations() - StartAllocations) / NumRequests);
+			OnAllComplete();
+		}
+
+		FString URL;
+		int32 NumRequests;
+		FString PathName;
+		int32 NumCompleted = 0;
+		int32 NumSucceeded = 0;
+		uint64 StartAllocations = 0;
+		double StartTime = 0;
+	};
+
+	void RunRequestOverhead(const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Usage: RuntimeFilesDownloader.RequestOverheadBenchmark <URL> [NumRequests=1000]\nServe a small file from a local HTTP server, so that the time to issue the requests dominates the transfer"));
+			return;
+		}
+
+		const int32 NumRequests = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1000;
+		MakeShared<FRequestOverheadRun>(Args[0], NumRequests)->RunUObjectPath();
+	}
+
+	/**
+	 * Reports progress for a simulated request every frame, blocks the game thread once in between, then stops reporting
+	 * The check passes if the hitch is not reported as a stall while the silence after it is
+	 */
+	class FStallHitchCheck : public TSharedFromThis<FStallHitchCheck>
+	{
+	public:
+		explicit FStallHitchCheck(float InHitchSeconds)
+			: HitchSeconds(InHitchSeconds)
+		{
+		}
+
+		void Start()
+		{
+			FRuntimeLowSpeedLimit Limit;
+			Limit.IdleTimeout = IdleTimeout;
+
+			const TWeakPtr<FStallHitchCheck> WeakThisPtr = AsShared();
+			Handle = FRuntimeStallMonitor::Get().Register(TEXT("StallHitchCheck"), Limit, [WeakThisPtr]()
+			{
+				if (const TSharedPtr<FStallHitchCheck> SharedThis = WeakThisPtr.Pin())
+				{
+					SharedThis->OnStalled();
+				}
+			});
+			StartTime = FPlatformTime::Seconds();
+
+			const TSharedRef<FStallHitchCheck> SharedThis = AsShared();
+			auto TickerFunction = [SharedThis](float DeltaTime)
+			{
+				return SharedThis->Step();
+			};
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+			FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)));
+#else
+			FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)));
+#endif
+		}
+
+	private:
+		enum class EPhase : uint8
+		{
+			/** Progress is reported every frame, with a single hitch in between */
+			Reporting,
+			/** No progress is reported anymore, so the monitor has to report a stall */
+			Silent,
+			Done
+		};
+
+		bool Step()
+		{
+			const double Now = FPlatformTime::Seconds();
+			switch (Phase)
+			{
+			case EPhase::Reporting:
+				// The progress held back by a hitch may be dispatched a few checks after it, so reporting resumes with a delay
+				if (!bHitched || Now - HitchEndTime > IdleTimeout / 2)
+				{
+					BytesReported += 1024;
+					FRuntimeStallMonitor::Get().Report(Handle, BytesReported);
+				}
+				if (!bHitched && Now - StartTime > 1)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Stall hitch check: blocking the game thread for %.2f seconds"), HitchSeconds);
+					bHitched = true;
+					FPlatformProcess::Sleep(HitchSeconds);
+					HitchEndTime = FPlatformTime::Seconds();
+				}
+				else if (bHitched && Now - HitchEndTime > 2 * IdleTimeout)
+				{
+					Phase = EPhase::Silent;
+					SilenceStartTime = Now;
+				}
+				return true;
+			case EPhase::Silent:
+				if (Now - SilenceStartTime > 3 * IdleTimeout)
+				{
+					FRuntimeStallMonitor::Get().Unregister(Handle);
+					Finish(false, TEXT("the request that stopped reporting progress was not reported as stalled"));
+				}
+				return Phase != EPhase::Done;
+			default:
+				return false;
+			}
+		}
+
+		void OnStalled()
+		{
+			if (Phase == EPhase::Reporting)
+			{
+				Finish(false, FString::Printf(TEXT("a stall was reported %.2f seconds after the %.2f second hitch"), FPlatformTime::Seconds() - HitchEndTime, HitchSeconds));
+			}
+			else if (Phase == EPhase::Silent)
+			{
+				Finish(true, FString::Printf(TEXT("the stall was reported %.2f seconds after the progress stopped"), FPlatformTime::Seconds() - SilenceStartTime));
+			}
+		}
+
+		void Finish(bool bPassed, const FString& Details)
+		{
+			Phase = EPhase::Done;
+			if (bPassed)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Stall hitch check passed: %s"), *Details);
+			}
+			else
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Stall hitch check failed: %s"), *Details);
+			}
+		}
+
+		/** The idle timeout of the simulated request, in seconds */
+		static constexpr float IdleTimeout = 1.f;
+
+		float HitchSeconds;
+		uint64 Handle = 0;
+		EPhase Phase = EPhase::Reporting;
+		int64 BytesReported = 0;
+		bool bHitched = false;
+		double StartTime = 0;
+		double HitchEndTime = 0;
+		double SilenceStartTime = 0;
+	};
+
+	void RunStallHitchCheck(const TArray<FString>& Args)
+	{
+		const float HitchSeconds = Args.Num() > 0 ? FMath::Max(FCString::Atof(*Args[0]), 0.f) : 3.f;
+		MakeShared<FStallHitchCheck>(HitchSeconds)->Start();
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("RuntimeFilesDownloader.Benchmark"),
+		TEXT("Benchmark the download and upload paths against the specified URLs and write the results as JSON to the Saved directory. Usage: RuntimeFilesDownloader.Benchmark <URL>[,<URL>...] [UploadURL]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run)
+	);
+
+	FAutoConsoleCommand NetworkScenarioCommand(
+		TEXT("RuntimeFilesDownloader.NetworkScenario"),
+		TEXT("Run the download scenarios under simulated network conditions and check them against a time and memory budget. Usage: RuntimeFilesDownloader.NetworkScenario <off|mobile|lossy|stalls|wrong_length> <URL>[,<URL>...] [MaxSeconds] [MaxPeakMemoryMB]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunNetworkScenario)
+	);
+
+	FAutoConsoleCommand RequestOverheadCommand(
+		TEXT("RuntimeFilesDownloader.RequestOverheadBenchmark"),
+		TEXT("Compare the per-request overhead of the UObject downloaders with the native download handles by issuing many small downloads through each. Usage: RuntimeFilesDownloader.RequestOverheadBenchmark <URL> [NumRequests=1000]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunRequestOverhead)
+	);
+
+	FAutoConsoleCommand StallHitchCheckCommand(
+		TEXT("RuntimeFilesDownloader.StallHitchCheck"),
+		TEXT("Check that a hitch of the game thread is not reported as a stall by the stall monitor, while a request that stops reporting progress is. Usage: RuntimeFilesDownloader.StallHitchCheck [HitchSeconds=3]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunStallHitchCheck)
+	);
+}
+
+#endif
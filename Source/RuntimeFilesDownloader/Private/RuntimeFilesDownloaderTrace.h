@@ -0,0 +1,110 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/EngineVersionComparison.h"
+#include <atomic>
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+/** Declares a CPU trace scope visible in Unreal Insights */
+#define RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE(Name)
+
+/** Adds the given amount to one of the downloader trace counters (BytesInFlight, ActiveRequests or BufferedBytes) */
+#define RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_ADD(Counter, Amount) TRACE_COUNTER_ADD(RuntimeFilesDownloader_##Counter, Amount)
+
+/** Subtracts the given amount from one of the downloader trace counters */
+#define RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(Counter, Amount) TRACE_COUNTER_SUBTRACT(RuntimeFilesDownloader_##Counter, Amount)
+
+TRACE_DECLARE_INT_COUNTER_EXTERN(RuntimeFilesDownloader_BytesInFlight);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RuntimeFilesDownloader_ActiveRequests);
+TRACE_DECLARE_INT_COUNTER_EXTERN(RuntimeFilesDownloader_BufferedBytes);
+#else
+#define RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(Name)
+#define RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_ADD(Counter, Amount)
+#define RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(Counter, Amount)
+#endif
+
+/**
+ * Tracks the contribution of a single HTTP request to the ActiveRequests and BytesInFlight trace counters
+ * Finishing is idempotent, since the request may fail both synchronously and through its completion delegate
+ */
+class FRuntimeRequestTrace
+{
+public:
+	FRuntimeRequestTrace()
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_ADD(ActiveRequests, 1);
+	}
+
+	~FRuntimeRequestTrace()
+	{
+		Finish();
+	}
+
+	/**
+	 * Update the number of bytes received so far by the request
+	 */
+	void Progress(int64 BytesReceived)
+	{
+		if (bFinished)
+		{
+			return;
+		}
+		const int64 PreviousBytesReceived = LastBytesReceived.exchange(BytesReceived);
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_ADD(BytesInFlight, BytesReceived - PreviousBytesReceived);
+	}
+
+	/**
+	 * Mark the request as completed, removing its bytes from the bytes in flight
+	 */
+	void Finish()
+	{
+		if (bFinished.exchange(true))
+		{
+			return;
+		}
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(BytesInFlight, LastBytesReceived.exchange(0));
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(ActiveRequests, 1);
+	}
+
+private:
+	std::atomic<int64> LastBytesReceived{0};
+	std::atomic<bool> bFinished{false};
+};
+
+/**
+ * Tracks downloaded bytes held in memory by the downloader before they are handed over to the caller, for the BufferedBytes trace counter
+ * The bytes are released once the last reference to the tracker goes away
+ */
+class FRuntimeBufferedBytesTrace
+{
+public:
+	~FRuntimeBufferedBytesTrace()
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(BufferedBytes, BufferedBytes.exchange(0));
+	}
+
+	void Add(int64 Size)
+	{
+		BufferedBytes += Size;
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_ADD(BufferedBytes, Size);
+	}
+
+	void Remove(int64 Size)
+	{
+		BufferedBytes -= Size;
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(BufferedBytes, Size);
+	}
+
+	void Reset()
+	{
+		RUNTIMEFILESDOWNLOADER_TRACE_COUNTER_SUBTRACT(BufferedBytes, BufferedBytes.exchange(0));
+	}
+
+private:
+	std::atomic<int64> BufferedBytes{0};
+};
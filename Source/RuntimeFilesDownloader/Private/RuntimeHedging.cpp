@@ -0,0 +1,46 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeHedging.h"
+
+void FRuntimeHedgingSamples::Add(double Duration, int64 Size)
+{
+	if (Duration <= 0)
+	{
+		return;
+	}
+
+	if (Durations.Num() >= MaxSamples)
+	{
+		Durations.RemoveAt(0);
+		Throughputs.RemoveAt(0);
+	}
+	Durations.Add(Duration);
+	Throughputs.Add(Size / Duration);
+}
+
+double FRuntimeHedgingSamples::GetLatencyThreshold(const FRuntimeHedgingSettings& Settings) const
+{
+	if (Durations.Num() < FMath::Max(Settings.MinLatencySamples, 1))
+	{
+		return TNumericLimits<double>::Max();
+	}
+
+	TArray<double> SortedDurations = Durations;
+	SortedDurations.Sort();
+	const int32 PercentileIndex = FMath::Clamp(FMath::CeilToInt(Settings.LatencyPercentile * SortedDurations.Num()) - 1, 0, SortedDurations.Num() - 1);
+	return SortedDurations[PercentileIndex];
+}
+
+bool FRuntimeHedgingSamples::IsThroughputStraggling(const FRuntimeHedgingSettings& Settings, double Throughput, TArray<double> PeerThroughputs) const
+{
+	PeerThroughputs.Append(Throughputs);
+	if (PeerThroughputs.Num() < 2)
+	{
+		return false;
+	}
+
+	PeerThroughputs.Sort();
+	const int32 Middle = PeerThroughputs.Num() / 2;
+	const double Median = PeerThroughputs.Num() % 2 == 0 ? (PeerThroughputs[Middle - 1] + PeerThroughputs[Middle]) / 2 : PeerThroughputs[Middle];
+	return Throughput < Settings.ThroughputRatio * Median;
+}
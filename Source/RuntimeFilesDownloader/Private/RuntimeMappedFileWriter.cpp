@@ -0,0 +1,297 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeMappedFileWriter.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/ScopeLock.h"
+
+#define RUNTIMEFILESDOWNLOADER_POSIX_MAPPING (PLATFORM_UNIX || PLATFORM_MAC || PLATFORM_ANDROID || PLATFORM_IOS)
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#elif RUNTIMEFILESDOWNLOADER_POSIX_MAPPING
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+FRuntimeMappedFileWriter::FRuntimeMappedFileWriter(const FString& InFilePath, int64 InFileSize)
+	: FilePath(InFilePath)
+	, FileSize(InFileSize)
+{
+}
+
+FRuntimeMappedFileWriter::~FRuntimeMappedFileWriter()
+{
+	if (!bClosed)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The mapped file '%s' was destroyed without being finalized, deleting it"), *FilePath);
+		Abort();
+	}
+}
+
+TUniquePtr<FRuntimeMappedFileWriter> FRuntimeMappedFileWriter::Create(const FString& FilePath, int64 FileSize)
+{
+	if (FileSize <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create the file '%s': the file size (%lld) must be greater than 0"), *FilePath, FileSize);
+		return nullptr;
+	}
+
+	TUniquePtr<FRuntimeMappedFileWriter> Writer(new FRuntimeMappedFileWriter(FilePath, FileSize));
+
+	bool bPreallocationFailed = false;
+	if (Writer->OpenMapped(bPreallocationFailed))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Preallocated and mapped %lld bytes for the file '%s'"), FileSize, *FilePath);
+		return Writer;
+	}
+
+	if (bPreallocationFailed)
+	{
+		Writer->bClosed = true;
+		IFileManager::Get().Delete(*FilePath, false, true, true);
+		return nullptr;
+	}
+
+	if (Writer->OpenHandle())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Preallocated %lld bytes for the file '%s' without memory mapping"), FileSize, *FilePath);
+		return Writer;
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create and preallocate %lld bytes for the file '%s'"), FileSize, *FilePath);
+	Writer->bClosed = true;
+	IFileManager::Get().Delete(*FilePath, false, true, true);
+	return nullptr;
+}
+
+bool FRuntimeMappedFileWriter::Write(int64 Offset, const uint8* Data, int64 Size)
+{
+	if (bClosed)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to write to the file '%s': the file is already closed"), *FilePath);
+		return false;
+	}
+
+	if (Offset < 0 || Size < 0 || Offset + Size > FileSize)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to write to the file '%s': range {%lld; %lld} is out of the file size (%lld)"), *FilePath, Offset, Offset + Size, FileSize);
+		return false;
+	}
+
+	if (Size == 0)
+	{
+		return true;
+	}
+
+	if (MappedData)
+	{
+		FMemory::Memcpy(MappedData + Offset, Data, Size);
+		return true;
+	}
+
+	FScopeLock Lock(&FileHandleCriticalSection);
+	if (!FileHandle.IsValid() || !FileHandle->Seek(Offset) || !FileHandle->Write(Data, Size))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while writing %lld bytes at offset %lld to the file '%s'"), Size, Offset, *FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool FRuntimeMappedFileWriter::Finalize()
+{
+	if (bClosed)
+	{
+		return false;
+	}
+	bClosed = true;
+
+	if (MappedData)
+	{
+		return CloseMapped(true);
+	}
+
+	FScopeLock Lock(&FileHandleCriticalSection);
+	const bool bFlushed = FileHandle.IsValid() && FileHandle->Flush(true);
+	FileHandle.Reset();
+	return bFlushed;
+}
+
+void FRuntimeMappedFileWriter::Abort()
+{
+	if (!bClosed)
+	{
+		bClosed = true;
+		if (MappedData)
+		{
+			CloseMapped(false);
+		}
+		else
+		{
+			FScopeLock Lock(&FileHandleCriticalSection);
+			FileHandle.Reset();
+		}
+	}
+	IFileManager::Get().Delete(*FilePath, false, true, true);
+}
+
+bool FRuntimeMappedFileWriter::OpenMapped(bool& bOutPreallocationFailed)
+{
+	bOutPreallocationFailed = false;
+
+	if (static_cast<uint64>(FileSize) > static_cast<uint64>(TNumericLimits<SIZE_T>::Max()))
+	{
+		// The file cannot be mapped into the address space (e.g. on 32-bit platforms)
+		return false;
+	}
+
+	const FString NativeFilePath = FPlatformFileManager::Get().GetPlatformFile().ConvertToAbsolutePathForExternalAppForWrite(*FilePath);
+
+#if PLATFORM_WINDOWS
+	HANDLE File = ::CreateFileW(*NativeFilePath, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// Extending the end of file allocates the clusters and fails if there is not enough space
+	LARGE_INTEGER DistanceToMove;
+	DistanceToMove.QuadPart = FileSize;
+	if (!::SetFilePointerEx(File, DistanceToMove, nullptr, FILE_BEGIN) || !::SetEndOfFile(File))
+	{
+		const DWORD LastError = ::GetLastError();
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to preallocate %lld bytes for the file '%s': %s"), FileSize, *FilePath, LastError == ERROR_DISK_FULL || LastError == ERROR_HANDLE_DISK_FULL ? TEXT("not enough free space") : TEXT("the space could not be reserved"));
+		bOutPreallocationFailed = true;
+		::CloseHandle(File);
+		return false;
+	}
+
+	HANDLE Mapping = ::CreateFileMappingW(File, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64>(FileSize) >> 32), static_cast<DWORD>(FileSize & 0xFFFFFFFF), nullptr);
+	if (!Mapping)
+	{
+		::CloseHandle(File);
+		return false;
+	}
+
+	void* View = ::MapViewOfFile(Mapping, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(FileSize));
+	if (!View)
+	{
+		::CloseHandle(Mapping);
+		::CloseHandle(File);
+		return false;
+	}
+
+	NativeFileHandle = File;
+	NativeMappingHandle = Mapping;
+	MappedData = static_cast<uint8*>(View);
+	return true;
+#elif RUNTIMEFILESDOWNLOADER_POSIX_MAPPING
+	const int32 FileDescriptor = ::open(TCHAR_TO_UTF8(*NativeFilePath), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (FileDescriptor < 0)
+	{
+		return false;
+	}
+
+#if PLATFORM_MAC || PLATFORM_IOS
+	// Try to allocate contiguous space first and fall back to any free space
+	fstore_t Store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(FileSize), 0};
+	if (::fcntl(FileDescriptor, F_PREALLOCATE, &Store) == -1)
+	{
+		Store.fst_flags = F_ALLOCATEALL;
+		if (::fcntl(FileDescriptor, F_PREALLOCATE, &Store) == -1)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to preallocate %lld bytes for the file '%s': %s"), FileSize, *FilePath, UTF8_TO_TCHAR(::strerror(errno)));
+			bOutPreallocationFailed = true;
+			::close(FileDescriptor);
+			return false;
+		}
+	}
+	const int32 AllocateError = ::ftruncate(FileDescriptor, static_cast<off_t>(FileSize)) == 0 ? 0 : errno;
+#else
+	// posix_fallocate returns the error code instead of setting errno. File systems without allocation support are not worked around with a sparse file, since a write into a sparse mapping raises SIGBUS once the disk is full
+	const int32 AllocateError = ::posix_fallocate(FileDescriptor, 0, static_cast<off_t>(FileSize));
+#endif
+
+	if (AllocateError != 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to preallocate %lld bytes for the file '%s': %s"), FileSize, *FilePath, UTF8_TO_TCHAR(::strerror(AllocateError)));
+		bOutPreallocationFailed = true;
+		::close(FileDescriptor);
+		return false;
+	}
+
+	void* View = ::mmap(nullptr, static_cast<size_t>(FileSize), PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, 0);
+	if (View == MAP_FAILED)
+	{
+		::close(FileDescriptor);
+		return false;
+	}
+
+	NativeFileDescriptor = FileDescriptor;
+	MappedData = static_cast<uint8*>(View);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FRuntimeMappedFileWriter::OpenHandle()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, false, false));
+	if (!FileHandle.IsValid())
+	{
+		return false;
+	}
+
+	// Extend the file to its final size so that a lack of space is detected before downloading
+	if (!FileHandle->Truncate(FileSize))
+	{
+		FileHandle.Reset();
+		return false;
+	}
+	return true;
+}
+
+bool FRuntimeMappedFileWriter::CloseMapped(bool bFlush)
+{
+	bool bSuccess = true;
+
+#if PLATFORM_WINDOWS
+	if (bFlush)
+	{
+		bSuccess = ::FlushViewOfFile(MappedData, 0) && ::FlushFileBuffers(static_cast<HANDLE>(NativeFileHandle));
+	}
+	::UnmapViewOfFile(MappedData);
+	::CloseHandle(static_cast<HANDLE>(NativeMappingHandle));
+	::CloseHandle(static_cast<HANDLE>(NativeFileHandle));
+	NativeMappingHandle = nullptr;
+	NativeFileHandle = nullptr;
+#elif RUNTIMEFILESDOWNLOADER_POSIX_MAPPING
+	if (bFlush)
+	{
+		bSuccess = ::msync(MappedData, static_cast<size_t>(FileSize), MS_SYNC) == 0;
+	}
+	::munmap(MappedData, static_cast<size_t>(FileSize));
+	bSuccess = (::close(NativeFileDescriptor) == 0) && bSuccess;
+	NativeFileDescriptor = -1;
+#endif
+
+	MappedData = nullptr;
+
+	if (!bSuccess)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while flushing the mapped file '%s'"), *FilePath);
+	}
+	return bSuccess;
+}
+
+#undef RUNTIMEFILESDOWNLOADER_POSIX_MAPPING
@@ -0,0 +1,454 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeNetworkSimulator.h"
+#include "RuntimeFilesDownloaderDefines.h"
+
+#if WITH_RUNTIMEFILESDOWNLOADER_NETWORK_SIMULATION
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+namespace RuntimeNetworkSimulator
+{
+	/** How often the progress of a held back response is reported, in seconds */
+	constexpr float ProgressInterval = 0.1f;
+
+	TAutoConsoleVariable<float> CVarLatencyMs(TEXT("RuntimeFilesDownloader.NetSim.LatencyMs"), 0, TEXT("Latency added to the completion of every downloader request, in milliseconds"));
+	TAutoConsoleVariable<float> CVarJitterMs(TEXT("RuntimeFilesDownloader.NetSim.JitterMs"), 0, TEXT("Random variation of the simulated latency, in milliseconds"));
+	TAutoConsoleVariable<int32> CVarBandwidthKbps(TEXT("RuntimeFilesDownloader.NetSim.BandwidthKbps"), 0, TEXT("Bandwidth of the simulated link shared by all downloader requests, in kilobits per second, 0 for unlimited"));
+	TAutoConsoleVariable<float> CVarDropChance(TEXT("RuntimeFilesDownloader.NetSim.DropChance"), 0, TEXT("Chance of a downloader request failing as if its connection was dropped, from 0 to 1"));
+	TAutoConsoleVariable<float> CVarStallChance(TEXT("RuntimeFilesDownloader.NetSim.StallChance"), 0, TEXT("Chance of a downloader response stalling before it is delivered, from 0 to 1"));
+	TAutoConsoleVariable<float> CVarStallSeconds(TEXT("RuntimeFilesDownloader.NetSim.StallSeconds"), 30, TEXT("How long a stalled downloader response is held back, in seconds"));
+	TAutoConsoleVariable<float> CVarWrongContentLengthChance(TEXT("RuntimeFilesDownloader.NetSim.WrongContentLengthChance"), 0, TEXT("Chance of a range request receiving a response whose length does not match the requested range, from 0 to 1"));
+
+	/**
+	 * Call the function on the game thread once the delay has elapsed
+	 */
+	void CallAfter(double Delay, TFunction<void()>&& Function)
+	{
+		if (Delay <= 0)
+		{
+			Function();
+			return;
+		}
+
+		auto TickerFunction = [Function = MoveTemp(Function)](float DeltaTime)
+		{
+			Function();
+			return false;
+		};
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Delay);
+#else
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Delay);
+#endif
+	}
+
+	/**
+	 * Call the function on the game thread at the interval until it returns false
+	 */
+	void CallRepeatedly(float Interval, TFunction<bool()>&& Function)
+	{
+		auto TickerFunction = [Function = MoveTemp(Function)](float DeltaTime)
+		{
+			return Function();
+		};
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Interval);
+#else
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(MoveTemp(TickerFunction)), Interval);
+#endif
+	}
+}
+
+struct FRuntimeNetworkSimulator::FShapedRequest
+{
+	/** The request being shaped, used as the key of the shaped requests. Only compared, never dereferenced */
+	const IHttpRequest* Key = nullptr;
+
+	/** The time the request was started, in FPlatformTime::Seconds */
+	double StartTime = 0;
+
+	/** The simulated latency of the request, in seconds */
+	double Latency = 0;
+
+	/** The bandwidth of the simulated link, in bytes per second, 0 for unlimited */
+	double BytesPerSecond = 0;
+
+	/** The timeout of the request, in seconds */
+	float Timeout = 0;
+
+	/** Whether the connection is dropped halfway through the transfer */
+	bool bDrop = false;
+
+	/** How long the response stalls, in seconds, 0 if it does not stall */
+	float StallSeconds = 0;
+
+	/** Whether the stall has begun, after which no more progress is reported */
+	bool bStallStarted = false;
+
+	/** Whether the request was canceled */
+	bool bCanceled = false;
+
+	/** Whether the completion has been delivered */
+	bool bDelivered = false;
+
+	/** The latest progress reported to the original progress delegate */
+	int64 ReportedBytes = 0;
+
+	/** The request and its response, held from the real completion until the simulated one */
+	FHttpRequestPtr Request;
+	FHttpResponsePtr Response;
+
+	/** The delegates originally bound to the request */
+	FHttpRequestCompleteDelegate OnComplete;
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	FHttpRequestProgressDelegate64 OnProgress;
+#else
+	FHttpRequestProgressDelegate OnProgress;
+#endif
+
+	FCriticalSection CriticalSection;
+
+	/**
+	 * Get how many of the received bytes the simulated link could have transferred by now
+	 */
+	int64 GetAllowedBytes(int64 BytesReceived) const
+	{
+		const double TransferTime = FPlatformTime::Seconds() - StartTime - Latency;
+		if (TransferTime <= 0)
+		{
+			return 0;
+		}
+		return BytesPerSecond > 0 ? FMath::Min(BytesReceived, static_cast<int64>(TransferTime * BytesPerSecond)) : BytesReceived;
+	}
+};
+#endif
+
+FRuntimeNetworkSimulator& FRuntimeNetworkSimulator::Get()
+{
+	static FRuntimeNetworkSimulator Simulator;
+	return Simulator;
+}
+
+FRuntimeNetworkConditions FRuntimeNetworkSimulator::GetConditions() const
+{
+	FRuntimeNetworkConditions Conditions;
+#if WITH_RUNTIMEFILESDOWNLOADER_NETWORK_SIMULATION
+	using namespace RuntimeNetworkSimulator;
+	Conditions.LatencyMs = CVarLatencyMs.GetValueOnAnyThread();
+	Conditions.JitterMs = CVarJitterMs.GetValueOnAnyThread();
+	Conditions.BandwidthKbps = CVarBandwidthKbps.GetValueOnAnyThread();
+	Conditions.DropChance = CVarDropChance.GetValueOnAnyThread();
+	Conditions.StallChance = CVarStallChance.GetValueOnAnyThread();
+	Conditions.StallSeconds = CVarStallSeconds.GetValueOnAnyThread();
+	Conditions.WrongContentLengthChance = CVarWrongContentLengthChance.GetValueOnAnyThread();
+#endif
+	return Conditions;
+}
+
+void FRuntimeNetworkSimulator::SetConditions(const FRuntimeNetworkConditions& Conditions)
+{
+#if WITH_RUNTIMEFILESDOWNLOADER_NETWORK_SIMULATION
+	using namespace RuntimeNetworkSimulator;
+	CVarLatencyMs->Set(Conditions.LatencyMs, ECVF_SetByCode);
+	CVarJitterMs->Set(Conditions.JitterMs, ECVF_SetByCode);
+	CVarBandwidthKbps->Set(Conditions.BandwidthKbps, ECVF_SetByCode);
+	CVarDropChance->Set(Conditions.DropChance, ECVF_SetByCode);
+	CVarStallChance->Set(Conditions.StallChance, ECVF_SetByCode);
+	CVarStallSeconds->Set(Conditions.StallSeconds, ECVF_SetByCode);
+	CVarWrongContentLengthChance->Set(Conditions.WrongContentLengthChance, ECVF_SetByCode);
+
+	FScopeLock Lock(&CriticalSection);
+	LinkFreeTime = 0;
+#else
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Network condition simulation is not available in shipping builds"));
+#endif
+}
+
+bool FRuntimeNetworkSimulator::GetProfile(const FString& Name, FRuntimeNetworkConditions& OutConditions)
+{
+	OutConditions = FRuntimeNetworkConditions();
+	if (Name == TEXT("off"))
+	{
+		return true;
+	}
+	if (Name == TEXT("mobile"))
+	{
+		// The round trip is split between the HEAD request and the download request that follows it
+		OutConditions.LatencyMs = 300;
+		OutConditions.JitterMs = 50;
+		OutConditions.BandwidthKbps = 2000;
+		OutConditions.DropChance = 0.01f;
+		return true;
+	}
+	if (Name == TEXT("lossy"))
+	{
+		OutConditions.LatencyMs = 100;
+		OutConditions.JitterMs = 30;
+		OutConditions.DropChance = 0.1f;
+		return true;
+	}
+	if (Name == TEXT("stalls"))
+	{
+		OutConditions.LatencyMs = 50;
+		OutConditions.StallChance = 0.1f;
+		OutConditions.StallSeconds = 10;
+		return true;
+	}
+	if (Name == TEXT("wrong_length"))
+	{
+		OutConditions.WrongContentLengthChance = 0.1f;
+		return true;
+	}
+	return false;
+}
+
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+void FRuntimeNetworkSimulator::ShapeRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest, float Timeout)
+#else
+void FRuntimeNetworkSimulator::ShapeRequest(const TSharedRef<IHttpRequest>& HttpRequest, float Timeout)
+#endif
+{
+#if WITH_RUNTIMEFILESDOWNLOADER_NETWORK_SIMULATION
+	const FRuntimeNetworkConditions Conditions = GetConditions();
+	if (!Conditions.IsEnabled())
+	{
+		return;
+	}
+
+	if (Conditions.WrongContentLengthChance > 0 && FMath::FRand() < Conditions.WrongContentLengthChance)
+	{
+		// Requesting one byte less than expected makes the server respond with a mismatching Content-Length, as a misbehaving server or proxy would
+		FString RangeStart, RangeEnd;
+		FString RangeHeader = HttpRequest->GetHeader(TEXT("Range"));
+		if (RangeHeader.RemoveFromStart(TEXT("bytes=")) && RangeHeader.Split(TEXT("-"), &RangeStart, &RangeEnd) && !RangeEnd.Contains(TEXT(",")))
+		{
+			const int64 Start = FCString::Atoi64(*RangeStart);
+			const int64 End = FCString::Atoi64(*RangeEnd);
+			if (End > Start)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Network simulation: requesting a wrong range from %s"), *HttpRequest->GetURL());
+				HttpRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), Start, End - 1));
+			}
+		}
+	}
+
+	TSharedRef<FShapedRequest, ESPMode::ThreadSafe> ShapedRequest = MakeShared<FShapedRequest, ESPMode::ThreadSafe>();
+	ShapedRequest->Key = &HttpRequest.Get();
+	ShapedRequest->StartTime = FPlatformTime::Seconds();
+	ShapedRequest->Latency = FMath::Max(0.0, (Conditions.LatencyMs + FMath::FRandRange(-Conditions.JitterMs, Conditions.JitterMs)) / 1000.0);
+	ShapedRequest->BytesPerSecond = Conditions.BandwidthKbps * 1000.0 / 8.0;
+	ShapedRequest->Timeout = Timeout;
+	ShapedRequest->bDrop = Conditions.DropChance > 0 && FMath::FRand() < Conditions.DropChance;
+	if (!ShapedRequest->bDrop && Conditions.StallChance > 0 && FMath::FRand() < Conditions.StallChance)
+	{
+		ShapedRequest->StallSeconds = Conditions.StallSeconds;
+	}
+
+	ShapedRequest->OnComplete = HttpRequest->OnProcessRequestComplete();
+	HttpRequest->OnProcessRequestComplete().BindLambda([this, ShapedRequest](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess)
+	{
+		OnShapedRequestComplete(ShapedRequest, Request, Response, bSuccess);
+	});
+
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	ShapedRequest->OnProgress = HttpRequest->OnRequestProgress64();
+	HttpRequest->OnRequestProgress64().BindLambda([ShapedRequest](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
+	{
+		ReportProgress(ShapedRequest, Request, ShapedRequest->GetAllowedBytes(static_cast<int64>(BytesReceived)));
+	});
+#else
+	// The 32-bit progress is not unwrapped here, so the progress of responses above 4 GB is only shaped accurately with the 64-bit progress of newer engines
+	ShapedRequest->OnProgress = HttpRequest->OnRequestProgress();
+	HttpRequest->OnRequestProgress().BindLambda([ShapedRequest](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+	{
+		ReportProgress(ShapedRequest, Request, ShapedRequest->GetAllowedBytes(static_cast<uint32>(BytesReceived)));
+	});
+#endif
+
+	FScopeLock Lock(&CriticalSection);
+	ShapedRequests.Add(ShapedRequest->Key, ShapedRequest);
+#endif
+}
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+void FRuntimeNetworkSimulator::CancelRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest)
+#else
+void FRuntimeNetworkSimulator::CancelRequest(const TSharedRef<IHttpRequest>& HttpRequest)
+#endif
+{
+#if WITH_RUNTIMEFILESDOWNLOADER_NETWORK_SIMULATION
+	TSharedPtr<FShapedRequest, ESPMode::ThreadSafe> ShapedRequest;
+	{
+		FScopeLock Lock(&CriticalSection);
+		ShapedRequest = ShapedRequests.FindRef(&HttpRequest.Get());
+	}
+
+	if (ShapedRequest.IsValid())
+	{
+		bool bHeldBack;
+		{
+			FScopeLock Lock(&ShapedRequest->CriticalSection);
+			ShapedRequest->bCanceled = true;
+			bHeldBack = ShapedRequest->Request.IsValid();
+		}
+
+		// The real request has already completed, so canceling it would have no effect and the held back response is failed instead
+		if (bHeldBack)
+		{
+			Deliver(ShapedRequest.ToSharedRef(), false);
+			return;
+		}
+	}
+#endif
+	HttpRequest->CancelRequest();
+}
+
+#if WITH_RUNTIMEFILESDOWNLOADER_NETWORK_SIMULATION
+void FRuntimeNetworkSimulator::OnShapedRequestComplete(const TSharedRef<FShapedRequest, ESPMode::ThreadSafe>& ShapedRequest, FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess)
+{
+	bool bCanceled;
+	int64 ReportedBytes;
+	{
+		FScopeLock Lock(&ShapedRequest->CriticalSection);
+		ShapedRequest->Request = Request;
+		ShapedRequest->Response = Response;
+		bCanceled = ShapedRequest->bCanceled;
+		ReportedBytes = ShapedRequest->ReportedBytes;
+
+		// A stall that has not begun during the real transfer begins now, so that the held back response reports no progress
+		if (ShapedRequest->StallSeconds > 0)
+		{
+			ShapedRequest->bStallStarted = true;
+		}
+	}
+
+	// Canceled requests fail right away, as there is no transfer left to simulate
+	if (bCanceled)
+	{
+		Deliver(ShapedRequest, false);
+		return;
+	}
+
+	// The latency counts from the start of the request, since the real transfer took part of it already
+	const double Now = FPlatformTime::Seconds();
+	double Delay = FMath::Max(0.0, ShapedRequest->StartTime + ShapedRequest->Latency - Now);
+
+	// The link transfers one response at a time, so concurrent requests share its bandwidth
+	const int64 ResponseSize = Response.IsValid() ? Response->GetContent().Num() : ReportedBytes;
+	if (ShapedRequest->BytesPerSecond > 0)
+	{
+		FScopeLock Lock(&CriticalSection);
+		const double TransferStart = FMath::Max(Now + Delay, LinkFreeTime);
+		LinkFreeTime = TransferStart + FMath::Max<int64>(ResponseSize - ReportedBytes, 0) / ShapedRequest->BytesPerSecond;
+		Delay = LinkFreeTime - Now;
+	}
+
+	int64 TargetBytes = ResponseSize;
+	if (bSuccess && ShapedRequest->bDrop)
+	{
+		// The connection is dropped halfway through the transfer
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Network simulation: dropping the connection of %s"), *Request->GetURL());
+		bSuccess = false;
+		Delay *= 0.5;
+		TargetBytes = FMath::Max(ReportedBytes, ResponseSize / 2);
+	}
+	else if (bSuccess && ShapedRequest->StallSeconds > 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Network simulation: stalling the response of %s for %f seconds"), *Request->GetURL(), ShapedRequest->StallSeconds);
+		Delay += ShapedRequest->StallSeconds;
+		const double TimeoutTime = ShapedRequest->StartTime + ShapedRequest->Timeout;
+		if (ShapedRequest->Timeout > 0 && Now + Delay >= TimeoutTime)
+		{
+			Delay = FMath::Max(0.0, TimeoutTime - Now);
+			bSuccess = false;
+		}
+	}
+
+	// The progress of the held back response is paced up to its delivery, since the real progress has ended already
+	if (Delay > 0 && TargetBytes > ReportedBytes && ShapedRequest->StallSeconds <= 0)
+	{
+		RuntimeNetworkSimulator::CallRepeatedly(RuntimeNetworkSimulator::ProgressInterval, [ShapedRequest, StartTime = Now, Delay, ReportedBytes, TargetBytes]()
+		{
+			const double Alpha = FMath::Min(1.0, (FPlatformTime::Seconds() - StartTime) / Delay);
+			return ReportProgress(ShapedRequest, nullptr, ReportedBytes + static_cast<int64>((TargetBytes - ReportedBytes) * Alpha)) && Alpha < 1;
+		});
+	}
+
+	RuntimeNetworkSimulator::CallAfter(Delay, [this, ShapedRequest, bSuccess]()
+	{
+		Deliver(ShapedRequest, bSuccess);
+	});
+}
+
+void FRuntimeNetworkSimulator::Deliver(const TSharedRef<FShapedRequest, ESPMode::ThreadSafe>& ShapedRequest, bool bSuccess)
+{
+	FHttpRequestCompleteDelegate OnComplete;
+	FHttpRequestPtr Request;
+	FHttpResponsePtr Response;
+	{
+		FScopeLock Lock(&ShapedRequest->CriticalSection);
+		if (ShapedRequest->bDelivered)
+		{
+			return;
+		}
+		ShapedRequest->bDelivered = true;
+
+		// The request holds the shaped request through its delegates, so the references back to the request are released here
+		OnComplete = MoveTemp(ShapedRequest->OnComplete);
+		Request = MoveTemp(ShapedRequest->Request);
+		Response = MoveTemp(ShapedRequest->Response);
+		ShapedRequest->OnComplete.Unbind();
+		ShapedRequest->OnProgress.Unbind();
+	}
+
+	{
+		FScopeLock Lock(&CriticalSection);
+		ShapedRequests.Remove(ShapedRequest->Key);
+	}
+
+	OnComplete.ExecuteIfBound(Request, Response, bSuccess);
+}
+
+bool FRuntimeNetworkSimulator::ReportProgress(const TSharedRef<FShapedRequest, ESPMode::ThreadSafe>& ShapedRequest, FHttpRequestPtr Request, int64 BytesReceived)
+{
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	FHttpRequestProgressDelegate64 OnProgress;
+#else
+	FHttpRequestProgressDelegate OnProgress;
+#endif
+	{
+		FScopeLock Lock(&ShapedRequest->CriticalSection);
+		if (ShapedRequest->bDelivered || ShapedRequest->bStallStarted)
+		{
+			return false;
+		}
+		if (BytesReceived <= ShapedRequest->ReportedBytes)
+		{
+			return true;
+		}
+
+		// The first bytes of a stalling response still arrive, after which it stops progressing
+		if (ShapedRequest->StallSeconds > 0)
+		{
+			ShapedRequest->bStallStarted = true;
+		}
+		ShapedRequest->ReportedBytes = BytesReceived;
+		OnProgress = ShapedRequest->OnProgress;
+		if (!Request.IsValid())
+		{
+			Request = ShapedRequest->Request;
+		}
+	}
+
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	OnProgress.ExecuteIfBound(Request, 0, static_cast<uint64>(BytesReceived));
+#else
+	OnProgress.ExecuteIfBound(Request, 0, static_cast<int32>(static_cast<uint32>(BytesReceived)));
+#endif
+	return true;
+}
+#endif
@@ -0,0 +1,136 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Http.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/EngineVersionComparison.h"
+
+/** Network condition simulation is only available in non-shipping builds */
+#define WITH_RUNTIMEFILESDOWNLOADER_NETWORK_SIMULATION !UE_BUILD_SHIPPING
+
+/**
+ * Simulated network conditions applied to the requests of the downloader
+ */
+struct FRuntimeNetworkConditions
+{
+	/** Added to the completion of every request, in milliseconds */
+	float LatencyMs = 0;
+
+	/** Random variation of the latency in both directions, in milliseconds */
+	float JitterMs = 0;
+
+	/** The bandwidth of the simulated link shared by all requests, in kilobits per second, 0 for unlimited */
+	int32 BandwidthKbps = 0;
+
+	/** The chance of a request failing as if its connection was dropped mid-transfer, from 0 to 1 */
+	float DropChance = 0;
+
+	/** The chance of a response stalling mid-transfer, from 0 to 1. A stalled response stops reporting progress until it is delivered */
+	float StallChance = 0;
+
+	/** How long a stalled response is held back, in seconds. Stalls longer than the request timeout fail the request */
+	float StallSeconds = 30;
+
+	/** The chance of a range request receiving a response whose Content-Length does not match the requested range, from 0 to 1 */
+	float WrongContentLengthChance = 0;
+
+	bool IsEnabled() const
+	{
+		return LatencyMs > 0 || JitterMs > 0 || BandwidthKbps > 0 || DropChance > 0 || StallChance > 0 || WrongContentLengthChance > 0;
+	}
+};
+
+/**
+ * Shapes the requests of the downloader to simulate slow, lossy or misbehaving networks against a fast (e.g. local) server
+ * Conditions are configured with the "RuntimeFilesDownloader.NetSim.*" console variables or from a named profile, and have no effect in shipping builds
+ * Every download request (HEAD, chunk, multi-range, payload and first chunk requests) is shaped, while uploads are not
+ */
+class FRuntimeNetworkSimulator
+{
+public:
+	/**
+	 * Get the global network simulator
+	 */
+	static FRuntimeNetworkSimulator& Get();
+
+	/**
+	 * Get the currently simulated conditions
+	 */
+	FRuntimeNetworkConditions GetConditions() const;
+
+	/**
+	 * Set the simulated conditions, overriding the console variables
+	 */
+	void SetConditions(const FRuntimeNetworkConditions& Conditions);
+
+	/**
+	 * Get the conditions of a named profile: "off", "mobile" (300 ms RTT, 1% loss, 2 Mbit), "lossy", "stalls" or "wrong_length"
+	 *
+	 * @return Whether the profile exists
+	 */
+	static bool GetProfile(const FString& Name, FRuntimeNetworkConditions& OutConditions);
+
+	/**
+	 * Shape a request right before it is processed. Whether the request is dropped or stalled is decided here, and the completion and progress delegates already bound to the request are wrapped:
+	 * the completion is delayed by the latency and the bandwidth, or turned into a failure, and the progress is paced accordingly, stopping for the duration of a stall so that the stall detection can notice it
+	 * A range request may also have its Range header altered, so that the response length does not match the expected one
+	 *
+	 * @param HttpRequest The request to shape, with its delegates already bound
+	 * @param Timeout The timeout of the request, in seconds, used to fail stalled responses
+	 */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	void ShapeRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest, float Timeout);
+#else
+	void ShapeRequest(const TSharedRef<IHttpRequest>& HttpRequest, float Timeout);
+#endif
+
+	/**
+	 * Cancel a request. A shaped request whose response is still being held back completes as failed right away, like a real request canceled mid-transfer
+	 *
+	 * @param HttpRequest The request to cancel
+	 */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	void CancelRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest);
+#else
+	void CancelRequest(const TSharedRef<IHttpRequest>& HttpRequest);
+#endif
+
+private:
+	FRuntimeNetworkSimulator() = default;
+
+	/** The simulated state of a shaped request */
+	struct FShapedRequest;
+
+	/**
+	 * Handle the real completion of a shaped request, holding back or failing its response according to the simulated conditions
+	 */
+	void OnShapedRequestComplete(const TSharedRef<FShapedRequest, ESPMode::ThreadSafe>& ShapedRequest, FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess);
+
+	/**
+	 * Deliver the completion of a shaped request to its original delegate, if not delivered yet
+	 *
+	 * @param ShapedRequest The shaped request
+	 * @param bSuccess Whether the request succeeded
+	 */
+	void Deliver(const TSharedRef<FShapedRequest, ESPMode::ThreadSafe>& ShapedRequest, bool bSuccess);
+
+	/**
+	 * Report the simulated progress of a shaped request to its original delegate
+	 *
+	 * @param ShapedRequest The shaped request
+	 * @param Request The request to report the progress of, or null for the held back one
+	 * @param BytesReceived The number of bytes received so far. Smaller values than the already reported one are ignored
+	 * @return Whether the progress may still be reported, i.e. the response was neither delivered nor stalled
+	 */
+	static bool ReportProgress(const TSharedRef<FShapedRequest, ESPMode::ThreadSafe>& ShapedRequest, FHttpRequestPtr Request, int64 BytesReceived);
+
+	/** The time at which the simulated link finishes transferring the previous responses, in FPlatformTime::Seconds */
+	double LinkFreeTime = 0;
+
+	/** Shaped requests that have not delivered their completion yet, by request */
+	TMap<const IHttpRequest*, TSharedPtr<FShapedRequest, ESPMode::ThreadSafe>> ShapedRequests;
+
+	FCriticalSection CriticalSection;
+};
@@ -0,0 +1,127 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeProgressAggregator.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+FRuntimeProgressAggregator& FRuntimeProgressAggregator::Get()
+{
+	static FRuntimeProgressAggregator Aggregator;
+	return Aggregator;
+}
+
+uint64 FRuntimeProgressAggregator::Register(const FString& Name, TFunction<void(int64, int64)> OnProgress)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	// The ticker is added lazily, since the core ticker may not exist yet when the singleton is first accessed
+	if (!TickerHandle.IsValid())
+	{
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimeProgressAggregator::Tick));
+#else
+		TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimeProgressAggregator::Tick));
+#endif
+	}
+
+	const uint64 Handle = NextHandle++;
+	FProgressEntry& Entry = Entries.Add(Handle);
+	Entry.Name = Name;
+	Entry.OnProgress = MoveTemp(OnProgress);
+	return Handle;
+}
+
+void FRuntimeProgressAggregator::Report(uint64 Handle, int64 BytesReceived, int64 ContentSize)
+{
+	FScopeLock Lock(&CriticalSection);
+	if (FProgressEntry* Entry = Entries.Find(Handle))
+	{
+		Entry->BytesReceived = BytesReceived;
+		Entry->ContentSize = ContentSize;
+		Entry->bPending = true;
+		++Entry->NumReported;
+	}
+}
+
+void FRuntimeProgressAggregator::Unregister(uint64 Handle)
+{
+	FProgressEntry Entry;
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (!Entries.RemoveAndCopyValue(Handle, Entry))
+		{
+			return;
+		}
+	}
+
+	if (Entry.bPending)
+	{
+		++Entry.NumDispatched;
+		Entry.OnProgress(Entry.BytesReceived, Entry.ContentSize);
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Verbose, TEXT("Progress of %s: %lld of %lld bytes, %lld updates reported, %lld dispatched"), *Entry.Name, Entry.BytesReceived, Entry.ContentSize, Entry.NumReported, Entry.NumDispatched);
+}
+
+void FRuntimeProgressAggregator::SetUpdateRate(float InMaxUpdatesPerSecond, int64 InMinBytesDelta)
+{
+	FScopeLock Lock(&CriticalSection);
+	MinInterval = InMaxUpdatesPerSecond > 0 ? 1.0 / InMaxUpdatesPerSecond : 0;
+	MinBytesDelta = FMath::Max<int64>(0, InMinBytesDelta);
+}
+
+void FRuntimeProgressAggregator::Shutdown()
+{
+	FScopeLock Lock(&CriticalSection);
+	if (TickerHandle.IsValid())
+	{
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#else
+		FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#endif
+		TickerHandle.Reset();
+	}
+	Entries.Empty();
+}
+
+bool FRuntimeProgressAggregator::Tick(float DeltaTime)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeProgressAggregator::Tick);
+
+	TArray<FProgressUpdate> Updates;
+	{
+		FScopeLock Lock(&CriticalSection);
+		const double Now = FPlatformTime::Seconds();
+		for (TPair<uint64, FProgressEntry>& EntryPair : Entries)
+		{
+			FProgressEntry& Entry = EntryPair.Value;
+			if (!Entry.bPending)
+			{
+				continue;
+			}
+
+			const bool bIntervalElapsed = Now - Entry.DispatchTime >= MinInterval;
+			const bool bBytesDeltaReached = MinBytesDelta > 0 && Entry.BytesReceived - Entry.DispatchedBytesReceived >= MinBytesDelta;
+			if (!bIntervalElapsed && !bBytesDeltaReached)
+			{
+				continue;
+			}
+
+			Entry.bPending = false;
+			Entry.DispatchedBytesReceived = Entry.BytesReceived;
+			Entry.DispatchTime = Now;
+			++Entry.NumDispatched;
+			Updates.Add(FProgressUpdate{Entry.OnProgress, Entry.BytesReceived, Entry.ContentSize});
+		}
+	}
+
+	// Progress functions may register or unregister requests, so they are called outside of the lock
+	for (const FProgressUpdate& Update : Updates)
+	{
+		Update.OnProgress(Update.BytesReceived, Update.ContentSize);
+	}
+	return true;
+}
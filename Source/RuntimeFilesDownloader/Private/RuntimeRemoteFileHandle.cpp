@@ -0,0 +1,278 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeRemoteFileHandle.h"
+#include "RuntimeChunkBufferPool.h"
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadMemoryBudget.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "HAL/FileManagerGeneric.h"
+#include "Misc/ScopeLock.h"
+
+FRuntimeRemoteFileHandle::FRuntimeRemoteFileHandle(const FString& InURL, int64 InFileSize, const FRuntimeRemoteFileSettings& InSettings, const TSharedPtr<FRuntimeChunkDownloader>& InDownloader)
+	: URL(InURL)
+	, FileSize(InFileSize)
+	, Settings(InSettings)
+	, Downloader(InDownloader)
+{
+	Settings.BlockSize = FMath::Max<int64>(Settings.BlockSize, 1);
+	Settings.MaxCachedBlocks = FMath::Max(Settings.MaxCachedBlocks, 1);
+	Settings.MaxReadaheadBlocks = FMath::Max(Settings.MaxReadaheadBlocks, 0);
+	Settings.WaitTimeout = FMath::Max(Settings.WaitTimeout, 0.f);
+}
+
+FRuntimeRemoteFileHandle::~FRuntimeRemoteFileHandle()
+{
+	// Blocks still in flight are resolved as canceled, and are only referenced by their requests from then on
+	Downloader->CancelDownload();
+}
+
+TUniquePtr<FRuntimeRemoteFileHandle> FRuntimeRemoteFileHandle::Open(const FString& URL, const FRuntimeRemoteFileSettings& Settings)
+{
+	if (IsInGameThread())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the remote file %s on the game thread: the HTTP requests it waits for complete on the game thread"), *URL);
+		return nullptr;
+	}
+
+	TSharedPtr<FRuntimeChunkDownloader> Downloader = MakeShared<FRuntimeChunkDownloader>();
+	TFuture<int64> FileSizeFuture = Downloader->GetContentSize(URL, Settings.Timeout, TMap<FString, FString>());
+	if (!FileSizeFuture.WaitFor(FTimespan::FromSeconds(Settings.WaitTimeout)))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the remote file %s: its size was not received within %f seconds"), *URL, Settings.WaitTimeout);
+		Downloader->CancelDownload();
+		return nullptr;
+	}
+
+	const int64 FileSize = FileSizeFuture.Get();
+	if (FileSize <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the remote file %s: its size is unknown"), *URL);
+		return nullptr;
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Opened the remote file %s. Size: %lld, block size: %lld"), *URL, FileSize, Settings.BlockSize);
+	return TUniquePtr<FRuntimeRemoteFileHandle>(new FRuntimeRemoteFileHandle(URL, FileSize, Settings, Downloader));
+}
+
+TUniquePtr<FArchive> FRuntimeRemoteFileHandle::CreateReader(const FString& URL, const FRuntimeRemoteFileSettings& Settings)
+{
+	TUniquePtr<FRuntimeRemoteFileHandle> Handle = Open(URL, Settings);
+	if (!Handle.IsValid())
+	{
+		return nullptr;
+	}
+
+	// The archive takes ownership of the handle
+	const int64 FileSize = Handle->Size();
+	return MakeUnique<FArchiveFileReaderGeneric>(Handle.Release(), *URL, FileSize);
+}
+
+int64 FRuntimeRemoteFileHandle::Tell()
+{
+	return Position;
+}
+
+bool FRuntimeRemoteFileHandle::Seek(int64 NewPosition)
+{
+	if (NewPosition < 0 || NewPosition > FileSize)
+	{
+		return false;
+	}
+	Position = NewPosition;
+	return true;
+}
+
+bool FRuntimeRemoteFileHandle::SeekFromEnd(int64 NewPositionRelativeToEnd)
+{
+	return Seek(FileSize + NewPositionRelativeToEnd);
+}
+
+bool FRuntimeRemoteFileHandle::Read(uint8* Destination, int64 BytesToRead)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeRemoteFileHandle::Read);
+
+	if (BytesToRead <= 0)
+	{
+		return BytesToRead == 0;
+	}
+
+	if (Position + BytesToRead > FileSize)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read %lld bytes at %lld from the remote file %s: the file is only %lld bytes"), BytesToRead, Position, *URL, FileSize);
+		return false;
+	}
+
+	if (IsInGameThread())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read from the remote file %s on the game thread: the HTTP requests it waits for complete on the game thread"), *URL);
+		return false;
+	}
+
+	const int64 FirstBlockIndex = Position / Settings.BlockSize;
+	const int64 LastBlockIndex = (Position + BytesToRead - 1) / Settings.BlockSize;
+
+	// Reads continuing where the previous one ended are likely to be followed by more, so the next blocks are fetched along with the missing ones
+	const bool bSequential = Position == LastReadEnd;
+	const int64 LastBlockInFile = (FileSize - 1) / Settings.BlockSize;
+	const int64 LastRequestedBlockIndex = bSequential ? FMath::Min(LastBlockIndex + Settings.MaxReadaheadBlocks, LastBlockInFile) : LastBlockIndex;
+
+	const TArray<FBlockPtr> ReadBlocks = RequestBlocks(FirstBlockIndex, LastRequestedBlockIndex);
+
+	// The whole read shares a single deadline, so that it does not wait for longer than the timeout however many blocks it spans
+	const FDateTime Deadline = FDateTime::UtcNow() + FTimespan::FromSeconds(Settings.WaitTimeout);
+
+	int64 BytesRead = 0;
+	for (int64 BlockIndex = FirstBlockIndex; BlockIndex <= LastBlockIndex; ++BlockIndex)
+	{
+		const FBlockPtr& Block = ReadBlocks[BlockIndex - FirstBlockIndex];
+		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeRemoteFileHandle::WaitForBlock);
+			if (!Block->Ready.WaitUntil(Deadline))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read block %lld of the remote file %s: it was not received within %f seconds"), BlockIndex, *URL, Settings.WaitTimeout);
+				return false;
+			}
+			if (!Block->Ready.Get())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read block %lld of the remote file %s"), BlockIndex, *URL);
+				return false;
+			}
+		}
+
+		const int64 BlockStart = BlockIndex * Settings.BlockSize;
+		const int64 CopyStart = FMath::Max(Position + BytesRead, BlockStart) - BlockStart;
+		const int64 CopySize = FMath::Min<int64>(Block->Data.Num() - CopyStart, BytesToRead - BytesRead);
+		FMemory::Memcpy(Destination + BytesRead, Block->Data.GetData() + CopyStart, CopySize);
+		BytesRead += CopySize;
+	}
+
+	Position += BytesToRead;
+	LastReadEnd = Position;
+	return true;
+}
+
+bool FRuntimeRemoteFileHandle::Write(const uint8* Source, int64 BytesToWrite)
+{
+	UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to write to the remote file %s: remote files are read-only"), *URL);
+	return false;
+}
+
+bool FRuntimeRemoteFileHandle::Flush(const bool bFullFlush)
+{
+	return true;
+}
+
+bool FRuntimeRemoteFileHandle::Truncate(int64 NewSize)
+{
+	return false;
+}
+
+int64 FRuntimeRemoteFileHandle::Size()
+{
+	return FileSize;
+}
+
+int64 FRuntimeRemoteFileHandle::GetNumRangeRequests() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return NumRangeRequests;
+}
+
+TArray<FRuntimeRemoteFileHandle::FBlockPtr> FRuntimeRemoteFileHandle::RequestBlocks(int64 FirstBlockIndex, int64 LastBlockIndex)
+{
+	TArray<FBlockPtr> RequestedBlocks;
+
+	// Runs of adjacent missing blocks, each fetched with a single range request
+	struct FMissingRun
+	{
+		int64 FirstBlockIndex;
+		TArray<FBlockPtr> Blocks;
+		TArray<TSharedPtr<TPromise<bool>, ESPMode::ThreadSafe>> Promises;
+	};
+	TArray<FMissingRun> MissingRuns;
+
+	{
+		FScopeLock Lock(&CriticalSection);
+		for (int64 BlockIndex = FirstBlockIndex; BlockIndex <= LastBlockIndex; ++BlockIndex)
+		{
+			// Blocks that failed to download are requested again
+			FBlockPtr* ExistingBlock = Blocks.Find(BlockIndex);
+			if (ExistingBlock && (!(*ExistingBlock)->Ready.IsReady() || (*ExistingBlock)->Ready.Get()))
+			{
+				(*ExistingBlock)->LastUsed = ++UseCounter;
+				RequestedBlocks.Add(*ExistingBlock);
+				continue;
+			}
+
+			FBlockPtr Block = MakeShared<FBlock, ESPMode::ThreadSafe>();
+			TSharedPtr<TPromise<bool>, ESPMode::ThreadSafe> PromisePtr = MakeShared<TPromise<bool>, ESPMode::ThreadSafe>();
+			Block->Ready = PromisePtr->GetFuture().Share();
+			Block->LastUsed = ++UseCounter;
+			Blocks.Emplace(BlockIndex, Block);
+			RequestedBlocks.Add(Block);
+
+			if (MissingRuns.Num() == 0 || MissingRuns.Last().FirstBlockIndex + MissingRuns.Last().Blocks.Num() != BlockIndex)
+			{
+				MissingRuns.Add(FMissingRun{BlockIndex, {}, {}});
+			}
+			MissingRuns.Last().Blocks.Add(Block);
+			MissingRuns.Last().Promises.Add(PromisePtr);
+		}
+
+		NumRangeRequests += MissingRuns.Num();
+		EvictBlocks_Locked();
+	}
+
+	for (FMissingRun& MissingRun : MissingRuns)
+	{
+		const int64 RangeStart = MissingRun.FirstBlockIndex * Settings.BlockSize;
+		const int64 RangeEnd = FMath::Min((MissingRun.FirstBlockIndex + MissingRun.Blocks.Num()) * Settings.BlockSize, FileSize) - 1;
+		const int64 BlockSize = Settings.BlockSize;
+
+		Downloader->DownloadFileByChunk(URL, Settings.Timeout, FString(), FileSize, FInt64Vector2(RangeStart, RangeEnd), [](int64, int64) {}).Next([URL = URL, BlockSize, MissingRun = MoveTemp(MissingRun)](FRuntimeChunkDownloaderResult&& Result)
+		{
+			RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeRemoteFileHandle::SplitBlocks);
+
+			const bool bSuccess = Result.Result == EDownloadToMemoryResult::Success;
+			if (!bSuccess)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download blocks %lld-%lld of the remote file %s: %s"), MissingRun.FirstBlockIndex, MissingRun.FirstBlockIndex + MissingRun.Blocks.Num() - 1, *URL, *UEnum::GetValueAsString(Result.Result));
+			}
+
+			for (int32 Index = 0; Index < MissingRun.Blocks.Num(); ++Index)
+			{
+				if (bSuccess)
+				{
+					RUNTIMEFILESDOWNLOADER_LLM_SCOPE();
+					const int64 BlockOffset = Index * BlockSize;
+					const int64 BlockDataSize = FMath::Min(BlockSize, Result.Data.Num() - BlockOffset);
+					MissingRun.Blocks[Index]->Data.Append(Result.Data.GetData() + BlockOffset, FMath::Max<int64>(BlockDataSize, 0));
+				}
+				MissingRun.Promises[Index]->SetValue(bSuccess && MissingRun.Blocks[Index]->Data.Num() > 0);
+			}
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(Result.Data));
+		});
+	}
+
+	return RequestedBlocks;
+}
+
+void FRuntimeRemoteFileHandle::EvictBlocks_Locked()
+{
+	while (Blocks.Num() > Settings.MaxCachedBlocks)
+	{
+		// The cache is small, so finding the least recently used block with a linear scan is cheaper than maintaining a list
+		int64 EvictedBlockIndex = INDEX_NONE;
+		uint64 EvictedLastUsed = TNumericLimits<uint64>::Max();
+		for (const TPair<int64, FBlockPtr>& Block : Blocks)
+		{
+			if (Block.Value->LastUsed < EvictedLastUsed)
+			{
+				EvictedBlockIndex = Block.Key;
+				EvictedLastUsed = Block.Value->LastUsed;
+			}
+		}
+		Blocks.Remove(EvictedBlockIndex);
+	}
+}
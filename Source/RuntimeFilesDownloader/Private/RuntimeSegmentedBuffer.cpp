@@ -0,0 +1,134 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeSegmentedBuffer.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "Algo/BinarySearch.h"
+
+void FRuntimeSegmentedBuffer::AppendSegment(TArray64<uint8>&& Data)
+{
+	AppendSegment(FRuntimeSharedBuffer::MakeOwned(MoveTemp(Data)));
+}
+
+void FRuntimeSegmentedBuffer::AppendSegment(const FRuntimeSharedBuffer& Buffer)
+{
+	if (Buffer.IsEmpty())
+	{
+		return;
+	}
+
+	SegmentOffsets.Add(TotalSize);
+	Segments.Add(Buffer);
+	TotalSize += Buffer.Num();
+}
+
+void FRuntimeSegmentedBuffer::Reset()
+{
+	Segments.Reset();
+	SegmentOffsets.Reset();
+	TotalSize = 0;
+}
+
+int32 FRuntimeSegmentedBuffer::FindSegmentIndex(int64 Offset) const
+{
+	if (Offset < 0 || Offset >= TotalSize)
+	{
+		return INDEX_NONE;
+	}
+
+	// The segment containing the offset is the last one starting at or before it
+	return Algo::UpperBound(SegmentOffsets, Offset) - 1;
+}
+
+TArray<TArrayView64<const uint8>> FRuntimeSegmentedBuffer::GetViews(int64 Offset, int64 Size) const
+{
+	TArray<TArrayView64<const uint8>> Views;
+
+	int32 SegmentIndex = FindSegmentIndex(Offset);
+	if (SegmentIndex == INDEX_NONE)
+	{
+		return Views;
+	}
+
+	int64 RemainingSize = FMath::Min(Size, TotalSize - Offset);
+	int64 OffsetInSegment = Offset - SegmentOffsets[SegmentIndex];
+	while (RemainingSize > 0 && SegmentIndex < Segments.Num())
+	{
+		const FRuntimeSharedBuffer& Segment = Segments[SegmentIndex];
+		const int64 ViewSize = FMath::Min(RemainingSize, Segment.Num() - OffsetInSegment);
+		Views.Add(Segment.GetView(OffsetInSegment, ViewSize));
+
+		RemainingSize -= ViewSize;
+		OffsetInSegment = 0;
+		++SegmentIndex;
+	}
+	return Views;
+}
+
+int64 FRuntimeSegmentedBuffer::CopyTo(int64 Offset, uint8* Destination, int64 Size) const
+{
+	int64 CopiedSize = 0;
+	for (const TArrayView64<const uint8>& View : GetViews(Offset, Size))
+	{
+		FMemory::Memcpy(Destination + CopiedSize, View.GetData(), View.Num());
+		CopiedSize += View.Num();
+	}
+	return CopiedSize;
+}
+
+TArray64<uint8> FRuntimeSegmentedBuffer::ToContiguousArray() const
+{
+	TArray64<uint8> Data;
+	Data.SetNumUninitialized(TotalSize);
+	CopyTo(0, Data.GetData(), TotalSize);
+	return Data;
+}
+
+FRuntimeSegmentedBufferReader::FRuntimeSegmentedBufferReader(const FRuntimeSegmentedBuffer& InBuffer)
+	: Buffer(InBuffer)
+{
+	SetIsLoading(true);
+	SetIsPersistent(false);
+}
+
+void FRuntimeSegmentedBufferReader::Serialize(void* Data, int64 Num)
+{
+	if (Num <= 0 || IsError())
+	{
+		return;
+	}
+
+	if (Position + Num > Buffer.Num())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Attempted to read %lld bytes at position %lld past the end of the segmented buffer (%lld bytes)"), Num, Position, Buffer.Num());
+		SetError();
+		return;
+	}
+
+	Position += Buffer.CopyTo(Position, static_cast<uint8*>(Data), Num);
+}
+
+int64 FRuntimeSegmentedBufferReader::Tell()
+{
+	return Position;
+}
+
+int64 FRuntimeSegmentedBufferReader::TotalSize()
+{
+	return Buffer.Num();
+}
+
+void FRuntimeSegmentedBufferReader::Seek(int64 InPos)
+{
+	if (InPos < 0 || InPos > Buffer.Num())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Attempted to seek to position %lld outside of the segmented buffer (%lld bytes)"), InPos, Buffer.Num());
+		SetError();
+		return;
+	}
+	Position = InPos;
+}
+
+FString FRuntimeSegmentedBufferReader::GetArchiveName() const
+{
+	return TEXT("FRuntimeSegmentedBufferReader");
+}
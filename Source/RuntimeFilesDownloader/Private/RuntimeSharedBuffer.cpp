@@ -0,0 +1,174 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeSharedBuffer.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+
+namespace RuntimeSharedBuffer
+{
+	/**
+	 * Shared buffer storage holding the data in memory
+	 */
+	class FArrayStorage : public FRuntimeSharedBufferStorage
+	{
+	public:
+		explicit FArrayStorage(TArray64<uint8>&& InData)
+			: Data(MoveTemp(InData))
+		{
+		}
+
+		virtual const uint8* GetData() const override
+		{
+			return Data.GetData();
+		}
+
+		virtual int64 Num() const override
+		{
+			return Data.Num();
+		}
+
+		virtual TArray64<uint8>* GetArray() override
+		{
+			return &Data;
+		}
+
+	private:
+		TArray64<uint8> Data;
+	};
+
+	/**
+	 * Shared buffer storage holding the data in a read-only memory-mapped file
+	 */
+	class FMappedFileStorage : public FRuntimeSharedBufferStorage
+	{
+	public:
+		FMappedFileStorage(const FString& InFilePath, IMappedFileHandle* InMappedFileHandle, IMappedFileRegion* InMappedFileRegion, bool bInDeleteFileOnRelease)
+			: FilePath(InFilePath)
+			, MappedFileHandle(InMappedFileHandle)
+			, MappedFileRegion(InMappedFileRegion)
+			, bDeleteFileOnRelease(bInDeleteFileOnRelease)
+		{
+		}
+
+		virtual ~FMappedFileStorage() override
+		{
+			// The region must be unmapped before the handle is closed, and the file can only be deleted afterwards
+			MappedFileRegion.Reset();
+			MappedFileHandle.Reset();
+			if (bDeleteFileOnRelease && !IFileManager::Get().Delete(*FilePath, false, true, true))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to delete the mapped file '%s'"), *FilePath);
+			}
+		}
+
+		virtual const uint8* GetData() const override
+		{
+			return MappedFileRegion->GetMappedPtr();
+		}
+
+		virtual int64 Num() const override
+		{
+			return MappedFileRegion->GetMappedSize();
+		}
+
+		virtual bool IsFileBacked() const override
+		{
+			return true;
+		}
+
+	private:
+		FString FilePath;
+		TUniquePtr<IMappedFileHandle> MappedFileHandle;
+		TUniquePtr<IMappedFileRegion> MappedFileRegion;
+		bool bDeleteFileOnRelease;
+	};
+}
+
+FRuntimeSharedBuffer FRuntimeSharedBuffer::MakeOwned(TArray64<uint8>&& Data)
+{
+	FRuntimeSharedBuffer Buffer;
+	Buffer.Size = Data.Num();
+	Buffer.Storage = MakeShared<RuntimeSharedBuffer::FArrayStorage, ESPMode::ThreadSafe>(MoveTemp(Data));
+	return Buffer;
+}
+
+FRuntimeSharedBuffer FRuntimeSharedBuffer::MakeMappedFile(const FString& FilePath, bool bDeleteFileOnRelease)
+{
+	TUniquePtr<IMappedFileHandle> MappedFileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (!MappedFileHandle.IsValid() || MappedFileHandle->GetFileSize() <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the file '%s' for memory mapping"), *FilePath);
+		return FRuntimeSharedBuffer();
+	}
+
+	TUniquePtr<IMappedFileRegion> MappedFileRegion(MappedFileHandle->MapRegion(0, MappedFileHandle->GetFileSize()));
+	if (!MappedFileRegion.IsValid())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to map %lld bytes of the file '%s'"), MappedFileHandle->GetFileSize(), *FilePath);
+		return FRuntimeSharedBuffer();
+	}
+
+	FRuntimeSharedBuffer Buffer;
+	Buffer.Size = MappedFileRegion->GetMappedSize();
+	Buffer.Storage = MakeShared<RuntimeSharedBuffer::FMappedFileStorage, ESPMode::ThreadSafe>(FilePath, MappedFileHandle.Release(), MappedFileRegion.Release(), bDeleteFileOnRelease);
+	return Buffer;
+}
+
+FRuntimeSharedBuffer FRuntimeSharedBuffer::MakeCopy(const uint8* Data, int64 Size)
+{
+	TArray64<uint8> CopiedData;
+	if (Data && Size > 0)
+	{
+		CopiedData.Append(Data, Size);
+	}
+	return MakeOwned(MoveTemp(CopiedData));
+}
+
+TArrayView64<const uint8> FRuntimeSharedBuffer::GetView(int64 ViewOffset, int64 ViewSize) const
+{
+	const int64 ClampedOffset = FMath::Clamp<int64>(ViewOffset, 0, Size);
+	const int64 ClampedSize = FMath::Clamp<int64>(ViewSize, 0, Size - ClampedOffset);
+	return TArrayView64<const uint8>(GetData() + ClampedOffset, ClampedSize);
+}
+
+FRuntimeSharedBuffer FRuntimeSharedBuffer::Slice(int64 SliceOffset, int64 SliceSize) const
+{
+	const int64 ClampedOffset = FMath::Clamp<int64>(SliceOffset, 0, Size);
+
+	FRuntimeSharedBuffer Buffer;
+	Buffer.Storage = Storage;
+	Buffer.Offset = Offset + ClampedOffset;
+	Buffer.Size = FMath::Clamp<int64>(SliceSize, 0, Size - ClampedOffset);
+	return Buffer;
+}
+
+TArray64<uint8> FRuntimeSharedBuffer::ToArray() const
+{
+	TArray64<uint8> Data;
+	if (Size > 0)
+	{
+		Data.Append(GetData(), Size);
+	}
+	return Data;
+}
+
+TArray64<uint8> FRuntimeSharedBuffer::MoveToArray()
+{
+	TArray64<uint8> Data;
+	if (Storage.IsValid() && Storage.IsUnique() && Storage->GetArray() && Offset == 0 && Size == Storage->Num())
+	{
+		Data = MoveTemp(*Storage->GetArray());
+	}
+	else
+	{
+		Data = ToArray();
+	}
+
+	Storage.Reset();
+	Offset = 0;
+	Size = 0;
+	return Data;
+}
@@ -0,0 +1,155 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeStallMonitor.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderTrace.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+namespace RuntimeStallMonitor
+{
+	/** How often the watched requests are checked, in seconds */
+	constexpr float CheckInterval = 0.25f;
+
+	/** The time between two checks above which the game thread is considered to have hitched, in seconds */
+	constexpr double HitchThreshold = 4 * CheckInterval;
+}
+
+FRuntimeStallMonitor& FRuntimeStallMonitor::Get()
+{
+	static FRuntimeStallMonitor StallMonitor;
+	return StallMonitor;
+}
+
+uint64 FRuntimeStallMonitor::Register(const FString& Name, const FRuntimeLowSpeedLimit& Limit, TFunction<void()> OnStalled)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	// The ticker is added lazily, since the core ticker may not exist yet when the singleton is first accessed
+	if (!TickerHandle.IsValid())
+	{
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimeStallMonitor::Tick), RuntimeStallMonitor::CheckInterval);
+#else
+		TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimeStallMonitor::Tick), RuntimeStallMonitor::CheckInterval);
+#endif
+	}
+
+	const uint64 Handle = NextHandle++;
+	FStallEntry& Entry = Entries.Add(Handle);
+	Entry.Name = Name;
+	Entry.Limit = Limit;
+	Entry.OnStalled = MoveTemp(OnStalled);
+	Entry.StartTime = FPlatformTime::Seconds();
+	Entry.LastByteTime = Entry.StartTime;
+	Entry.Samples.Add(TPair<double, int64>(Entry.StartTime, 0));
+	return Handle;
+}
+
+void FRuntimeStallMonitor::Report(uint64 Handle, int64 BytesReceived)
+{
+	FScopeLock Lock(&CriticalSection);
+	if (FStallEntry* Entry = Entries.Find(Handle))
+	{
+		if (BytesReceived > Entry->BytesReceived)
+		{
+			Entry->BytesReceived = BytesReceived;
+			Entry->LastByteTime = FPlatformTime::Seconds();
+		}
+	}
+}
+
+void FRuntimeStallMonitor::Unregister(uint64 Handle)
+{
+	FScopeLock Lock(&CriticalSection);
+	Entries.Remove(Handle);
+}
+
+void FRuntimeStallMonitor::Shutdown()
+{
+	FScopeLock Lock(&CriticalSection);
+	if (TickerHandle.IsValid())
+	{
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#else
+		FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#endif
+		TickerHandle.Reset();
+	}
+	Entries.Empty();
+}
+
+bool FRuntimeStallMonitor::Tick(float DeltaTime)
+{
+	RUNTIMEFILESDOWNLOADER_TRACE_SCOPE(FRuntimeStallMonitor::Tick);
+
+	TArray<TFunction<void()>> StalledFunctions;
+	{
+		FScopeLock Lock(&CriticalSection);
+		const double Now = FPlatformTime::Seconds();
+
+		// No progress could be dispatched during a hitch, so the clocks of the requests are moved past it, as if it had not happened
+		const double TimeSinceLastTick = LastTickTime > 0 ? Now - LastTickTime : 0;
+		const double HitchTime = TimeSinceLastTick > RuntimeStallMonitor::HitchThreshold ? TimeSinceLastTick - RuntimeStallMonitor::CheckInterval : 0;
+		LastTickTime = Now;
+		if (HitchTime > 0 && Entries.Num() > 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("The stall check was delayed by %.2f seconds, leaving the hitch out of the progress of %d requests"), HitchTime, Entries.Num());
+		}
+
+		for (auto EntryIt = Entries.CreateIterator(); EntryIt; ++EntryIt)
+		{
+			FStallEntry& Entry = EntryIt.Value();
+			if (HitchTime > 0)
+			{
+				Entry.LastByteTime = FMath::Min(Entry.LastByteTime + HitchTime, Now);
+				for (TPair<double, int64>& Sample : Entry.Samples)
+				{
+					Sample.Key = FMath::Min(Sample.Key + HitchTime, Now);
+				}
+			}
+
+			const double IdleTime = Now - Entry.LastByteTime;
+			bool bStalled = Entry.Limit.IdleTimeout > 0 && IdleTime > Entry.Limit.IdleTimeout;
+			if (bStalled)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Request to %s stalled: no data received for %.2f seconds after %lld bytes"), *Entry.Name, IdleTime, Entry.BytesReceived);
+			}
+
+			if (!bStalled && Entry.Limit.MinBytesPerSecond > 0)
+			{
+				// Only the oldest sample within the window is needed, the ones before it are dropped
+				Entry.Samples.Add(TPair<double, int64>(Now, Entry.BytesReceived));
+				while (Entry.Samples.Num() > 1 && Entry.Samples[1].Key <= Now - Entry.Limit.WindowSeconds)
+				{
+					Entry.Samples.RemoveAt(0);
+				}
+
+				const double WindowTime = Now - Entry.Samples[0].Key;
+				if (WindowTime >= Entry.Limit.WindowSeconds)
+				{
+					const double BytesPerSecond = (Entry.BytesReceived - Entry.Samples[0].Value) / WindowTime;
+					bStalled = BytesPerSecond < Entry.Limit.MinBytesPerSecond;
+					if (bStalled)
+					{
+						UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Request to %s stalled: %.0f bytes per second over the last %.2f seconds, below the limit of %.0f"), *Entry.Name, BytesPerSecond, WindowTime, Entry.Limit.MinBytesPerSecond);
+					}
+				}
+			}
+
+			if (bStalled)
+			{
+				StalledFunctions.Add(MoveTemp(Entry.OnStalled));
+				EntryIt.RemoveCurrent();
+			}
+		}
+	}
+
+	// Stalled requests are usually canceled, which may complete them synchronously, so this is done outside of the lock
+	for (const TFunction<void()>& OnStalled : StalledFunctions)
+	{
+		OnStalled();
+	}
+	return true;
+}
@@ -0,0 +1,313 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeTextDecoder.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "Misc/EngineVersionComparison.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif
+
+namespace RuntimeTextDecoder
+{
+	/**
+	 * Write a code point to the output, as a surrogate pair if TCHAR is 16-bit and the code point is outside of the BMP
+	 */
+	FORCEINLINE void WriteCodePoint(TCHAR*& Output, uint32 CodePoint)
+	{
+		if (sizeof(TCHAR) == 2 && CodePoint > 0xFFFF)
+		{
+			CodePoint -= 0x10000;
+			*Output++ = static_cast<TCHAR>(0xD800 + (CodePoint >> 10));
+			*Output++ = static_cast<TCHAR>(0xDC00 + (CodePoint & 0x3FF));
+			return;
+		}
+		*Output++ = static_cast<TCHAR>(CodePoint);
+	}
+
+	/**
+	 * Widen single bytes to TCHARs. Kept as a plain loop so that compilers can vectorize it
+	 */
+	FORCEINLINE void WidenBytes(TCHAR*& Output, const uint8* Data, int64 Size)
+	{
+		for (int64 Index = 0; Index < Size; ++Index)
+		{
+			Output[Index] = static_cast<TCHAR>(Data[Index]);
+		}
+		Output += Size;
+	}
+
+	FORCEINLINE bool IsContinuationByte(uint8 Byte)
+	{
+		return (Byte & 0xC0) == 0x80;
+	}
+
+	/**
+	 * Get the length of the well-formed UTF-8 sequence starting with the specified bytes, or 0 if the sequence is malformed
+	 */
+	int32 GetUTF8SequenceLength(const uint8* Data, int64 Size)
+	{
+		const uint8 Lead = Data[0];
+		if (Lead < 0x80)
+		{
+			return 1;
+		}
+
+		int32 Length;
+		uint8 MinSecond = 0x80;
+		uint8 MaxSecond = 0xBF;
+		if (Lead >= 0xC2 && Lead <= 0xDF)
+		{
+			Length = 2;
+		}
+		else if (Lead >= 0xE0 && Lead <= 0xEF)
+		{
+			Length = 3;
+			// Reject overlong encodings and UTF-16 surrogates
+			MinSecond = Lead == 0xE0 ? 0xA0 : 0x80;
+			MaxSecond = Lead == 0xED ? 0x9F : 0xBF;
+		}
+		else if (Lead >= 0xF0 && Lead <= 0xF4)
+		{
+			Length = 4;
+			// Reject overlong encodings and code points above U+10FFFF
+			MinSecond = Lead == 0xF0 ? 0x90 : 0x80;
+			MaxSecond = Lead == 0xF4 ? 0x8F : 0xBF;
+		}
+		else
+		{
+			return 0;
+		}
+
+		if (Size < Length || Data[1] < MinSecond || Data[1] > MaxSecond)
+		{
+			return 0;
+		}
+
+		for (int32 Index = 2; Index < Length; ++Index)
+		{
+			if (!IsContinuationByte(Data[Index]))
+			{
+				return 0;
+			}
+		}
+		return Length;
+	}
+
+	/**
+	 * Allocate the character buffer of a string once, for the maximum number of characters the decoded data can produce
+	 */
+	TCHAR* BeginString(FString& String, int64 MaxChars)
+	{
+		TArray<TCHAR>& Chars = String.GetCharArray();
+		Chars.SetNumUninitialized(static_cast<int32>(MaxChars) + 1);
+		return Chars.GetData();
+	}
+
+	/**
+	 * Trim the character buffer of a string to the number of characters actually written and terminate it
+	 */
+	void EndString(FString& String, const TCHAR* Output)
+	{
+		TArray<TCHAR>& Chars = String.GetCharArray();
+		const int32 NumChars = static_cast<int32>(Output - Chars.GetData());
+		if (NumChars == 0)
+		{
+			Chars.Empty();
+			return;
+		}
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+		Chars.SetNum(NumChars + 1, EAllowShrinking::No);
+#else
+		Chars.SetNum(NumChars + 1, false);
+#endif
+		Chars[NumChars] = TEXT('\0');
+	}
+}
+
+ERuntimeTextEncoding FRuntimeTextDecoder::DetectEncoding(const uint8* Data, int64 Size, int32& OutBOMSize)
+{
+	OutBOMSize = 0;
+
+	if (Size >= 3 && Data[0] == 0xEF && Data[1] == 0xBB && Data[2] == 0xBF)
+	{
+		OutBOMSize = 3;
+		return ERuntimeTextEncoding::UTF8;
+	}
+
+	if (Size >= 2 && Data[0] == 0xFF && Data[1] == 0xFE)
+	{
+		OutBOMSize = 2;
+		return ERuntimeTextEncoding::UTF16LE;
+	}
+
+	if (Size >= 2 && Data[0] == 0xFE && Data[1] == 0xFF)
+	{
+		OutBOMSize = 2;
+		return ERuntimeTextEncoding::UTF16BE;
+	}
+
+	const int64 ASCIISize = CountLeadingASCII(Data, Size);
+	return IsValidUTF8(Data + ASCIISize, Size - ASCIISize) ? ERuntimeTextEncoding::UTF8 : ERuntimeTextEncoding::Latin1;
+}
+
+FString FRuntimeTextDecoder::Decode(const uint8* Data, int64 Size)
+{
+	if (!Data || Size <= 0)
+	{
+		return FString();
+	}
+
+	int32 BOMSize;
+	const ERuntimeTextEncoding Encoding = DetectEncoding(Data, Size, BOMSize);
+	return Decode(Data + BOMSize, Size - BOMSize, Encoding);
+}
+
+FString FRuntimeTextDecoder::Decode(const uint8* Data, int64 Size, ERuntimeTextEncoding Encoding)
+{
+	if (!Data || Size <= 0)
+	{
+		return FString();
+	}
+
+	if (Size >= TNumericLimits<int32>::Max())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to convert %lld bytes to a string: a string can hold a maximum of %d characters"), Size, TNumericLimits<int32>::Max() - 1);
+		return FString();
+	}
+
+	FString Result;
+
+	switch (Encoding)
+	{
+	case ERuntimeTextEncoding::UTF8:
+	{
+		// A UTF-8 sequence never produces more TCHARs than it has bytes
+		TCHAR* Output = RuntimeTextDecoder::BeginString(Result, Size);
+		int64 Index = 0;
+		while (Index < Size)
+		{
+			const int64 ASCIISize = CountLeadingASCII(Data + Index, Size - Index);
+			RuntimeTextDecoder::WidenBytes(Output, Data + Index, ASCIISize);
+			Index += ASCIISize;
+			if (Index >= Size)
+			{
+				break;
+			}
+
+			const int32 SequenceLength = RuntimeTextDecoder::GetUTF8SequenceLength(Data + Index, Size - Index);
+			if (SequenceLength == 0)
+			{
+				// Keep malformed bytes visible instead of failing the whole conversion
+				RuntimeTextDecoder::WriteCodePoint(Output, 0xFFFD);
+				++Index;
+				continue;
+			}
+
+			uint32 CodePoint = Data[Index] & (0xFF >> (SequenceLength + 1));
+			for (int32 ByteIndex = 1; ByteIndex < SequenceLength; ++ByteIndex)
+			{
+				CodePoint = (CodePoint << 6) | (Data[Index + ByteIndex] & 0x3F);
+			}
+			RuntimeTextDecoder::WriteCodePoint(Output, CodePoint);
+			Index += SequenceLength;
+		}
+		RuntimeTextDecoder::EndString(Result, Output);
+		break;
+	}
+	case ERuntimeTextEncoding::UTF16LE:
+	case ERuntimeTextEncoding::UTF16BE:
+	{
+		const bool bBigEndian = Encoding == ERuntimeTextEncoding::UTF16BE;
+		const int64 NumCodeUnits = Size / 2;
+		TCHAR* Output = RuntimeTextDecoder::BeginString(Result, NumCodeUnits);
+		for (int64 UnitIndex = 0; UnitIndex < NumCodeUnits; ++UnitIndex)
+		{
+			const uint8* UnitData = Data + UnitIndex * 2;
+			const uint32 CodeUnit = bBigEndian ? (UnitData[0] << 8) | UnitData[1] : (UnitData[1] << 8) | UnitData[0];
+
+			// Combine surrogate pairs when TCHAR is wide enough to hold any code point
+			if (sizeof(TCHAR) == 4 && CodeUnit >= 0xD800 && CodeUnit <= 0xDBFF && UnitIndex + 1 < NumCodeUnits)
+			{
+				const uint8* NextUnitData = UnitData + 2;
+				const uint32 NextCodeUnit = bBigEndian ? (NextUnitData[0] << 8) | NextUnitData[1] : (NextUnitData[1] << 8) | NextUnitData[0];
+				if (NextCodeUnit >= 0xDC00 && NextCodeUnit <= 0xDFFF)
+				{
+					RuntimeTextDecoder::WriteCodePoint(Output, 0x10000 + ((CodeUnit - 0xD800) << 10) + (NextCodeUnit - 0xDC00));
+					++UnitIndex;
+					continue;
+				}
+			}
+			*Output++ = static_cast<TCHAR>(CodeUnit);
+		}
+		RuntimeTextDecoder::EndString(Result, Output);
+		break;
+	}
+	case ERuntimeTextEncoding::Latin1:
+	default:
+	{
+		TCHAR* Output = RuntimeTextDecoder::BeginString(Result, Size);
+		RuntimeTextDecoder::WidenBytes(Output, Data, Size);
+		RuntimeTextDecoder::EndString(Result, Output);
+		break;
+	}
+	}
+
+	return Result;
+}
+
+int64 FRuntimeTextDecoder::CountLeadingASCII(const uint8* Data, int64 Size)
+{
+	int64 Index = 0;
+
+#if PLATFORM_CPU_X86_FAMILY
+	// Check 16 bytes at a time: the sign bit of each byte is set only for non-ASCII bytes
+	for (; Index + 16 <= Size; Index += 16)
+	{
+		const __m128i Block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data + Index));
+		const int32 NonASCIIMask = _mm_movemask_epi8(Block);
+		if (NonASCIIMask != 0)
+		{
+			return Index + FMath::CountTrailingZeros(static_cast<uint32>(NonASCIIMask));
+		}
+	}
+#endif
+
+	// Check 8 bytes at a time on other platforms and for the remainder
+	for (; Index + 8 <= Size; Index += 8)
+	{
+		uint64 Block;
+		FMemory::Memcpy(&Block, Data + Index, sizeof(Block));
+		if ((Block & 0x8080808080808080ull) != 0)
+		{
+			break;
+		}
+	}
+
+	while (Index < Size && Data[Index] < 0x80)
+	{
+		++Index;
+	}
+	return Index;
+}
+
+bool FRuntimeTextDecoder::IsValidUTF8(const uint8* Data, int64 Size)
+{
+	int64 Index = 0;
+	while (Index < Size)
+	{
+		Index += CountLeadingASCII(Data + Index, Size - Index);
+		if (Index >= Size)
+		{
+			break;
+		}
+
+		const int32 SequenceLength = RuntimeTextDecoder::GetUTF8SequenceLength(Data + Index, Size - Index);
+		if (SequenceLength == 0)
+		{
+			return false;
+		}
+		Index += SequenceLength;
+	}
+	return true;
+}
@@ -0,0 +1,173 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeTextureDecoder.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Misc/ScopeLock.h"
+#include "Modules/ModuleManager.h"
+#include "UObject/Package.h"
+
+FRuntimeTextureDecoder& FRuntimeTextureDecoder::Get()
+{
+	static FRuntimeTextureDecoder Decoder;
+	return Decoder;
+}
+
+FRuntimeTextureDecoder::FRuntimeTextureDecoder()
+	: MaxConcurrentDecodes(FMath::Max(1, FPlatformMisc::NumberOfWorkerThreadsToSpawn() / 2))
+{
+}
+
+void FRuntimeTextureDecoder::DecodeAsync(const FRuntimeSharedBuffer& ImageData, TFunction<void(UTexture2D*)> OnComplete)
+{
+	if (!IsInGameThread())
+	{
+		AsyncTask(ENamedThreads::GameThread, [this, ImageData, OnComplete = MoveTemp(OnComplete)]() mutable
+		{
+			DecodeAsync(ImageData, MoveTemp(OnComplete));
+		});
+		return;
+	}
+
+	if (ImageData.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: the image data is empty"));
+		OnComplete(nullptr);
+		return;
+	}
+
+	// The module must be loaded on the game thread before it is used by the decode workers
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+	{
+		FScopeLock Lock(&CriticalSection);
+		PendingRequests.Add(FDecodeRequest{ImageData, MoveTemp(OnComplete)});
+	}
+	StartPendingDecodes();
+}
+
+void FRuntimeTextureDecoder::SetMaxConcurrentDecodes(int32 InMaxConcurrentDecodes)
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		MaxConcurrentDecodes = FMath::Max(1, InMaxConcurrentDecodes);
+	}
+	StartPendingDecodes();
+}
+
+int32 FRuntimeTextureDecoder::GetMaxConcurrentDecodes() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return MaxConcurrentDecodes;
+}
+
+void FRuntimeTextureDecoder::StartPendingDecodes()
+{
+	FScopeLock Lock(&CriticalSection);
+	while (PendingRequests.Num() > 0 && NumActiveDecodes < MaxConcurrentDecodes)
+	{
+		++NumActiveDecodes;
+		FDecodeRequest Request = MoveTemp(PendingRequests[0]);
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+		PendingRequests.RemoveAt(0, 1, EAllowShrinking::No);
+#else
+		PendingRequests.RemoveAt(0, 1, false);
+#endif
+
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, Request = MoveTemp(Request)]() mutable
+		{
+			Decode(MoveTemp(Request));
+
+			{
+				FScopeLock Lock(&CriticalSection);
+				--NumActiveDecodes;
+			}
+			StartPendingDecodes();
+		});
+	}
+}
+
+void FRuntimeTextureDecoder::Decode(FDecodeRequest&& Request)
+{
+	auto Finish = [OnComplete = MoveTemp(Request.OnComplete)](FTexturePlatformData* PlatformData) mutable
+	{
+		AsyncTask(ENamedThreads::GameThread, [OnComplete = MoveTemp(OnComplete), PlatformData]()
+		{
+			if (!PlatformData)
+			{
+				OnComplete(nullptr);
+				return;
+			}
+
+			// Only the texture object is created here, the pixel data has already been prepared on the worker thread
+			UTexture2D* Texture = NewObject<UTexture2D>(GetTransientPackage(), NAME_None, RF_Transient);
+#if UE_VERSION_NEWER_THAN(5, 0, 0)
+			Texture->SetPlatformData(PlatformData);
+#else
+			Texture->PlatformData = PlatformData;
+#endif
+			Texture->SRGB = true;
+			Texture->UpdateResource();
+			OnComplete(Texture);
+		});
+	};
+
+	IImageWrapperModule* ImageWrapperModule = FModuleManager::GetModulePtr<IImageWrapperModule>(FName("ImageWrapper"));
+	if (!ImageWrapperModule)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: the ImageWrapper module is not loaded"));
+		Finish(nullptr);
+		return;
+	}
+
+	const uint8* CompressedData = Request.ImageData.GetData();
+	const int64 CompressedSize = Request.ImageData.Num();
+
+	const EImageFormat ImageFormat = ImageWrapperModule->DetectImageFormat(CompressedData, CompressedSize);
+	if (ImageFormat == EImageFormat::Invalid)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: the image format could not be detected"));
+		Finish(nullptr);
+		return;
+	}
+
+	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule->CreateImageWrapper(ImageFormat);
+	TArray<uint8> RawData;
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(CompressedData, CompressedSize) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawData))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: the image data is corrupted or not supported"));
+		Finish(nullptr);
+		return;
+	}
+
+	const int32 Width = ImageWrapper->GetWidth();
+	const int32 Height = ImageWrapper->GetHeight();
+	if (Width <= 0 || Height <= 0 || RawData.Num() != Width * Height * 4)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: unexpected decoded size %dx%d (%d bytes)"), Width, Height, RawData.Num());
+		Finish(nullptr);
+		return;
+	}
+
+	FTexturePlatformData* PlatformData = new FTexturePlatformData();
+	PlatformData->SizeX = Width;
+	PlatformData->SizeY = Height;
+	PlatformData->PixelFormat = PF_B8G8R8A8;
+
+	FTexture2DMipMap* Mip = new FTexture2DMipMap();
+	Mip->SizeX = Width;
+	Mip->SizeY = Height;
+	PlatformData->Mips.Add(Mip);
+
+	Mip->BulkData.Lock(LOCK_READ_WRITE);
+	void* MipData = Mip->BulkData.Realloc(RawData.Num());
+	FMemory::Memcpy(MipData, RawData.GetData(), RawData.Num());
+	Mip->BulkData.Unlock();
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Decoded a %dx%d image from %lld bytes"), Width, Height, CompressedSize);
+	Finish(PlatformData);
+}
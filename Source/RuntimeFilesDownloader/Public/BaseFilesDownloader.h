@@ -5,6 +5,9 @@
 #include "Http.h"
 #include "Templates/SharedPointer.h"
 #include "Misc/EngineVersionComparison.h"
+#include "RuntimeDownloadTelemetry.h"
+#include "RuntimeCallbackDispatcher.h"
+#include <atomic>
 #include "BaseFilesDownloader.generated.h"
 
 /** Dynamic delegate to track download progress */
@@ -19,7 +22,32 @@ DECLARE_DYNAMIC_DELEGATE_OneParam(FOnGetDownloadContentLength, int64, ContentLen
 /** Static delegate to obtain download content length */
 DECLARE_DELEGATE_OneParam(FOnGetDownloadContentLengthNative, int64);
 
+/** Dynamic delegate to obtain a texture converted from bytes asynchronously */
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnBytesToTextureComplete, UTexture2D*, Texture);
+
+/** Static delegate to obtain a texture converted from bytes asynchronously */
+DECLARE_DELEGATE_OneParam(FOnBytesToTextureCompleteNative, UTexture2D*);
+
+/** Dynamic delegate to obtain the result of loading a file to an array asynchronously */
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnLoadFileToArrayComplete, bool, bSuccess, const TArray<uint8>&, Result);
+
+/** Static delegate to obtain the result of loading a file to an array asynchronously */
+DECLARE_DELEGATE_TwoParams(FOnLoadFileToArrayCompleteNative, bool, const TArray64<uint8>&);
+
+/** Dynamic delegate to obtain the result of loading a file to a string asynchronously */
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnLoadFileToStringComplete, bool, bSuccess, const FString&, Result);
+
+/** Static delegate to obtain the result of loading a file to a string asynchronously */
+DECLARE_DELEGATE_TwoParams(FOnLoadFileToStringCompleteNative, bool, const FString&);
+
+/** Dynamic delegate to obtain the result of saving a file asynchronously */
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnSaveFileComplete, bool, bSuccess);
+
+/** Static delegate to obtain the result of saving a file asynchronously */
+DECLARE_DELEGATE_OneParam(FOnSaveFileCompleteNative, bool);
+
 class UTexture2D;
+class FRuntimeSharedBuffer;
 
 /**
  * Base class for downloading files. It also contains some helper functions
@@ -65,7 +93,7 @@ public:
 	static void GetContentSize(const FString& URL, float Timeout, const FOnGetDownloadContentLengthNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
 
 	/**
-	 * Convert bytes to string
+	 * Convert bytes to string. The encoding (UTF-8, UTF-16 with a byte order mark, or Latin-1) is detected automatically
 	 *
 	 * @param Bytes Byte array to convert to string
 	 * @return Converted string, empty on failure
@@ -73,6 +101,22 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
 	static FString BytesToString(const TArray<uint8>& Bytes);
 
+	/**
+	 * Convert bytes to string. The encoding (UTF-8, UTF-16 with a byte order mark, or Latin-1) is detected automatically. Suitable for use in C++
+	 *
+	 * @param Bytes Byte array to convert to string
+	 * @return Converted string, empty on failure
+	 */
+	static FString BytesToString(const TArray64<uint8>& Bytes);
+
+	/**
+	 * Convert bytes to string. The encoding (UTF-8, UTF-16 with a byte order mark, or Latin-1) is detected automatically. Suitable for use in C++
+	 *
+	 * @param Bytes View of the bytes to convert to string, e.g. of a shared buffer
+	 * @return Converted string, empty on failure
+	 */
+	static FString BytesToString(TArrayView64<const uint8> Bytes);
+
 	/**
 	 * Convert bytes to texture. This is fully engine-based functionality and may not be well optimized
 	 *
@@ -82,6 +126,23 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
 	static UTexture2D* BytesToTexture(const TArray<uint8>& Bytes);
 
+	/**
+	 * Convert bytes to texture asynchronously. The image is decoded on a worker thread, with a limit on the number of concurrent decodes, so the game thread is not blocked
+	 *
+	 * @param Bytes Byte array to convert to texture
+	 * @param OnComplete Delegate broadcast on the game thread with the converted texture or nullptr on failure
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
+	static void BytesToTextureAsync(const TArray<uint8>& Bytes, const FOnBytesToTextureComplete& OnComplete);
+
+	/**
+	 * Convert bytes to texture asynchronously. The image is decoded on a worker thread, with a limit on the number of concurrent decodes, so the game thread is not blocked. Suitable for use in C++
+	 *
+	 * @param Bytes Shared buffer to convert to texture. It is referenced rather than copied while decoding
+	 * @param OnComplete Delegate broadcast on the game thread with the converted texture or nullptr on failure
+	 */
+	static void BytesToTextureAsync(const FRuntimeSharedBuffer& Bytes, const FOnBytesToTextureCompleteNative& OnComplete);
+
 	/**
 	 * Load a binary file to a dynamic array with two uninitialized bytes at end as padding
 	 *
@@ -124,6 +185,96 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
 	static bool SaveStringToFile(const FString& String, const FString& FilePath);
 
+	/**
+	 * Load a binary file to a dynamic array asynchronously. The file is read on a worker thread through a bounded I/O queue
+	 *
+	 * @param FilePath Path to the file to load
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not and the bytes representation of the loaded file
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
+	static void LoadFileToArrayAsync(const FString& FilePath, const FOnLoadFileToArrayComplete& OnComplete);
+
+	/**
+	 * Load a binary file to a dynamic array asynchronously. The file is read on a worker thread through a bounded I/O queue. Suitable for use in C++
+	 *
+	 * @param FilePath Path to the file to load
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not and the bytes representation of the loaded file
+	 */
+	static void LoadFileToArrayAsync(const FString& FilePath, const FOnLoadFileToArrayCompleteNative& OnComplete);
+
+	/**
+	 * Save a binary array to a file asynchronously. The file is written on a worker thread through a bounded I/O queue
+	 *
+	 * @param Bytes Byte array to save to file
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination, so the destination never contains a partially written file
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
+	static void SaveArrayToFileAsync(const TArray<uint8>& Bytes, const FString& FilePath, bool bAtomic, const FOnSaveFileComplete& OnComplete);
+
+	/**
+	 * Save a binary array to a file asynchronously. The file is written on a worker thread through a bounded I/O queue. Suitable for use in C++
+	 *
+	 * @param Bytes Byte array to save to file. It is moved into the I/O queue rather than copied
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination, so the destination never contains a partially written file
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not
+	 */
+	static void SaveArrayToFileAsync(TArray64<uint8>&& Bytes, const FString& FilePath, bool bAtomic, const FOnSaveFileCompleteNative& OnComplete);
+
+	/**
+	 * Save a shared buffer to a file asynchronously. The file is written on a worker thread through a bounded I/O queue. Suitable for use in C++
+	 *
+	 * @param Bytes Shared buffer to save to file. It is referenced rather than copied while saving
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination, so the destination never contains a partially written file
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not
+	 */
+	static void SaveArrayToFileAsync(const FRuntimeSharedBuffer& Bytes, const FString& FilePath, bool bAtomic, const FOnSaveFileCompleteNative& OnComplete);
+
+	/**
+	 * Load a text file to an FString asynchronously. The file is read on a worker thread through a bounded I/O queue
+	 * The encoding (UTF-8, UTF-16 with a byte order mark, or Latin-1) is detected automatically
+	 *
+	 * @param FilePath Path to the file to load
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not and the string representation of the loaded file
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
+	static void LoadFileToStringAsync(const FString& FilePath, const FOnLoadFileToStringComplete& OnComplete);
+
+	/**
+	 * Load a text file to an FString asynchronously. The file is read on a worker thread through a bounded I/O queue. Suitable for use in C++
+	 * The encoding (UTF-8, UTF-16 with a byte order mark, or Latin-1) is detected automatically
+	 *
+	 * @param FilePath Path to the file to load
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not and the string representation of the loaded file
+	 */
+	static void LoadFileToStringAsync(const FString& FilePath, const FOnLoadFileToStringCompleteNative& OnComplete);
+
+	/**
+	 * Write the string to a file asynchronously. The file is written on a worker thread through a bounded I/O queue
+	 * Supports all combination of ANSI/Unicode files and platforms
+	 *
+	 * @param String String to save to file
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination, so the destination never contains a partially written file
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
+	static void SaveStringToFileAsync(const FString& String, const FString& FilePath, bool bAtomic, const FOnSaveFileComplete& OnComplete);
+
+	/**
+	 * Write the string to a file asynchronously. The file is written on a worker thread through a bounded I/O queue. Suitable for use in C++
+	 * Supports all combination of ANSI/Unicode files and platforms
+	 *
+	 * @param String String to save to file
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination, so the destination never contains a partially written file
+	 * @param OnComplete Delegate broadcast on the game thread with whether the operation was successful or not
+	 */
+	static void SaveStringToFileAsync(const FString& String, const FString& FilePath, bool bAtomic, const FOnSaveFileCompleteNative& OnComplete);
+
 	/**
 	 * Returns true if this file was found, false otherwise
 	 *
@@ -133,12 +284,134 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
 	static bool IsFileExist(const FString& FilePath);
 
+	/**
+	 * Get the telemetry of this download: timings, throughput and request counters. Can be called at any time, including from the completion delegate
+	 *
+	 * @return The telemetry recorded so far, empty if the download has not started
+	 */
+	UFUNCTION(BlueprintPure, Category = "Runtime Files Downloader|Telemetry")
+	FRuntimeDownloadTelemetry GetDownloadTelemetry() const;
+
+	/**
+	 * Get the telemetry of the most recent downloads, from the oldest to the newest
+	 */
+	UFUNCTION(BlueprintPure, Category = "Runtime Files Downloader|Telemetry")
+	static TArray<FRuntimeDownloadTelemetry> GetRecentDownloadsTelemetry();
+
+	/**
+	 * Get the totals over all downloads since the start of the application
+	 */
+	UFUNCTION(BlueprintPure, Category = "Runtime Files Downloader|Telemetry")
+	static FRuntimeDownloadStatsTotals GetDownloadStatsTotals();
+
+	/**
+	 * Set how often download progress is reported. Progress updates are coalesced per request and dispatched once per frame at most
+	 *
+	 * @param MaxUpdatesPerSecond The maximum number of progress updates per second for each request, or 0 to report once per frame
+	 * @param MinBytesDelta The number of received bytes after which progress is reported regardless of the rate, or 0 to disable
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	static void SetProgressUpdateRate(float MaxUpdatesPerSecond = 10.f, int64 MinBytesDelta = 0);
+
+	/**
+	 * Set the maximum amount of memory held by downloads and uploads at the same time. Downloads that would exceed it wait in a queue until memory is released
+	 *
+	 * @param BudgetBytes The budget in bytes, or 0 for no limit
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	static void SetDownloadMemoryBudget(int64 BudgetBytes);
+
+	/**
+	 * Set whether downloads start with a range request for the first chunk instead of a HEAD request
+	 * This saves a round trip per download, and files that fit into the first chunk are downloaded with a single request. Servers without range support are handled by keeping the whole response
+	 *
+	 * @param bEnabled Whether the fast start is used by the downloads started from now on
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	static void SetFastStartEnabled(bool bEnabled);
+
+	/**
+	 * Set whether streamed and parallel downloads hedge straggling chunks, requesting them a second time and using whichever request completes first
+	 * Downloads that request one chunk at a time have no peers to compare against and are not hedged
+	 * How often hedging fired is reported by NumHedgedRequests and NumHedgeWins in the download telemetry
+	 *
+	 * @param bEnabled Whether the downloads started from now on hedge straggling chunks
+	 * @param ThroughputRatio A chunk is hedged once its throughput falls below this fraction of the median throughput of its peers
+	 * @param LatencyPercentile A chunk is hedged once it has been in flight for longer than this percentile of the durations of the completed chunks
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	static void SetHedgingEnabled(bool bEnabled, float ThroughputRatio = 0.25f, float LatencyPercentile = 0.95f);
+
+	/**
+	 * Set the number of connections downloads use. The file is split between the connections, and a connection that has finished its part takes over half of the largest remaining part, so that no connection is left idle while a slow one finishes
+	 *
+	 * @param MaxConnections The number of chunk requests in flight at the same time for each download started from now on, 1 to download the chunks one after another
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	static void SetMaxConnections(int32 MaxConnections = 1);
+
+	/**
+	 * Set the low-speed limit of chunk requests, separate from the timeout of the whole request. Chunk requests that fall below it are aborted and made again
+	 *
+	 * @param MinBytesPerSecond The minimum average throughput over the window, in bytes per second, 0 to disable
+	 * @param WindowSeconds The length of the sliding window the throughput is averaged over, in seconds
+	 * @param IdleTimeout The maximum time without receiving any byte, in seconds, 0 to disable
+	 * @param MaxRetries The number of times a stalled chunk is requested again before the download fails
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	static void SetLowSpeedLimit(float MinBytesPerSecond = 0.f, float WindowSeconds = 10.f, float IdleTimeout = 0.f, int32 MaxRetries = 3);
+
+	/**
+	 * Set where the native completion and progress delegates of this download are broadcast. Affects the delegates broadcast after the call, so it should be set right after starting the download
+	 * Errors detected while starting the download, such as an empty URL, are broadcast right away on the calling thread
+	 * Blueprint delegates are always broadcast on the game thread, and the downloader is always removed from the root set there, whatever the executor
+	 *
+	 * @param Executor Where the native delegates are broadcast. Delegates broadcast outside of the game thread must not touch UObjects that are not thread-safe
+	 */
+	void SetCallbackExecutor(ERuntimeCallbackExecutor Executor);
+
+	/**
+	 * Set where the native completion and progress delegates of the downloads started from now on are broadcast
+	 *
+	 * @param Executor Where the native delegates are broadcast by default
+	 */
+	static void SetDefaultCallbackExecutor(ERuntimeCallbackExecutor Executor = ERuntimeCallbackExecutor::GameThread);
+
+	/**
+	 * Set the time the delegates broadcast on the game thread may take per frame. Delegates exceeding it are broadcast on the next frame, in the same order
+	 *
+	 * @param MaxMilliseconds The budget in milliseconds, or 0 for no limit
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	static void SetGameThreadCallbackBudget(float MaxMilliseconds = 0.f);
+
 protected:
 	/**
 	 * Broadcast the progress both multi-cast and single-cast delegates
 	 */
 	void BroadcastProgress(int64 BytesReceived, int64 ContentLength, float ProgressRatio) const;
 
+	/**
+	 * Run a callback of the download on its callback executor
+	 */
+	void DispatchCallback(TUniqueFunction<void()>&& Callback) const;
+
+	/**
+	 * Run a callback on the game thread, right away if already on it. Used for Blueprint delegates, which must not be executed on any other thread
+	 */
+	static void RunOnGameThread(TUniqueFunction<void()>&& Callback);
+
+	/**
+	 * Remove the downloader from the root set on the game thread, since the root set must not be changed while the garbage collector may run
+	 */
+	void RemoveFromRootOnGameThread();
+
+	/** Where the callbacks of the download are run */
+	std::atomic<ERuntimeCallbackExecutor> CallbackExecutor;
+
+	/** Where the callbacks of the downloads started from now on are run */
+	static std::atomic<ERuntimeCallbackExecutor> DefaultCallbackExecutor;
+
 	/** Internal downloader */
 	TSharedPtr<class FRuntimeChunkDownloader> RuntimeChunkDownloaderPtr;
 };
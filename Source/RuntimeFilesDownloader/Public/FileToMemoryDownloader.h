@@ -3,6 +3,9 @@
 #pragma once
 
 #include "BaseFilesDownloader.h"
+#include "RuntimeSharedBuffer.h"
+#include "RuntimeSegmentedBuffer.h"
+#include "RuntimeChunkStream.h"
 #include "FileToMemoryDownloader.generated.h"
 
 /**
@@ -23,15 +26,30 @@ enum class EDownloadToMemoryResult : uint8
 /** Static delegate to track download completion */
 DECLARE_DELEGATE_TwoParams(FOnFileToMemoryDownloadCompleteNative, const TArray64<uint8>&, EDownloadToMemoryResult);
 
+/** Static delegate to track download completion, providing the downloaded content as a shared buffer */
+DECLARE_DELEGATE_TwoParams(FOnFileToMemoryDownloadCompleteSharedNative, const FRuntimeSharedBuffer&, EDownloadToMemoryResult);
+
+/** Static delegate to track download completion, providing the downloaded content as a segmented buffer */
+DECLARE_DELEGATE_TwoParams(FOnFileToMemoryDownloadCompleteSegmentedNative, const FRuntimeSegmentedBuffer&, EDownloadToMemoryResult);
+
 /** Dynamic delegate to track download completion */
 DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnFileToMemoryDownloadComplete, const TArray<uint8>&, DownloadedContent, EDownloadToMemoryResult, Result);
 
+/** Static delegate to track download to texture completion */
+DECLARE_DELEGATE_TwoParams(FOnFileToTextureDownloadCompleteNative, UTexture2D*, EDownloadToMemoryResult);
+
+/** Dynamic delegate to track download to texture completion */
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnFileToTextureDownloadComplete, UTexture2D*, Texture, EDownloadToMemoryResult, Result);
+
 /** Static delegate to track chunk download completion */
 DECLARE_DELEGATE_OneParam(FOnFileToMemoryChunkDownloadCompleteNative, const TArray64<uint8>&);
 
 /** Dynamic delegate to track chunk download completion */
 DECLARE_DYNAMIC_DELEGATE_OneParam(FOnFileToMemoryChunkDownloadComplete, const TArray<uint8>&, DownloadedContent);
 
+/** Static delegate to track streamed chunk download completion. The chunk must be acknowledged once it has been consumed */
+DECLARE_DELEGATE_OneParam(FOnFileToMemoryStreamedChunkDownloadCompleteNative, FRuntimeStreamedChunk&);
+
 /** Static delegate to track download completion */
 DECLARE_DELEGATE_OneParam(FOnFileToMemoryAllChunksDownloadCompleteNative, EDownloadToMemoryResult);
 
@@ -50,9 +68,18 @@ protected:
 	/** Static delegate for monitoring the completion of the download */
 	FOnFileToMemoryDownloadCompleteNative OnDownloadComplete;
 
+	/** Static delegate for monitoring the completion of the download with the content in a shared buffer */
+	FOnFileToMemoryDownloadCompleteSharedNative OnSharedDownloadComplete;
+
+	/** Static delegate for monitoring the completion of the download with the content in a segmented buffer */
+	FOnFileToMemoryDownloadCompleteSegmentedNative OnSegmentedDownloadComplete;
+
 	/** Static delegate for monitoring the completion of the chunk download */
 	FOnFileToMemoryChunkDownloadCompleteNative OnChunkDownloadComplete;
 
+	/** Static delegate for monitoring the completion of the streamed chunk download */
+	FOnFileToMemoryStreamedChunkDownloadCompleteNative OnStreamedChunkDownloadComplete;
+
 	/** Static delegate for monitoring the full completion of the chunks download */
 	FOnFileToMemoryAllChunksDownloadCompleteNative OnAllChunksDownloadComplete;
 
@@ -83,6 +110,73 @@ public:
 	 */
 	static UFileToMemoryDownloader* DownloadFileToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
 
+	/**
+	 * Download the file and save it in temporary memory (RAM) as a ref-counted immutable buffer. Suitable for use in C++
+	 * The downloaded data reaches the delegate without being copied, and the buffer can be kept or passed around without copying it
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param bForceByPayload If true, download the file regardless of the Content-Length header's presence (useful for servers without support for this header)
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 * @param Headers Additional headers to include in the request
+	 */
+	static UFileToMemoryDownloader* DownloadFileToMemoryShared(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSharedNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download the file into a shared buffer that is kept in temporary memory (RAM) for small files and spilled to a temporary memory-mapped file for large files. Suitable for use in C++
+	 * The buffer is accessed the same way regardless of where the data is stored, which allows downloading files larger than the available RAM
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param SpillThreshold The content size in bytes above which the data is stored in a temporary file instead of memory
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 * @param Headers Additional headers to include in the request
+	 */
+	static UFileToMemoryDownloader* DownloadFileToMemoryHybrid(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 SpillThreshold, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSharedNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download the file and save it in temporary memory (RAM) as a segmented buffer made of the downloaded chunks. Suitable for use in C++
+	 * The file never needs a single contiguous allocation, which allows downloading large files on fragmented heaps
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk (and thus each segment) in bytes
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 * @param Headers Additional headers to include in the request
+	 */
+	static UFileToMemoryDownloader* DownloadFileToMemorySegmented(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSegmentedNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download an image file and convert it to a texture. The image is decoded asynchronously on a worker thread
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the texture, or nullptr on failure, once the download and the conversion are complete
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Memory")
+	static UFileToMemoryDownloader* DownloadFileToTexture(const FString& URL, float Timeout, const FString& ContentType, const FOnDownloadProgress& OnProgress, const FOnFileToTextureDownloadComplete& OnComplete);
+
+	/**
+	 * Download an image file and convert it to a texture. The image is decoded asynchronously on a worker thread. Suitable for use in C++
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the texture, or nullptr on failure, once the download and the conversion are complete
+	 * @param Headers Additional headers to include in the request
+	 */
+	static UFileToMemoryDownloader* DownloadFileToTexture(const FString& URL, float Timeout, const FString& ContentType, const FOnDownloadProgressNative& OnProgress, const FOnFileToTextureDownloadCompleteNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
 	/**
 	 * Download the file and save it as a byte array in temporary memory (RAM). Continuously broadcasts the download result per chunk
 	 *
@@ -113,6 +207,22 @@ public:
 	static UFileToMemoryDownloader* DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryChunkDownloadCompleteNative& OnChunkDownloadComplete, const FOnFileToMemoryAllChunksDownloadCompleteNative& OnAllChunksDownloadComplete, const
 		TMap<FString, FString>& Headers = TMap<FString, FString>());
 
+	/**
+	 * Download the file as a stream of chunks with backpressure. Suitable for use in C++
+	 * Up to MaxOutstandingChunks chunks are downloaded in parallel and broadcast in order. Each chunk must be acknowledged with FRuntimeStreamedChunk::Acknowledge once consumed, which allows the next chunk to be requested
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param MaxOutstandingChunks The maximum number of chunks downloaded or held in memory at the same time, including unacknowledged chunks
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnChunkDownloadComplete Delegate for broadcasting each chunk, in order
+	 * @param OnAllChunksDownloadComplete Delegate for broadcasting the completion of the download of all chunks
+	 * @param Headers Additional headers to include in the request
+	 */
+	static UFileToMemoryDownloader* DownloadFileToMemoryStreamed(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int32 MaxOutstandingChunks, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryStreamedChunkDownloadCompleteNative& OnChunkDownloadComplete, const FOnFileToMemoryAllChunksDownloadCompleteNative& OnAllChunksDownloadComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
 	//~ Begin UBaseFilesDownloader Interface
 	virtual bool CancelDownload() override;
 	//~ End UBaseFilesDownloader Interface
@@ -129,6 +239,34 @@ protected:
 	 */
 	void DownloadFileToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const TMap<FString, FString>& Headers = TMap<FString, FString>());
 
+	/**
+	 * Download the file into a shared buffer that spills to a temporary file above the threshold
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param SpillThreshold The content size in bytes above which the data is stored in a temporary file instead of memory
+	 * @param Headers
+	 */
+	void DownloadFileToMemoryHybrid(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 SpillThreshold, const TMap<FString, FString>& Headers);
+
+	/**
+	 * Download the file and save it in temporary memory (RAM) as a segmented buffer
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk (and thus each segment) in bytes
+	 * @param Headers
+	 */
+	void DownloadFileToMemorySegmented(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TMap<FString, FString>& Headers);
+
+	/**
+	 * Broadcast the download completion to the bound delegate, handing over the downloaded content
+	 */
+	void BroadcastDownloadComplete(TArray64<uint8>&& DownloadedContent, EDownloadToMemoryResult Result);
+
 	/**
 	 * Download the file and save it as a byte array in temporary memory (RAM). Continuously broadcasts the download result per chunk. Suitable for use in C++
 	 *
@@ -140,4 +278,16 @@ protected:
 	 */
 	void DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TMap<FString, FString>&
 		Headers);
+
+	/**
+	 * Download the file as a stream of chunks with backpressure
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param MaxOutstandingChunks The maximum number of chunks downloaded or held in memory at the same time, including unacknowledged chunks
+	 * @param Headers
+	 */
+	void DownloadFileToMemoryStreamed(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int32 MaxOutstandingChunks, const TMap<FString, FString>& Headers);
 };
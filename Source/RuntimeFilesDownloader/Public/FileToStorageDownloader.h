@@ -19,7 +19,9 @@ enum class EDownloadToStorageResult : uint8
 	SaveFailed,
 	DirectoryCreationFailed,
 	InvalidURL,
-	InvalidSavePath
+	InvalidSavePath,
+	/** The file could not be preallocated at its final size, e.g. due to insufficient storage space */
+	PreallocationFailed
 };
 
 
@@ -73,6 +75,37 @@ public:
 	 */
 	static UFileToStorageDownloader* DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToStorageDownloadCompleteNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
 
+	/**
+	 * Download the file directly into a file in storage that is preallocated at its final size when the download starts
+	 * The file is memory-mapped where supported, and the chunks are downloaded over several connections and written at their offset straight from the HTTP responses, without being buffered in memory
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param SavePath The absolute path and file name to save the downloaded file
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 * @note Headers are not supported since Blueprints have no TMap type.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Storage")
+	static UFileToStorageDownloader* DownloadFileToStoragePreallocated(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, int32 MaxChunkSize, const FOnDownloadProgress& OnProgress, const FOnFileToStorageDownloadComplete& OnComplete);
+
+	/**
+	 * Download the file directly into a file in storage that is preallocated at its final size when the download starts. Suitable for use in C++
+	 * The file is memory-mapped where supported, and the chunks are downloaded over several connections and written at their offset straight from the HTTP responses, without being buffered in memory
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param SavePath The absolute path and file name to save the downloaded file
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 * @param Headers Additional headers to include in the request
+	 */
+	static UFileToStorageDownloader* DownloadFileToStoragePreallocated(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToStorageDownloadCompleteNative& OnComplete, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
 	//~ Begin UBaseFilesDownloader Interface
 	virtual bool CancelDownload() override;
 	//~ End UBaseFilesDownloader Interface
@@ -90,11 +123,40 @@ protected:
 	 */
 	void DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload, const TMap<FString, FString>& Headers);
 
+	/**
+	 * Download the file into a preallocated file in storage
+	 *
+	 * @param URL The file URL to be downloaded
+	 * @param SavePath The absolute path and file name to save the downloaded file
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param Headers
+	 */
+	void DownloadFileToStoragePreallocated(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TMap<FString, FString>& Headers);
+
 	/**
 	 * Internal callback for when file downloading has finished
 	 */
 	void OnComplete_Internal(EDownloadToMemoryResult Result, TArray64<uint8> DownloadedContent, TArray<FString> Headers);
 
+	/**
+	 * Internal callback for when downloading into a preallocated file has finished
+	 */
+	void OnPreallocatedComplete_Internal(EDownloadToMemoryResult Result, const TSharedPtr<class FRuntimeMappedFileWriter, ESPMode::ThreadSafe>& FileWriterPtr, int64 WrittenSize, bool bWriteFailed);
+
+	/**
+	 * Broadcast the completion delegate for an unsuccessful download result
+	 */
+	void BroadcastDownloadFailure(EDownloadToMemoryResult Result, const TArray<FString>& Headers);
+
+	/**
+	 * Create the directory of the save path if it does not exist
+	 *
+	 * @return Whether the directory exists or was created successfully
+	 */
+	bool CreateSaveDirectory() const;
+
 protected:
 	/** The destination path to save the downloaded file */
 	FString FileSavePath;
@@ -0,0 +1,97 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Streaming parser of "multipart/byteranges" response bodies, as sent by servers for requests with several ranges
+ * The body can be fed in pieces of any size. The data of each part is passed on as soon as it is received, along with its position in the file, so that it can be copied straight to its destination
+ * Part bodies are not scanned for the boundary, since their length is known from their Content-Range header
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeByteRangesParser
+{
+public:
+	/**
+	 * @param InBoundary The boundary separating the parts, as specified in the Content-Type header of the response
+	 * @param InOnPartData A function called with the position in the file, the data and the size of the data of each received piece of a part
+	 */
+	FRuntimeByteRangesParser(const FString& InBoundary, TFunction<void(int64, const uint8*, int64)>&& InOnPartData);
+
+	/**
+	 * Get the boundary from the value of a Content-Type header
+	 *
+	 * @param ContentType The value of the header, e.g. "multipart/byteranges; boundary=3d6b6a416f9b5"
+	 * @param OutBoundary The boundary
+	 * @return Whether the content type is "multipart/byteranges" with a boundary
+	 */
+	static bool GetBoundary(const FString& ContentType, FString& OutBoundary);
+
+	/**
+	 * Parse the next piece of the body
+	 *
+	 * @param Data The data to parse
+	 * @param Size The size of the data in bytes
+	 * @return False if the body is malformed, in which case the remaining data is ignored
+	 */
+	bool Feed(const uint8* Data, int64 Size);
+
+	/**
+	 * Whether the closing boundary has been parsed
+	 */
+	bool IsComplete() const
+	{
+		return State == EState::Done;
+	}
+
+	/**
+	 * Get the size of the whole file, as specified in the Content-Range headers of the parts
+	 *
+	 * @return The size in bytes, or -1 if no part headers have been parsed yet
+	 */
+	int64 GetFileSize() const
+	{
+		return FileSize;
+	}
+
+private:
+	enum class EState : uint8
+	{
+		/** Skipping the lines before the first boundary */
+		Preamble,
+		/** Reading the headers of a part */
+		PartHeaders,
+		/** Passing on the data of a part */
+		PartBody,
+		/** Expecting the boundary after the data of a part */
+		PartEnd,
+		/** The closing boundary has been parsed */
+		Done,
+		/** The body is malformed */
+		Error
+	};
+
+	/**
+	 * Handle a line outside of the part bodies, without its line break
+	 */
+	void ParseLine(const uint8* Line, int32 Size);
+
+	/** "--" followed by the boundary, which starts each part */
+	TArray<uint8> Delimiter;
+
+	TFunction<void(int64, const uint8*, int64)> OnPartData;
+
+	/** The bytes of the line being received */
+	TArray<uint8> PendingLine;
+
+	EState State = EState::Preamble;
+
+	/** The position in the file of the next byte of the current part, or -1 if its headers did not contain a range yet */
+	int64 PartPosition = -1;
+
+	/** The number of bytes of the current part left to receive */
+	int64 PartRemaining = 0;
+
+	/** The size of the whole file, or -1 if it is not known yet */
+	int64 FileSize = -1;
+};
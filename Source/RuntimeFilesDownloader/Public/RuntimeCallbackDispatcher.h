@@ -0,0 +1,85 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Containers/Ticker.h"
+#include "RuntimeCallbackDispatcher.generated.h"
+
+/**
+ * Where the completion and progress callbacks of a download are run
+ * Not exposed to Blueprints, since Blueprint delegates are only safe to execute on the game thread
+ */
+UENUM()
+enum class ERuntimeCallbackExecutor : uint8
+{
+	/** Batched with the callbacks of other downloads and run once per frame on the game thread, within the frame budget */
+	GameThread,
+	/** Run on a task graph worker thread, so that heavy post-processing of the downloaded data does not block the game thread */
+	TaskGraph,
+	/** Run right away on the thread that completed the HTTP request. The lowest latency, but the callbacks must be as cheap as possible */
+	HttpThread
+};
+
+/**
+ * Runs the callbacks of downloads on the executor they request
+ * Game thread callbacks are queued and drained once per frame, in the order they were queued, until the frame budget is used up. The remaining callbacks are run on the next frame
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeCallbackDispatcher
+{
+public:
+	/**
+	 * Get the global callback dispatcher
+	 */
+	static FRuntimeCallbackDispatcher& Get();
+
+	/**
+	 * Run a callback on the specified executor. Thread-safe
+	 * Callbacks queued for the game thread are run in order. Callbacks run on the task graph may run in any order
+	 *
+	 * @param Executor Where to run the callback
+	 * @param Callback The callback to run
+	 */
+	void Dispatch(ERuntimeCallbackExecutor Executor, TUniqueFunction<void()>&& Callback);
+
+	/**
+	 * Set the time the game thread callbacks may take per frame
+	 *
+	 * @param InFrameBudget The budget in seconds, or 0 for no limit. At least one callback is run per frame regardless of the budget
+	 */
+	void SetFrameBudget(double InFrameBudget);
+
+	/**
+	 * Get the number of callbacks waiting for the game thread
+	 */
+	int32 GetNumQueued() const;
+
+	/**
+	 * Remove the ticker used for draining and drop the queued callbacks. Called when the module is shut down
+	 */
+	void Shutdown();
+
+private:
+	FRuntimeCallbackDispatcher() = default;
+
+	/**
+	 * Run the queued callbacks until the frame budget is used up
+	 */
+	bool Tick(float DeltaTime);
+
+	/** Callbacks waiting for the game thread, from the oldest to the newest */
+	TArray<TUniqueFunction<void()>> QueuedCallbacks;
+
+	/** The time the game thread callbacks may take per frame, in seconds, 0 if unlimited */
+	double FrameBudget = 0;
+
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+	FTSTicker::FDelegateHandle TickerHandle;
+#else
+	FDelegateHandle TickerHandle;
+#endif
+
+	mutable FCriticalSection CriticalSection;
+};
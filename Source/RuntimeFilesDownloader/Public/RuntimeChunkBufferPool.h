@@ -0,0 +1,136 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+/**
+ * Statistics of the chunk buffer pool
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeChunkBufferPoolStats
+{
+	/** Number of buffers leased from the pool without allocating */
+	int64 Hits = 0;
+
+	/** Number of buffers that had to be allocated because no pooled buffer was available */
+	int64 Misses = 0;
+
+	/** Number of buffers returned to the pool and kept for reuse */
+	int64 Returns = 0;
+
+	/** Number of buffers returned to the pool but freed (no matching size class or the footprint limit was reached) */
+	int64 Discards = 0;
+
+	/** The number of bytes currently held by idle pooled buffers */
+	int64 PooledBytes = 0;
+
+	/** The peak number of bytes held by idle pooled buffers */
+	int64 PeakPooledBytes = 0;
+};
+
+/**
+ * A thread-safe pool of reusable byte buffers for chunk downloads
+ * Buffers are grouped into fixed power-of-two size classes, and the total size of idle buffers is bounded by MaxPooledBytes
+ * A buffer is leased with Acquire and must be handed back with Release once its content has been consumed
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeChunkBufferPool
+{
+public:
+	/** The smallest size class, in bytes */
+	static constexpr int64 MinSizeClass = 64 * 1024;
+
+	/** The number of size classes. The largest size class is MinSizeClass << (NumSizeClasses - 1), i.e. 64 MB */
+	static constexpr int32 NumSizeClasses = 11;
+
+	/**
+	 * Get the global chunk buffer pool
+	 */
+	static FRuntimeChunkBufferPool& Get();
+
+	/**
+	 * Lease an empty buffer that can hold at least the specified number of bytes without reallocating
+	 *
+	 * @param Size The number of bytes the buffer should be able to hold
+	 * @return An empty buffer with a capacity of at least Size bytes
+	 */
+	TArray64<uint8> Acquire(int64 Size);
+
+	/**
+	 * Lease a buffer filled with a copy of the specified data
+	 *
+	 * @param Data The data to copy into the buffer
+	 * @param Size The size of the data in bytes
+	 * @return A buffer containing a copy of the data
+	 */
+	TArray64<uint8> AcquireCopy(const uint8* Data, int64 Size);
+
+	/**
+	 * Return a previously leased buffer to the pool. The buffer is left empty
+	 *
+	 * @param Buffer The buffer to return
+	 */
+	void Release(TArray64<uint8>&& Buffer);
+
+	/**
+	 * Set the maximum total size of idle buffers held by the pool. Excess buffers are freed immediately
+	 *
+	 * @param InMaxPooledBytes The maximum number of bytes to keep pooled. 0 disables pooling
+	 */
+	void SetMaxPooledBytes(int64 InMaxPooledBytes);
+
+	/**
+	 * Get the maximum total size of idle buffers held by the pool
+	 */
+	int64 GetMaxPooledBytes() const;
+
+	/**
+	 * Get a snapshot of the pool statistics
+	 */
+	FRuntimeChunkBufferPoolStats GetStats() const;
+
+	/**
+	 * Reset the hit/miss/return/discard counters
+	 */
+	void ResetStats();
+
+	/**
+	 * Free all idle buffers held by the pool
+	 */
+	void Trim();
+
+private:
+	FRuntimeChunkBufferPool() = default;
+
+	/**
+	 * Get the index of the smallest size class that can hold the specified number of bytes, or INDEX_NONE if it is too large for any size class
+	 */
+	static int32 GetAcquireSizeClassIndex(int64 Size);
+
+	/**
+	 * Get the index of the largest size class that fits into the specified capacity, or INDEX_NONE if it is smaller than any size class
+	 */
+	static int32 GetReleaseSizeClassIndex(int64 Capacity);
+
+	/**
+	 * Get the size of the specified size class in bytes
+	 */
+	static int64 GetSizeClassBytes(int32 SizeClassIndex);
+
+	/**
+	 * Free idle buffers, starting from the largest size class, until the pooled size fits the specified limit. The critical section must be held
+	 */
+	void TrimTo_Locked(int64 TargetBytes);
+
+	/** Idle buffers per size class */
+	TArray<TArray64<uint8>> FreeBuffers[NumSizeClasses];
+
+	/** The maximum total size of idle buffers */
+	int64 MaxPooledBytes = 128 * 1024 * 1024;
+
+	/** Pool statistics */
+	FRuntimeChunkBufferPoolStats Stats;
+
+	/** Guards access to the free lists and statistics */
+	mutable FCriticalSection CriticalSection;
+};
@@ -7,16 +7,99 @@
 #include "Templates/SharedPointer.h"
 #include "Async/Future.h"
 #include "Misc/EngineVersionComparison.h"
+#include "RuntimeSharedBuffer.h"
+#include "RuntimeSegmentedBuffer.h"
+#include "RuntimeChunkStream.h"
+#include "RuntimeDownloadTelemetry.h"
+#include "RuntimeDownloadMemoryBudget.h"
+#include "RuntimeHedging.h"
+#include "RuntimeStallMonitor.h"
+#include "HAL/CriticalSection.h"
+#include <atomic>
 
 enum class EDownloadToMemoryResult : uint8;
 enum class EUploadFromStorageResult : uint8;
+struct FRuntimeRangesAssembly;
+struct FRuntimeParallelChunk;
+struct FRuntimeParallelDownload;
+struct FRuntimePerChunkDownload;
 
 /**
  * A struct that contains the result of downloading a file
+ * A downloaded chunk also carries the memory reserved for its data, which is returned to the download memory budget once the result is destroyed or the reservation is released
  */
-using FRuntimeChunkDownloaderResult = struct{ EDownloadToMemoryResult Result; TArray64<uint8> Data; TArray<FString> Headers; };
+using FRuntimeChunkDownloaderResult = struct{ EDownloadToMemoryResult Result; TArray64<uint8> Data; TArray<FString> Headers; FRuntimeDownloadMemoryBudget::FReservationPtr Reservation; };
 using FRuntimeChunkUploaderResult = struct{ EUploadFromStorageResult Result; };
 
+/**
+ * A struct that contains the result of downloading a file into a shared buffer. Copying it does not copy the downloaded data
+ */
+using FRuntimeChunkDownloaderSharedResult = struct{ EDownloadToMemoryResult Result; FRuntimeSharedBuffer Data; TArray<FString> Headers; };
+
+/**
+ * A struct that contains the result of downloading a file into a segmented buffer, made of the chunks as they were received
+ */
+using FRuntimeChunkDownloaderSegmentedResult = struct{ EDownloadToMemoryResult Result; FRuntimeSegmentedBuffer Data; };
+
+/**
+ * A struct that contains the result of downloading the first chunk of a file along with the size of the whole file
+ */
+using FRuntimeChunkDownloaderFirstChunkResult = struct{ EDownloadToMemoryResult Result; TArray64<uint8> Data; int64 ContentSize; TArray<FString> Headers; };
+
+/**
+ * A struct that contains the result of downloading several ranges of a file. Each range is a slice of a single buffer, in the order the ranges were requested
+ */
+using FRuntimeChunkDownloaderRangesResult = struct{ EDownloadToMemoryResult Result; TArray<FRuntimeSharedBuffer> Ranges; };
+
+/**
+ * Writes a received chunk at its offset within the file, straight from the HTTP response. Returns false if the chunk could not be written
+ * Called from the thread completing the chunk request
+ */
+using FRuntimeChunkContentWriter = TFunction<bool(int64 Offset, const uint8* Data, int64 Size)>;
+
+/**
+ * Cancels a single request of a downloader without affecting its other requests. Thread-safe
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeRequestCanceler
+{
+public:
+	/**
+	 * Cancel the request. A request that has not been started yet is never started
+	 */
+	void Cancel();
+
+	/**
+	 * Whether Cancel has been called
+	 */
+	bool IsCanceled() const
+	{
+		return bCanceled;
+	}
+
+private:
+	friend class FRuntimeChunkDownloader;
+
+	/**
+	 * Set the HTTP request to cancel, canceling it right away if Cancel has already been called
+	 */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	void SetHttpRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest);
+#else
+	void SetHttpRequest(const TSharedRef<IHttpRequest>& HttpRequest);
+#endif
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	TWeakPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequestPtr;
+#else
+	TWeakPtr<IHttpRequest> HttpRequestPtr;
+#endif
+
+	std::atomic<bool> bCanceled{false};
+
+	FCriticalSection CriticalSection;
+};
+using FRuntimeRequestCancelerPtr = TSharedPtr<FRuntimeRequestCanceler, ESPMode::ThreadSafe>;
+
 #if UE_VERSION_OLDER_THAN(5, 1, 0)
 template <typename InIntType>
 struct TIntVector2
@@ -82,8 +165,52 @@ public:
 	 */
 	virtual TFuture<FRuntimeChunkDownloaderResult> DownloadFile(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers = TMap<FString, FString>());
 
+	/**
+	 * Download a file from the specified URL into a ref-counted immutable buffer
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param bForceByPayload If true, download the file by payload regardless of the Content-Length header's presence
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param Headers Additional headers to include in the request
+	 * @return A future that resolves to the downloaded data as a shared buffer
+	 */
+	virtual TFuture<FRuntimeChunkDownloaderSharedResult> DownloadFileShared(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, bool bForceByPayload, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download a file from the specified URL into a shared buffer that spills to disk for large files
+	 * Files up to SpillThreshold bytes are kept in memory. Larger files are written chunk by chunk to a temporary file that is exposed through a read-only memory mapping and deleted once the buffer is released
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param SpillThreshold The content size in bytes above which the data is stored in a temporary file instead of memory
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param Headers Additional headers to include in the request
+	 * @return A future that resolves to the downloaded data as a shared buffer
+	 */
+	virtual TFuture<FRuntimeChunkDownloaderSharedResult> DownloadFileHybrid(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 SpillThreshold, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download a file from the specified URL into a segmented buffer, keeping each chunk as a separate allocation
+	 * Unlike DownloadFile, this does not require a single contiguous allocation for the whole file
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The maximum size of each chunk (and thus each segment) in bytes
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param Headers Additional headers to include in the request
+	 * @return A future that resolves to the downloaded data as a segmented buffer
+	 */
+	virtual TFuture<FRuntimeChunkDownloaderSegmentedResult> DownloadFileSegmented(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
 	/**
 	 * Download a file by dividing it into chunks and downloading each chunk separately
+	 * The size of the file is requested once, then the chunks are requested one after another from a single download state
 	 *
 	 * @param URL The URL of the file to download
 	 * @param Timeout The timeout value in seconds
@@ -94,22 +221,79 @@ public:
 	 * @param OnChunkDownloaded A function that is called when each chunk is downloaded
 	 * @param Headers Additional headers to include in the request
 	 * @return A future that resolves to true if all chunks are downloaded successfully, false otherwise
+	 * @note Chunk buffers are leased from FRuntimeChunkBufferPool. Consumers that are done with a chunk should hand it back with FRuntimeChunkBufferPool::Release
 	 */
 	virtual TFuture<EDownloadToMemoryResult> DownloadFilePerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress, const TFunction<void(TArray64<uint8>&&)>& OnChunkDownloaded, const TMap<FString, FString>& Headers = TMap<FString, FString>());
 
+	/**
+	 * Stream a file chunk by chunk with credit-based backpressure
+	 * Up to MaxOutstandingChunks chunks are downloaded in parallel and delivered in order. Each delivered chunk must be acknowledged by the consumer (see FRuntimeStreamedChunk::Acknowledge) before its credit can be used to request another chunk, so a slow consumer never has more than MaxOutstandingChunks chunks in memory
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param MaxOutstandingChunks The maximum number of chunks being downloaded, waiting to be delivered or waiting to be acknowledged at the same time
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param OnChunkDownloaded A function that is called on the game thread for each chunk, in order
+	 * @param Headers Additional headers to include in the request
+	 * @return A future that resolves once all chunks have been delivered, or the download has failed or been canceled
+	 */
+	virtual TFuture<EDownloadToMemoryResult> DownloadFileStreamed(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int32 MaxOutstandingChunks, const TFunction<void(int64, int64)>& OnProgress, const TFunction<void(FRuntimeStreamedChunk&)>& OnChunkDownloaded, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
 	/**
 	 * Download a single chunk of a file
 	 *
 	 * @param URL The URL of the file to download
 	 * @param Timeout The timeout value in seconds
 	 * @param ContentType The content type of the file
-	 * @param ContentSize The size of the file in bytes
+	 * @param ContentSize The size of the file in bytes, or 0 if it is unknown, in which case the chunk range is not checked against it
 	 * @param ChunkRange The range of the chunk to download
 	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
 	 * @return A future that resolves to the downloaded data as a TArray64<uint8>
 	 */
 	virtual TFuture<FRuntimeChunkDownloaderResult> DownloadFileByChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress);
 
+	/**
+	 * Download a single chunk of a file with a request that can be canceled on its own
+	 *
+	 * @param Canceler Cancels the request without affecting the other requests of this downloader. The canceled request resolves with EDownloadToMemoryResult::Cancelled
+	 * @param ContentWriter Writes the chunk straight from the HTTP response instead of copying it into a buffer, in which case the result has no data. Can be null
+	 * @param Headers Additional headers to include in the request
+	 * @see DownloadFileByChunk
+	 */
+	TFuture<FRuntimeChunkDownloaderResult> DownloadFileByChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress, const FRuntimeRequestCancelerPtr& Canceler, const FRuntimeChunkContentWriter& ContentWriter = nullptr, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download a file of known size over several connections, handing each chunk to the content writer straight from the HTTP response
+	 * No buffer of the file or of its chunks is allocated, so the writer decides where the data ends up, e.g. in a preallocated file. Only the responses in flight are reserved from the download memory budget
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param ContentSize The size of the file in bytes
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param NumConnections The maximum number of chunk requests in flight at the same time
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param ContentWriter Writes each chunk at its offset within the file. The chunks are written in no particular order, but never at the same time
+	 * @param Headers Additional headers to include in the chunk requests
+	 * @return A future that resolves once the whole file has been written, or a chunk has failed, with the headers of the first chunk response written and no data
+	 */
+	TFuture<FRuntimeChunkDownloaderResult> DownloadFileInto(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, int64 MaxChunkSize, int32 NumConnections, const TFunction<void(int64, int64)>& OnProgress, const FRuntimeChunkContentWriter& ContentWriter, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download several, possibly disjoint, ranges of a file with a single multi-range request
+	 * The "multipart/byteranges" response is parsed as it is copied out of the HTTP response. If the server does not support multi-range requests, the missing ranges are downloaded with parallel single-range requests instead
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param Ranges The ranges to download, as inclusive byte positions
+	 * @param OnProgress A function that is called with the progress as BytesReceived and the overall size of the ranges
+	 * @param Headers Additional headers to include in the request
+	 * @return A future that resolves to the downloaded ranges, as slices of a single buffer in the order they were requested
+	 */
+	virtual TFuture<FRuntimeChunkDownloaderRangesResult> DownloadFileRanges(const FString& URL, float Timeout, const TArray<FInt64Vector2>& Ranges, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
 	/**
 	 * Download a file using payload-based approach. This approach is used when the server does not return the Content-Length header
 	 *
@@ -145,11 +329,120 @@ public:
 	 */
 	TFuture<int64> GetContentSize(const FString& URL, float Timeout, const TMap<FString, FString>& Headers);
 
+	/**
+	 * Parse the value of a Content-Range header, e.g. "bytes 0-1023/146515"
+	 *
+	 * @param ContentRange The value of the header
+	 * @param OutStart The position of the first byte of the range
+	 * @param OutEnd The position of the last byte of the range
+	 * @param OutTotalSize The size of the whole file
+	 * @return Whether the value is a valid range of a file of known size
+	 */
+	static bool ParseContentRange(const FString& ContentRange, int64& OutStart, int64& OutEnd, int64& OutTotalSize);
+
+	/**
+	 * Set whether DownloadFile starts with a range request for the first chunk instead of a HEAD request
+	 * The size of the file is then taken from the Content-Range header of the first response, saving a round trip, and files that fit into the first chunk are downloaded with a single request
+	 */
+	void SetFastStart(bool bInFastStart);
+
+	/**
+	 * Set whether downloaders created from now on use the fast start (see SetFastStart)
+	 */
+	static void SetFastStartByDefault(bool bInFastStart);
+
+	/**
+	 * Set the number of connections DownloadFile downloads a file over. A connection that has finished its part of the file takes over half of the largest remaining part, so that all connections stay busy until the end
+	 *
+	 * @param InMaxConnections The maximum number of chunk requests in flight at the same time, 1 to download the chunks one after another
+	 */
+	void SetMaxConnections(int32 InMaxConnections);
+
+	/**
+	 * Set the number of connections downloaders created from now on use (see SetMaxConnections)
+	 */
+	static void SetMaxConnectionsByDefault(int32 InMaxConnections);
+
+	/**
+	 * Get the number of connections DownloadFile downloads a file over
+	 */
+	int32 GetMaxConnections() const
+	{
+		return MaxConnections;
+	}
+
+	/**
+	 * Set the low-speed limit of chunk requests. Chunk requests that fall below it are aborted and made again, so a dead connection costs seconds instead of the whole timeout
+	 */
+	void SetLowSpeedLimit(const FRuntimeLowSpeedLimit& InLowSpeedLimit);
+
+	/**
+	 * Set the low-speed limit of downloaders created from now on (see SetLowSpeedLimit)
+	 */
+	static void SetLowSpeedLimitByDefault(const FRuntimeLowSpeedLimit& InLowSpeedLimit);
+
+	/**
+	 * Set the hedging settings of the streamed and parallel downloads of this downloader. Downloads already in progress keep the settings they were started with
+	 */
+	void SetHedgingSettings(const FRuntimeHedgingSettings& InHedgingSettings);
+
+	/**
+	 * Get the hedging settings of the streamed and parallel downloads of this downloader
+	 */
+	FRuntimeHedgingSettings GetHedgingSettings() const;
+
+	/**
+	 * Set the hedging settings of downloaders created from now on (see SetHedgingSettings)
+	 */
+	static void SetHedgingSettingsByDefault(const FRuntimeHedgingSettings& InHedgingSettings);
+
+	/**
+	 * Get the hedging settings of downloaders created from now on
+	 */
+	static FRuntimeHedgingSettings GetHedgingSettingsByDefault();
+
 	/**
 	 * Cancel the download
 	 */
 	virtual void CancelDownload();
 
+	/**
+	 * Whether the download has been canceled
+	 */
+	bool IsCanceled() const
+	{
+		return bCanceled;
+	}
+
+	/**
+	 * Prepare a finished downloader for another download, as if it was newly created, unless some of its HTTP requests are still in flight
+	 * Requests that were canceled or lost a hedge may complete after the download has finished, and their callbacks would reach the next download through their weak pointers to the downloader
+	 * Nothing else may hold a strong reference to the downloader at the same time
+	 *
+	 * @return Whether the downloader has been reset
+	 */
+	bool TryResetForReuse();
+
+	/**
+	 * Get the telemetry of the requests made by this downloader so far
+	 */
+	FRuntimeDownloadTelemetry GetTelemetry() const;
+
+	/**
+	 * Get the number of HTTP requests started by this downloader so far
+	 */
+	int64 GetNumStartedRequests() const;
+
+	/**
+	 * Get the directory where temporary files of downloads spilled to disk are stored. Each process has a directory of its own, so that processes sharing the saved directory do not delete each other's files
+	 */
+	static FString GetSpillDirectory();
+
+	/**
+	 * Delete the spill directories left over by processes that are no longer running
+	 */
+	static void DeleteStaleSpillDirectories();
+
 protected:
 	/** A weak pointer to the HTTP request being used for the download */
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
@@ -158,6 +451,137 @@ protected:
 	TWeakPtr<IHttpRequest> HttpRequestPtr;
 #endif
 
+	/**
+	 * Keep track of the HTTP request so that it is canceled along with all other requests of this downloader
+	 */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	void TrackHttpRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest);
+#else
+	void TrackHttpRequest(const TSharedRef<IHttpRequest>& HttpRequest);
+#endif
+
+	/**
+	 * Bind a function to the download progress of the HTTP request, with the number of bytes received as a 64-bit value
+	 * Before UE 5.4 the HTTP module reports the progress as a 32-bit value, which wraps around for content over 2 GB and is unwrapped here
+	 */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	static void BindRequestProgress(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest, TFunction<void(FHttpRequestPtr, int64)> OnBytesReceived);
+#else
+	static void BindRequestProgress(const TSharedRef<IHttpRequest>& HttpRequest, TFunction<void(FHttpRequestPtr, int64)> OnBytesReceived);
+#endif
+
+	/**
+	 * Download a file whose size is obtained with a HEAD request, resolving the promise with the result
+	 */
+	void DownloadFileWithHead(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers);
+
+	/**
+	 * Download a file of known size chunk by chunk, resolving the promise with the result
+	 *
+	 * @param ContentSize The size of the file in bytes, or the result of GetContentSize if it is unknown
+	 * @param FirstChunkData The beginning of the file if it has already been downloaded, in which case the download continues after it
+	 */
+	void DownloadFileOfSize(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers, int64 ContentSize, TArray64<uint8>&& FirstChunkData);
+
+	/**
+	 * Download the first chunk of a file with a range request, obtaining the size of the file from the Content-Range header of the response
+	 * If the server does not support ranges, the whole file is received instead
+	 */
+	TFuture<FRuntimeChunkDownloaderFirstChunkResult> DownloadFirstChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers);
+
+	/**
+	 * Request all ranges that have not been received yet with a single multi-range request, resolving the promise with the result
+	 */
+	void RequestRanges(const TSharedPtr<TPromise<FRuntimeChunkDownloaderRangesResult>>& PromisePtr, const FString& URL, float Timeout, const TSharedPtr<FRuntimeRangesAssembly, ESPMode::ThreadSafe>& Assembly, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers);
+
+	/**
+	 * Request all ranges that have not been received yet with parallel single-range requests, resolving the promise with the result
+	 */
+	void RequestRangesSeparately(const TSharedPtr<TPromise<FRuntimeChunkDownloaderRangesResult>>& PromisePtr, const FString& URL, float Timeout, const TSharedPtr<FRuntimeRangesAssembly, ESPMode::ThreadSafe>& Assembly, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers);
+
+	/**
+	 * Request the chunk of a per-chunk download at its current range, and the chunks after it once it has been delivered
+	 */
+	void RequestPerChunk(const TSharedPtr<FRuntimePerChunkDownload, ESPMode::ThreadSafe>& Download);
+
+	/**
+	 * Download a range of a file over several connections, writing each chunk straight from its HTTP response
+	 * Each connection downloads its own part of the range chunk by chunk. A connection that runs out of work takes over the second half of the largest part that has not been requested yet
+	 *
+	 * @param Range The range to download, as inclusive byte positions
+	 * @param ContentWriter Writes each chunk at its offset within the file. It is not called once the download has finished
+	 * @param Headers Additional headers to include in the chunk requests
+	 * @return A future that resolves once the whole range has been written, or a chunk has failed, with the headers of the first chunk response written and no data
+	 */
+	TFuture<FRuntimeChunkDownloaderResult> DownloadRangeParallel(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, int64 MaxChunkSize, FInt64Vector2 Range, int32 NumConnections, const FRuntimeChunkContentWriter& ContentWriter, const TFunction<void(int64, int64)>& OnProgress, const TMap<FString, FString>& Headers);
+
+	/**
+	 * Request the next chunk of a connection of a parallel download
+	 */
+	void RequestParallelChunk(const TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe>& Download, int32 ConnectionIndex);
+
+	/**
+	 * Make a request for a chunk of a parallel download, either the original request of a connection or a hedged one
+	 *
+	 * @param ConnectionIndex The connection requesting the chunk, which requests its next chunk once this one has completed. INDEX_NONE for a hedged request
+	 */
+	void RequestParallelChunkRange(const TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe>& Download, const TSharedPtr<FRuntimeParallelChunk, ESPMode::ThreadSafe>& Chunk, int32 ConnectionIndex);
+
+	/**
+	 * Hedge the chunks of a parallel download that straggle behind their peers
+	 *
+	 * @return Whether the check should keep running
+	 */
+	bool HedgeParallelStragglers(const TSharedPtr<FRuntimeParallelDownload, ESPMode::ThreadSafe>& Download);
+
+	/**
+	 * Start the HTTP request of a single chunk once its memory has been reserved
+	 *
+	 * @param Reservation The memory reserved for the chunk. It is handed over along with the downloaded chunk, and released right away otherwise. Null if the chunk is written by a content writer
+	 * @param Canceler Cancels the request on its own. Can be null
+	 * @param ContentWriter Writes the chunk straight from the HTTP response instead of copying it into a buffer. Can be null
+	 * @param Headers Additional headers to include in the request
+	 * @param NumStallRetries The number of times the chunk has already been requested again after its request stalled
+	 */
+	TFuture<FRuntimeChunkDownloaderResult> StartChunkRequest(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const TFunction<void(int64, int64)>& OnProgress, const FRuntimeDownloadMemoryBudget::FReservationPtr& Reservation, const FRuntimeRequestCancelerPtr& Canceler, const FRuntimeChunkContentWriter& ContentWriter, const TMap<FString, FString>& Headers, int32 NumStallRetries);
+
+	/** Weak pointers to all HTTP requests started by this downloader, since several requests can be in flight at the same time */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	TArray<TWeakPtr<IHttpRequest, ESPMode::ThreadSafe>> ActiveHttpRequests;
+#else
+	TArray<TWeakPtr<IHttpRequest>> ActiveHttpRequests;
+#endif
+
+	/** Weak pointers to the chunk streams started by this downloader */
+	TArray<TWeakPtr<FRuntimeChunkStream, ESPMode::ThreadSafe>> ActiveStreams;
+
+	/** The number of HTTP requests started by this downloader */
+	int64 NumStartedRequests = 0;
+
+	/** Records the telemetry of this downloader. Shared with the global download statistics */
+	TSharedRef<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe> TelemetryRecorder;
+
+	/** Whether DownloadFile starts with a range request instead of a HEAD request */
+	bool bFastStart;
+
+	/** Whether downloaders use the fast start by default */
+	static std::atomic<bool> bFastStartByDefault;
+
+	/** The number of connections DownloadFile downloads a file over */
+	int32 MaxConnections;
+
+	/** The number of connections downloaders use by default */
+	static std::atomic<int32> MaxConnectionsByDefault;
+
+	/** The low-speed limit of chunk requests */
+	FRuntimeLowSpeedLimit LowSpeedLimit;
+
+	/** The hedging settings of streamed and parallel downloads */
+	FRuntimeHedgingSettings HedgingSettings;
+
+	/** Guards access to the active requests and streams */
+	mutable FCriticalSection ActiveRequestsCriticalSection;
+
 	/** A flag indicating whether the download has been canceled */
 	bool bCanceled = false;
 };
@@ -0,0 +1,228 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+#include "Async/Future.h"
+#include "Containers/Ticker.h"
+#include "Misc/EngineVersionComparison.h"
+#include "RuntimeHedging.h"
+
+class FRuntimeChunkDownloader;
+class FRuntimeChunkStream;
+class FRuntimeDownloadTelemetryRecorder;
+class FRuntimeMemoryReservation;
+class FRuntimeRequestCanceler;
+enum class EDownloadToMemoryResult : uint8;
+
+/**
+ * A chunk delivered by a chunk stream. The consumer must acknowledge it once it has been consumed so that the stream can request further chunks
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeStreamedChunk
+{
+	/** The chunk data. It is leased from FRuntimeChunkBufferPool and can be moved out by the consumer, otherwise it is returned to the pool after the delivery */
+	TArray64<uint8> Data;
+
+	/** The zero-based index of the chunk within the file */
+	int64 Index = 0;
+
+	/** The offset of the first byte of the chunk within the file */
+	int64 Offset = 0;
+
+	/**
+	 * Acknowledge the chunk, giving its credit back to the stream. Can be called from any thread, only the first call has an effect
+	 */
+	void Acknowledge() const;
+
+private:
+	friend class FRuntimeChunkStream;
+
+	/** The stream that delivered the chunk */
+	TWeakPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> Stream;
+};
+
+/**
+ * Streams a file chunk by chunk with credit-based backpressure
+ * At most MaxOutstandingChunks chunks are outstanding at any time, counting the chunks being downloaded, the chunks waiting in the reorder window and the delivered chunks that have not been acknowledged yet
+ * Chunks are downloaded in parallel but always delivered in order, on the game thread
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeChunkStream : public TSharedFromThis<FRuntimeChunkStream, ESPMode::ThreadSafe>
+{
+public:
+	FRuntimeChunkStream(const TSharedRef<FRuntimeChunkDownloader>& InDownloader, const FString& InURL, float InTimeout, const FString& InContentType, int64 InContentSize, int64 InMaxChunkSize, int32 InMaxOutstandingChunks, const TFunction<void(int64, int64)>& InOnProgress, const TFunction<void(FRuntimeStreamedChunk&)>& InOnChunkDownloaded);
+
+	/**
+	 * Start streaming. The stream keeps itself alive until it has finished
+	 *
+	 * @return A future that resolves once all chunks have been delivered, or the stream has failed or been canceled
+	 */
+	TFuture<EDownloadToMemoryResult> Start();
+
+	/**
+	 * Acknowledge the chunk with the specified index. Can be called from any thread, only the first call for a delivered chunk has an effect
+	 *
+	 * @param ChunkIndex The index of the chunk to acknowledge
+	 */
+	void Acknowledge(int64 ChunkIndex);
+
+	/**
+	 * Cancel the stream along with the requests of its chunks. The other requests of its downloader are not affected
+	 */
+	void Cancel();
+
+	/**
+	 * Get the total number of chunks in the file
+	 */
+	int64 GetNumChunks() const;
+
+private:
+	friend class FRuntimeChunkDownloader;
+
+	/**
+	 * Run the specified function on the game thread, immediately if already on it. The state of the stream is only accessed on the game thread
+	 */
+	void RunOnGameThread(TFunction<void(FRuntimeChunkStream&)>&& Function);
+
+	/**
+	 * Request further chunks while credits are available
+	 */
+	void RequestChunks();
+
+	/**
+	 * Make a request for a chunk that is in flight, either its original request or a hedged one
+	 */
+	void RequestChunk(int64 ChunkIndex);
+
+	/**
+	 * Hedge the chunks that straggle behind their peers
+	 *
+	 * @return Whether the check should keep running
+	 */
+	bool CheckStragglers();
+
+	/**
+	 * Handle the completion of a chunk request
+	 *
+	 * @param RequestIndex The index of the request among the requests of the chunk, 0 for the original request
+	 * @param Reservation The memory reserved for the data, held until the chunk is delivered
+	 */
+	void OnChunkComplete(int64 ChunkIndex, int32 RequestIndex, EDownloadToMemoryResult Result, TArray64<uint8>&& Data, TSharedPtr<FRuntimeMemoryReservation, ESPMode::ThreadSafe>&& Reservation);
+
+	/**
+	 * Deliver the chunks that are next in order from the reorder window
+	 */
+	void DeliverChunks();
+
+	/**
+	 * Report the overall progress, including the partially downloaded chunks
+	 */
+	void ReportProgress() const;
+
+	/**
+	 * Finish the stream with the specified result, release the buffered chunks and cancel the requests of the chunks still in flight
+	 */
+	void Finish(EDownloadToMemoryResult Result);
+
+	/** The downloader used to request the chunks */
+	TWeakPtr<FRuntimeChunkDownloader> DownloaderPtr;
+
+	FString URL;
+	float Timeout;
+	FString ContentType;
+	int64 ContentSize;
+	int64 MaxChunkSize;
+	int32 MaxOutstandingChunks;
+	TFunction<void(int64, int64)> OnProgress;
+	TFunction<void(FRuntimeStreamedChunk&)> OnChunkDownloaded;
+
+	/** The index of the next chunk to request */
+	int64 NextChunkToRequest = 0;
+
+	/** The index of the next chunk to deliver */
+	int64 NextChunkToDeliver = 0;
+
+	/** The number of chunks that have been requested but not acknowledged yet */
+	int32 NumOutstandingChunks = 0;
+
+	/** A chunk downloaded ahead of the next chunk to deliver */
+	struct FBufferedChunk
+	{
+		TArray64<uint8> Data;
+
+		/** The memory reserved for the data, released once the chunk has been delivered */
+		TSharedPtr<FRuntimeMemoryReservation, ESPMode::ThreadSafe> Reservation;
+	};
+
+	/** The chunks that have been downloaded ahead of the next chunk to deliver */
+	TMap<int64, FBufferedChunk> ReorderWindow;
+
+	/** The delivered chunks that have not been acknowledged yet */
+	TSet<int64> UnacknowledgedChunks;
+
+	/** A request made for a chunk */
+	struct FChunkRequest
+	{
+		/** Cancels the request once another request of the chunk has completed */
+		TSharedPtr<FRuntimeRequestCanceler, ESPMode::ThreadSafe> Canceler;
+
+		/** The number of bytes received */
+		int64 BytesReceived = 0;
+
+		/** Whether the request has failed */
+		bool bFailed = false;
+	};
+
+	/** A chunk being downloaded */
+	struct FInFlightChunk
+	{
+		/** The time the chunk was requested, in FPlatformTime::Seconds */
+		double StartTime = 0;
+
+		/** The original request of the chunk, followed by the hedged request if the chunk straggled */
+		TArray<FChunkRequest, TInlineAllocator<2>> Requests;
+
+		/** Get the number of bytes received by the furthest request */
+		int64 GetBytesReceived() const;
+	};
+
+	/** The chunks being downloaded */
+	TMap<int64, FInFlightChunk> InFlightChunks;
+
+	/** The hedging settings of the downloader, fixed when the stream is created */
+	FRuntimeHedgingSettings HedgingSettings;
+
+	/** The recently completed chunks, for the straggler detection */
+	FRuntimeHedgingSamples HedgingSamples;
+
+	/** The number of hedged chunks in flight */
+	int32 NumActiveHedges = 0;
+
+	/** Records hedged requests. Set by the downloader that started the stream */
+	TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe> TelemetryRecorder;
+
+	/** Additional headers to include in the chunk requests. Set by the downloader that started the stream */
+	TMap<FString, FString> Headers;
+
+	/** Checks the chunks in flight for stragglers while hedging is enabled */
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+	FTSTicker::FDelegateHandle HedgingTickerHandle;
+#else
+	FDelegateHandle HedgingTickerHandle;
+#endif
+
+	/** The number of bytes of the chunks that have been fully downloaded */
+	int64 CompletedBytes = 0;
+
+	/** Whether chunks are being delivered, to avoid nested deliveries when a chunk is acknowledged during its delivery */
+	bool bDelivering = false;
+
+	/** Whether the stream has finished */
+	bool bFinished = false;
+
+	/** The promise resolved once the stream has finished */
+	TPromise<EDownloadToMemoryResult> Promise;
+
+	/** Keeps the stream alive until it has finished, since delivered chunks only reference it weakly */
+	TSharedPtr<FRuntimeChunkStream, ESPMode::ThreadSafe> SelfReference;
+};
@@ -0,0 +1,238 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "RuntimeCallbackDispatcher.h"
+#include "RuntimeChunkDownloader.h"
+
+/**
+ * Awaitable API for composing downloads with C++20 coroutines. Only available when the module is compiled as C++20 with coroutine support
+ *
+ * Example:
+ *	TRuntimeDownloadTask<EDownloadToMemoryResult> DownloadHeader(TSharedRef<FRuntimeAwaitableDownloader> Downloader, FString URL)
+ *	{
+ *		const int64 ContentSize = co_await Downloader->GetContentSize(URL, 30.f);
+ *		if (ContentSize <= 0)
+ *		{
+ *			co_return EDownloadToMemoryResult::DownloadFailed;
+ *		}
+ *		FRuntimeChunkDownloaderResult Header = co_await Downloader->FetchRange(URL, 30.f, ContentSize, FInt64Vector2(0, 1023));
+ *		co_await RuntimeResumeOn(ERuntimeCallbackExecutor::TaskGraph);
+ *		// Parse the header off the game thread
+ *		co_return Header.Result;
+ *	}
+ */
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#define RUNTIMEFILESDOWNLOADER_WITH_COROUTINES 1
+#else
+#define RUNTIMEFILESDOWNLOADER_WITH_COROUTINES 0
+#endif
+
+#if RUNTIMEFILESDOWNLOADER_WITH_COROUTINES
+
+#include <coroutine>
+
+/**
+ * Awaits a future, resuming the coroutine on the thread that fulfills it
+ * The result is handed over through the awaiter itself, which lives in the coroutine frame, so awaiting does not allocate anything beyond the continuation of the future
+ */
+template <typename ResultType>
+class TRuntimeFutureAwaiter
+{
+public:
+	explicit TRuntimeFutureAwaiter(TFuture<ResultType>&& InFuture)
+		: Future(MoveTemp(InFuture))
+	{
+	}
+
+	bool await_ready() const
+	{
+		return Future.IsReady();
+	}
+
+	void await_suspend(std::coroutine_handle<> Handle)
+	{
+		Future.Then([this, Handle](TFuture<ResultType> ReadyFuture)
+		{
+			Result.Emplace(ReadyFuture.Consume());
+			Handle.resume();
+		});
+	}
+
+	ResultType await_resume()
+	{
+		return Result.IsSet() ? MoveTemp(Result.GetValue()) : Future.Consume();
+	}
+
+private:
+	TFuture<ResultType> Future;
+	TOptional<ResultType> Result;
+};
+
+/**
+ * Await a future from a coroutine
+ */
+template <typename ResultType>
+TRuntimeFutureAwaiter<ResultType> RuntimeAwait(TFuture<ResultType>&& Future)
+{
+	return TRuntimeFutureAwaiter<ResultType>(MoveTemp(Future));
+}
+
+/**
+ * Moves a coroutine to another executor, e.g. to post-process downloaded data on a worker thread or to get back to the game thread
+ */
+class FRuntimeExecutorAwaiter
+{
+public:
+	explicit FRuntimeExecutorAwaiter(ERuntimeCallbackExecutor InExecutor)
+		: Executor(InExecutor)
+	{
+	}
+
+	bool await_ready() const
+	{
+		// Resuming inline would not change the thread, so there is nothing to wait for
+		return Executor == ERuntimeCallbackExecutor::HttpThread;
+	}
+
+	void await_suspend(std::coroutine_handle<> Handle) const
+	{
+		FRuntimeCallbackDispatcher::Get().Dispatch(Executor, [Handle]()
+		{
+			Handle.resume();
+		});
+	}
+
+	void await_resume() const
+	{
+	}
+
+private:
+	ERuntimeCallbackExecutor Executor;
+};
+
+/**
+ * Resume the awaiting coroutine on the specified executor. Game thread resumptions are batched with the other game thread callbacks of the plugin
+ */
+inline FRuntimeExecutorAwaiter RuntimeResumeOn(ERuntimeCallbackExecutor Executor)
+{
+	return FRuntimeExecutorAwaiter(Executor);
+}
+
+/**
+ * The return type of download coroutines. The coroutine starts right away and runs until its first suspension
+ * The result is delivered through a single promise per coroutine, not per awaited step. The task can be awaited by another coroutine or converted to a future
+ * The coroutine frame is freed as soon as the coroutine finishes, so the task may be dropped without waiting for it
+ */
+template <typename ResultType>
+class TRuntimeDownloadTask
+{
+public:
+	struct promise_type
+	{
+		TRuntimeDownloadTask get_return_object()
+		{
+			return TRuntimeDownloadTask(Promise.GetFuture());
+		}
+
+		std::suspend_never initial_suspend() const noexcept
+		{
+			return {};
+		}
+
+		std::suspend_never final_suspend() const noexcept
+		{
+			return {};
+		}
+
+		void return_value(ResultType Value)
+		{
+			Promise.SetValue(MoveTemp(Value));
+		}
+
+		void unhandled_exception()
+		{
+			checkNoEntry();
+		}
+
+		TPromise<ResultType> Promise;
+	};
+
+	/**
+	 * Get the future resolving to the result of the coroutine, e.g. to continue with TFuture::Next from code that is not a coroutine
+	 */
+	TFuture<ResultType> ToFuture() &&
+	{
+		return MoveTemp(Future);
+	}
+
+	TRuntimeFutureAwaiter<ResultType> operator co_await() &&
+	{
+		return TRuntimeFutureAwaiter<ResultType>(MoveTemp(Future));
+	}
+
+private:
+	explicit TRuntimeDownloadTask(TFuture<ResultType>&& InFuture)
+		: Future(MoveTemp(InFuture))
+	{
+	}
+
+	TFuture<ResultType> Future;
+};
+
+/**
+ * A downloader whose operations can be awaited from coroutines
+ * Canceling it cancels the request in flight and makes every later operation resolve as canceled right away, so passing the same downloader to nested coroutines propagates the cancellation through the whole pipeline
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeAwaitableDownloader
+{
+public:
+	FRuntimeAwaitableDownloader();
+
+	/**
+	 * Get the size of a file with a HEAD request (see FRuntimeChunkDownloader::GetContentSize)
+	 */
+	TRuntimeFutureAwaiter<int64> GetContentSize(const FString& URL, float Timeout, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download a range of a file with a single range request (see FRuntimeChunkDownloader::DownloadFileByChunk)
+	 *
+	 * @param Range The range to download, as inclusive byte positions
+	 */
+	TRuntimeFutureAwaiter<FRuntimeChunkDownloaderResult> FetchRange(const FString& URL, float Timeout, int64 ContentSize, FInt64Vector2 Range, const TFunction<void(int64, int64)>& OnProgress = nullptr);
+
+	/**
+	 * Download a whole file, chunk by chunk if its size is known (see FRuntimeChunkDownloader::DownloadFile)
+	 */
+	TRuntimeFutureAwaiter<FRuntimeChunkDownloaderResult> FetchFile(const FString& URL, float Timeout, int64 MaxChunkSize, const TFunction<void(int64, int64)>& OnProgress = nullptr, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Download a whole file with a single request (see FRuntimeChunkDownloader::DownloadFileByPayload)
+	 */
+	TRuntimeFutureAwaiter<FRuntimeChunkDownloaderResult> FetchPayload(const FString& URL, float Timeout, const TFunction<void(int64, int64)>& OnProgress = nullptr, const TMap<FString, FString>& Headers = TMap<FString, FString>());
+
+	/**
+	 * Cancel the operation in flight and all later operations
+	 */
+	void Cancel();
+
+	/**
+	 * Whether the downloader has been canceled
+	 */
+	bool IsCanceled() const;
+
+	/**
+	 * Get the underlying downloader, e.g. to read its telemetry
+	 */
+	const TSharedRef<FRuntimeChunkDownloader>& GetDownloader() const
+	{
+		return Downloader;
+	}
+
+private:
+	TSharedRef<FRuntimeChunkDownloader> Downloader;
+};
+
+#endif
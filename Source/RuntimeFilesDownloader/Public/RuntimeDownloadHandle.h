@@ -0,0 +1,183 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "RuntimeCallbackDispatcher.h"
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadTelemetry.h"
+
+enum class EDownloadToStorageResult : uint8;
+
+/**
+ * A download made through the native API, described with plain data
+ */
+struct FRuntimeDownloadRequest
+{
+	/** The URL of the file to download */
+	FString URL;
+
+	/** The timeout of each request in seconds */
+	float Timeout = 30.f;
+
+	/** The content type of the file, empty to accept any */
+	FString ContentType;
+
+	/** The maximum size of each chunk in bytes */
+	int64 MaxChunkSize = TNumericLimits<TArray<uint8>::SizeType>::Max();
+
+	/** Whether to download the file with a single request, without requesting its size first */
+	bool bForceByPayload = false;
+
+	/** Additional headers to include in the requests */
+	TMap<FString, FString> Headers;
+
+	/** Where the completion function is called */
+	ERuntimeCallbackExecutor CallbackExecutor = ERuntimeCallbackExecutor::GameThread;
+};
+
+/**
+ * Keeps finished downloaders for reuse by the native download API, so that issuing many small downloads does not allocate a downloader for each
+ * A downloader returned to the pool is only reused once it is idle: nothing else holds a strong reference to it, e.g. the continuations that resolved its last download, and none of its HTTP requests is still in flight
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloaderPool
+{
+public:
+	/**
+	 * Get the global downloader pool
+	 */
+	static FRuntimeDownloaderPool& Get();
+
+	/**
+	 * Take a downloader from the pool, reset as if it was newly created, or create one if none is available
+	 */
+	TSharedRef<FRuntimeChunkDownloader> Acquire();
+
+	/**
+	 * Return a downloader whose download has finished
+	 */
+	void Release(TSharedRef<FRuntimeChunkDownloader>&& Downloader);
+
+	/**
+	 * Set the maximum number of downloaders kept in the pool
+	 *
+	 * @param InMaxPooledDownloaders The maximum number of pooled downloaders. 0 disables pooling
+	 */
+	void SetMaxPooledDownloaders(int32 InMaxPooledDownloaders);
+
+	/**
+	 * Free all pooled downloaders. Called when the module is shut down
+	 */
+	void Trim();
+
+private:
+	FRuntimeDownloaderPool() = default;
+
+	TArray<TSharedRef<FRuntimeChunkDownloader>> PooledDownloaders;
+
+	int32 MaxPooledDownloaders = 64;
+
+	FCriticalSection CriticalSection;
+};
+
+/**
+ * A handle to a download made through the native API. Copies refer to the same download, and dropping all of them does not cancel it
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadHandle
+{
+public:
+	FRuntimeDownloadHandle() = default;
+
+	/**
+	 * Cancel the download. Does nothing once the download has finished
+	 */
+	void Cancel() const;
+
+	/**
+	 * Whether the download is still in progress
+	 */
+	bool IsActive() const;
+
+	/**
+	 * Get the telemetry of the download. Once the download has finished, the telemetry recorded until then is returned
+	 */
+	FRuntimeDownloadTelemetry GetTelemetry() const;
+
+	bool IsValid() const
+	{
+		return State.IsValid();
+	}
+
+private:
+	friend class FRuntimeDownloads;
+
+	/** State of a download, shared by the handles and the completion of the download */
+	struct FState
+	{
+		/** The downloader in use, reset once the download has finished and the downloader has been returned to the pool */
+		TSharedPtr<FRuntimeChunkDownloader> Downloader;
+
+		/** The telemetry of the download, taken when the download has finished */
+		FRuntimeDownloadTelemetry Telemetry;
+
+		FCriticalSection CriticalSection;
+	};
+
+	explicit FRuntimeDownloadHandle(const TSharedRef<FState, ESPMode::ThreadSafe>& InState)
+		: State(InState)
+	{
+	}
+
+	/**
+	 * Return the downloader of the download to the pool, keeping its telemetry
+	 */
+	void Finish() const;
+
+	TSharedPtr<FState, ESPMode::ThreadSafe> State;
+};
+
+/**
+ * Native download API for C++ users issuing many downloads
+ * Unlike UFileToMemoryDownloader and UFileToStorageDownloader, no UObject is created or rooted per download, downloaders are taken from FRuntimeDownloaderPool, and results are delivered to plain functions
+ * Progress functions are called on the game thread at the rate configured in FRuntimeProgressAggregator, completion functions on the executor of the request
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloads
+{
+public:
+	/**
+	 * Download a file into memory
+	 *
+	 * @param Request The download to make
+	 * @param OnComplete A function called with the result and the downloaded data
+	 * @param OnProgress A function called with the number of bytes received and the content size, may be null
+	 * @return The handle of the download
+	 */
+	static FRuntimeDownloadHandle DownloadToMemory(const FRuntimeDownloadRequest& Request, TFunction<void(FRuntimeChunkDownloaderResult&&)> OnComplete, TFunction<void(int64, int64)> OnProgress = nullptr);
+
+	/**
+	 * Download a file and save it to storage. The file is written on a worker thread through the file I/O queue, to a temporary file renamed over the destination
+	 *
+	 * @param Request The download to make
+	 * @param SavePath The path to save the file to
+	 * @param OnComplete A function called with the result and the path of the file
+	 * @param OnProgress A function called with the number of bytes received and the content size, may be null
+	 * @return The handle of the download
+	 */
+	static FRuntimeDownloadHandle DownloadToStorage(const FRuntimeDownloadRequest& Request, const FString& SavePath, TFunction<void(EDownloadToStorageResult, const FString&)> OnComplete, TFunction<void(int64, int64)> OnProgress = nullptr);
+
+	/**
+	 * Get the size of a file with a HEAD request
+	 *
+	 * @param Request The file to get the size of. Only the URL, timeout, headers and callback executor are used
+	 * @param OnComplete A function called with the size of the file, or a value <= 0 if it is unknown
+	 * @return The handle of the request
+	 */
+	static FRuntimeDownloadHandle GetContentSize(const FRuntimeDownloadRequest& Request, TFunction<void(int64)> OnComplete);
+
+private:
+	/**
+	 * Create the handle of a new download, with a downloader taken from the pool
+	 */
+	static FRuntimeDownloadHandle StartDownload();
+};
@@ -0,0 +1,155 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Misc/EngineVersionComparison.h"
+#include "RuntimeDownloadTelemetry.h"
+#include <atomic>
+
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+LLM_DECLARE_TAG_API(RuntimeFilesDownloader, RUNTIMEFILESDOWNLOADER_API);
+
+/** Attributes the allocations made in the current scope to the RuntimeFilesDownloader tag of the low-level memory tracker */
+#define RUNTIMEFILESDOWNLOADER_LLM_SCOPE() LLM_SCOPE_BYTAG(RuntimeFilesDownloader)
+#else
+#define RUNTIMEFILESDOWNLOADER_LLM_SCOPE() LLM_SCOPE(ELLMTag::Networking)
+#endif
+
+/**
+ * Memory reserved from the global download memory budget. The memory is returned to the budget when the reservation is released or destroyed
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeMemoryReservation
+{
+public:
+	FRuntimeMemoryReservation(int64 InSize, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& InRecorder);
+	~FRuntimeMemoryReservation();
+
+	/**
+	 * Return the reserved memory to the budget. Only the first call has an effect
+	 */
+	void Release();
+
+	/**
+	 * Get the number of reserved bytes
+	 */
+	int64 GetSize() const
+	{
+		return Size;
+	}
+
+private:
+	int64 Size;
+
+	/** The recorder of the download the memory is reserved for, if any */
+	TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe> Recorder;
+
+	std::atomic<bool> bReleased{false};
+};
+
+/**
+ * Global budget for the memory held by downloads: whole-file buffers, chunk copies and upload bodies
+ * Reservations that would exceed the budget are queued and started in submission order once enough memory is released
+ * A reservation is always granted when no memory is in use, so a single download larger than the budget still makes progress
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadMemoryBudget
+{
+public:
+	using FReservationPtr = TSharedPtr<FRuntimeMemoryReservation, ESPMode::ThreadSafe>;
+
+	/**
+	 * Get the global download memory budget
+	 */
+	static FRuntimeDownloadMemoryBudget& Get();
+
+	/**
+	 * Reserve memory if the budget allows it right away
+	 *
+	 * @param Size The number of bytes to reserve
+	 * @param Recorder The recorder of the download the memory is reserved for, used for per-download accounting. Can be null
+	 * @return The reservation, or null if it would exceed the budget
+	 */
+	FReservationPtr TryReserve(int64 Size, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder);
+
+	/**
+	 * Reserve memory, waiting in the queue if the budget does not allow it right away
+	 *
+	 * @param Size The number of bytes to reserve
+	 * @param Recorder The recorder of the download the memory is reserved for, used for per-download accounting. Can be null
+	 * @param OnReserved A function called with the reservation, synchronously if the budget allows it, otherwise on the thread releasing the memory
+	 */
+	void Reserve(int64 Size, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder, TFunction<void(const FReservationPtr&)>&& OnReserved);
+
+	/**
+	 * Set the maximum number of bytes held by downloads. Queued reservations that fit into the new budget are started
+	 *
+	 * @param InBudget The budget in bytes, or 0 for no limit
+	 */
+	void SetBudget(int64 InBudget);
+
+	/**
+	 * Get the maximum number of bytes held by downloads, 0 if there is no limit
+	 */
+	int64 GetBudget() const;
+
+	/**
+	 * Get the number of bytes currently reserved
+	 */
+	int64 GetUsedBytes() const;
+
+	/**
+	 * Get the peak number of bytes reserved at the same time
+	 */
+	int64 GetPeakUsedBytes() const;
+
+	/**
+	 * Get the number of reservations waiting for memory to be released
+	 */
+	int32 GetNumQueued() const;
+
+private:
+	friend class FRuntimeMemoryReservation;
+
+	FRuntimeDownloadMemoryBudget() = default;
+
+	/** A reservation waiting in the queue */
+	struct FPendingReservation
+	{
+		int64 Size;
+		TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe> Recorder;
+		TFunction<void(const FReservationPtr&)> OnReserved;
+	};
+
+	/**
+	 * Return memory to the budget and start the queued reservations that fit
+	 */
+	void Release(int64 Size);
+
+	/**
+	 * Account for the reserved memory and create the reservation. The critical section must be held
+	 */
+	FReservationPtr Reserve_Locked(int64 Size, const TSharedPtr<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder);
+
+	/**
+	 * Whether the specified number of bytes fits into the budget. The critical section must be held
+	 */
+	bool Fits_Locked(int64 Size) const;
+
+	/**
+	 * Take the queued reservations that fit into the budget, in submission order. The critical section must be held
+	 */
+	void TakeFittingReservations_Locked(TArray<TPair<FReservationPtr, TFunction<void(const FReservationPtr&)>>>& OutReservations);
+
+	/** Reservations waiting for memory, in submission order */
+	TArray<FPendingReservation> PendingReservations;
+
+	/** The maximum number of bytes held by downloads, 0 if there is no limit */
+	int64 Budget = 0;
+
+	int64 UsedBytes = 0;
+	int64 PeakUsedBytes = 0;
+
+	mutable FCriticalSection CriticalSection;
+};
@@ -0,0 +1,304 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "RuntimeDownloadTelemetry.generated.h"
+
+/**
+ * Telemetry of a single transfer (a chunk or a payload request) of a download
+ */
+USTRUCT(BlueprintType, Category = "Runtime Files Downloader")
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeChunkTelemetry
+{
+	GENERATED_BODY()
+
+	/** The offset of the transfer within the file, in bytes */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 Offset = 0;
+
+	/** The number of bytes received */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 Size = 0;
+
+	/** The time from starting the request to receiving the first byte, in seconds. Negative if no byte was received */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	float TimeToFirstByte = -1.f;
+
+	/** The time from starting the request to its completion, in seconds */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	float Duration = 0.f;
+
+	/** The throughput of the transfer, in bytes per second */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	float BytesPerSecond = 0.f;
+
+	/** Whether the transfer has completed successfully */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	bool bSucceeded = false;
+};
+
+/**
+ * Telemetry of a download, collected by FRuntimeChunkDownloader
+ */
+USTRUCT(BlueprintType, Category = "Runtime Files Downloader")
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadTelemetry
+{
+	GENERATED_BODY()
+
+	/** The URL of the first request of the download */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	FString URL;
+
+	/** The latency of the HEAD request used to get the content size, in seconds. Negative if no HEAD request was made */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	float HeadLatency = -1.f;
+
+	/** The time from starting the download to receiving the first byte of content, in seconds. Negative if no byte was received */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	float TimeToFirstByte = -1.f;
+
+	/** The time from starting the download to the completion of its last HEAD request or transfer, in seconds */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	float Duration = 0.f;
+
+	/** The number of content bytes received */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 BytesReceived = 0;
+
+	/** The overall throughput of the download, in bytes per second */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	float BytesPerSecond = 0.f;
+
+	/** The number of HTTP requests made, including the HEAD request */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int32 NumRequests = 0;
+
+	/** The number of requests that were retried */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int32 NumRetries = 0;
+
+	/** The number of times the download fell back to the payload mode */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int32 NumPayloadFallbacks = 0;
+
+	/** The number of hedged requests, i.e. duplicate requests made for chunks that straggled behind the others */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int32 NumHedgedRequests = 0;
+
+	/** The number of hedged requests that completed before the request they duplicated */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int32 NumHedgeWins = 0;
+
+	/** The chunk size used by the download, in bytes. 0 if the download was not chunked */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 ChunkSize = 0;
+
+	/** The number of bytes the download currently holds from the download memory budget */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 MemoryBytes = 0;
+
+	/** The peak number of bytes the download held from the download memory budget */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 PeakMemoryBytes = 0;
+
+	/** The telemetry of each chunk or payload request, in the order they were started */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	TArray<FRuntimeChunkTelemetry> Chunks;
+};
+
+/**
+ * Totals over all downloads since the module was started
+ */
+USTRUCT(BlueprintType, Category = "Runtime Files Downloader")
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadStatsTotals
+{
+	GENERATED_BODY()
+
+	/** The number of downloads */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 NumDownloads = 0;
+
+	/** The number of content bytes received */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 BytesReceived = 0;
+
+	/** The number of HTTP requests made */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 NumRequests = 0;
+
+	/** The number of requests that were retried */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 NumRetries = 0;
+
+	/** The number of fallbacks to the payload mode */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 NumPayloadFallbacks = 0;
+
+	/** The number of hedged requests made for straggling chunks */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 NumHedgedRequests = 0;
+
+	/** The number of hedged requests that completed before the request they duplicated */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 NumHedgeWins = 0;
+
+	/** The number of bytes currently held by all downloads from the download memory budget */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 MemoryBytes = 0;
+
+	/** The peak number of bytes held by all downloads from the download memory budget */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int64 PeakMemoryBytes = 0;
+
+	/** The number of downloads and chunk requests waiting for the download memory budget */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader|Telemetry")
+	int32 NumQueuedForMemory = 0;
+};
+
+/**
+ * Records the telemetry of a single download. Thread-safe
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadTelemetryRecorder
+{
+public:
+	/**
+	 * Record the start of an HTTP request
+	 *
+	 * @param URL The URL of the request
+	 */
+	void RecordRequestStarted(const FString& URL);
+
+	/**
+	 * Record the latency of a HEAD request
+	 *
+	 * @param Latency The time from starting the request to its completion, in seconds
+	 */
+	void RecordHeadLatency(double Latency);
+
+	/**
+	 * Record the start of a chunk or payload transfer
+	 *
+	 * @param Offset The offset of the transfer within the file, in bytes
+	 * @return The index of the transfer, used to record its progress
+	 */
+	int32 BeginTransfer(int64 Offset);
+
+	/**
+	 * Record that the transfer has received bytes. Only the first call has an effect
+	 */
+	void RecordFirstByte(int32 TransferIndex);
+
+	/**
+	 * Record the completion of a transfer
+	 *
+	 * @param TransferIndex The index returned by BeginTransfer
+	 * @param Size The number of bytes received
+	 * @param bSucceeded Whether the transfer has completed successfully
+	 */
+	void EndTransfer(int32 TransferIndex, int64 Size, bool bSucceeded);
+
+	/**
+	 * Record that a request was retried
+	 */
+	void RecordRetry();
+
+	/**
+	 * Record that the download fell back to the payload mode
+	 */
+	void RecordPayloadFallback();
+
+	/**
+	 * Record that a hedged request was made for a straggling chunk
+	 */
+	void RecordHedge();
+
+	/**
+	 * Record that a hedged request completed before the request it duplicated
+	 */
+	void RecordHedgeWon();
+
+	/**
+	 * Record the chunk size used by the download
+	 */
+	void RecordChunkSize(int64 ChunkSize);
+
+	/**
+	 * Record a change of the memory held by the download from the download memory budget
+	 *
+	 * @param Delta The number of bytes reserved, negative if released
+	 */
+	void RecordMemoryReserved(int64 Delta);
+
+	/**
+	 * Get the telemetry recorded so far
+	 */
+	FRuntimeDownloadTelemetry GetTelemetry() const;
+
+private:
+	/** Timestamps of a transfer, in FPlatformTime::Seconds */
+	struct FTransferTimes
+	{
+		double StartTime = 0;
+		double FirstByteTime = 0;
+		double EndTime = 0;
+	};
+
+	FRuntimeDownloadTelemetry Telemetry;
+	TArray<FTransferTimes> TransferTimes;
+
+	/** The time the first request was started, in FPlatformTime::Seconds */
+	double StartTime = 0;
+
+	/** The time the last HEAD request or transfer was completed, in FPlatformTime::Seconds */
+	double LastCompletionTime = 0;
+
+	mutable FCriticalSection CriticalSection;
+};
+
+/**
+ * Global download statistics, used to query the telemetry of recent downloads and totals over all downloads
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadStats
+{
+public:
+	/**
+	 * Get the global download statistics
+	 */
+	static FRuntimeDownloadStats& Get();
+
+	/**
+	 * Register the recorder of a download. Only the most recent downloads are kept
+	 */
+	void Register(const TSharedRef<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>& Recorder);
+
+	/**
+	 * Get the telemetry of the most recent downloads, from the oldest to the newest
+	 */
+	TArray<FRuntimeDownloadTelemetry> GetRecentDownloads() const;
+
+	/**
+	 * Get the totals over all downloads since the module was started
+	 */
+	FRuntimeDownloadStatsTotals GetTotals() const;
+
+	/**
+	 * Set the number of recent downloads kept
+	 */
+	void SetMaxRecentDownloads(int32 InMaxRecentDownloads);
+
+private:
+	friend class FRuntimeDownloadTelemetryRecorder;
+
+	/** Totals over all downloads */
+	FRuntimeDownloadStatsTotals Totals;
+
+	/** The recorders of the most recent downloads, from the oldest to the newest */
+	TArray<TSharedRef<FRuntimeDownloadTelemetryRecorder, ESPMode::ThreadSafe>> RecentRecorders;
+
+	/** The number of recent downloads kept */
+	int32 MaxRecentDownloads = 64;
+
+	mutable FCriticalSection CriticalSection;
+};
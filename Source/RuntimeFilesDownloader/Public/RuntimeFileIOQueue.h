@@ -0,0 +1,114 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "RuntimeSharedBuffer.h"
+
+/**
+ * Loads and saves files without blocking the game thread
+ * Operations run on worker threads, with a limit on the number of concurrent operations, further operations are queued in submission order
+ * Loading is built on the engine's asynchronous file reads, saving can optionally write to a temporary file which is then renamed over the destination
+ * Completion functions are always called on the game thread
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeFileIOQueue
+{
+public:
+	/**
+	 * Get the global file I/O queue
+	 */
+	static FRuntimeFileIOQueue& Get();
+
+	/**
+	 * Load a binary file asynchronously
+	 *
+	 * @param FilePath Path to the file to load
+	 * @param OnComplete A function called on the game thread with whether the operation was successful or not and the loaded data
+	 */
+	void LoadFileToArray(const FString& FilePath, TFunction<void(bool, TArray64<uint8>&&)> OnComplete);
+
+	/**
+	 * Load a text file asynchronously. The encoding is detected the same way as in BytesToString
+	 *
+	 * @param FilePath Path to the file to load
+	 * @param OnComplete A function called on the game thread with whether the operation was successful or not and the loaded string
+	 */
+	void LoadFileToString(const FString& FilePath, TFunction<void(bool, FString&&)> OnComplete);
+
+	/**
+	 * Save binary data to a file asynchronously
+	 *
+	 * @param Data The data to save. It is referenced rather than copied while saving
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination, so the destination never contains a partially written file
+	 * @param OnComplete A function called on the game thread with whether the operation was successful or not
+	 */
+	void SaveArrayToFile(const FRuntimeSharedBuffer& Data, const FString& FilePath, bool bAtomic, TFunction<void(bool)> OnComplete);
+
+	/**
+	 * Save a string to a file asynchronously. The string is written the same way as in SaveStringToFile
+	 *
+	 * @param String The string to save
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination, so the destination never contains a partially written file
+	 * @param OnComplete A function called on the game thread with whether the operation was successful or not
+	 */
+	void SaveStringToFile(FString String, const FString& FilePath, bool bAtomic, TFunction<void(bool)> OnComplete);
+
+	/**
+	 * Set the maximum number of file operations running at the same time. Further operations are queued
+	 *
+	 * @param InMaxConcurrentOperations The maximum number of concurrent operations, at least 1
+	 */
+	void SetMaxConcurrentOperations(int32 InMaxConcurrentOperations);
+
+	/**
+	 * Get the maximum number of file operations running at the same time
+	 */
+	int32 GetMaxConcurrentOperations() const;
+
+	/**
+	 * Get the number of file operations waiting for a free slot
+	 */
+	int32 GetNumPendingOperations() const;
+
+private:
+	FRuntimeFileIOQueue() = default;
+
+	/**
+	 * Queue an operation to be run on a worker thread
+	 */
+	void Enqueue(TFunction<void()>&& Operation);
+
+	/**
+	 * Start queued operations while there are free slots
+	 */
+	void StartPendingOperations();
+
+	/**
+	 * Read the whole file using the engine's asynchronous file reads. Must be called from a worker thread
+	 */
+	static bool ReadFile(const FString& FilePath, TArray64<uint8>& OutData);
+
+	/**
+	 * Save the file, optionally through a temporary file. Must be called from a worker thread
+	 *
+	 * @param FilePath Path to the file to save
+	 * @param bAtomic Whether to write to a temporary file first and rename it over the destination
+	 * @param WriteFunction A function that writes the data to the specified path
+	 */
+	static bool WriteFile(const FString& FilePath, bool bAtomic, TFunctionRef<bool(const FString&)> WriteFunction);
+
+	/** Operations waiting for a free slot */
+	TArray<TFunction<void()>> PendingOperations;
+
+	/** The number of operations currently running */
+	int32 NumActiveOperations = 0;
+
+	/** The maximum number of operations running at the same time */
+	int32 MaxConcurrentOperations = 2;
+
+	/** Guards access to the pending operations and counters */
+	mutable FCriticalSection CriticalSection;
+};
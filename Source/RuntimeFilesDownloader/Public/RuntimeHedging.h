@@ -0,0 +1,71 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Settings of hedged chunk requests. A chunk that straggles behind its peers is requested a second time, the first of the two requests to complete is used and the other one is canceled
+ */
+struct FRuntimeHedgingSettings
+{
+	/** Whether straggling chunks are hedged */
+	bool bEnabled = false;
+
+	/** A chunk is hedged once its throughput falls below this fraction of the median throughput of its peers */
+	float ThroughputRatio = 0.25f;
+
+	/** A chunk is hedged once it has been in flight for longer than this percentile of the durations of the completed chunks, in the range (0; 1] */
+	float LatencyPercentile = 0.95f;
+
+	/** The number of completed chunks required before the latency percentile is used */
+	int32 MinLatencySamples = 4;
+
+	/** The time a chunk must have been in flight before it can be hedged, in seconds, so that requests that are still connecting are left alone */
+	float MinElapsedTime = 1.f;
+
+	/** The maximum number of hedged requests in flight at the same time per stream or parallel download, limiting the extra traffic */
+	int32 MaxActiveHedges = 2;
+
+	/** How often the chunks in flight are checked for stragglers, in seconds */
+	float CheckInterval = 0.25f;
+};
+
+/**
+ * The durations and throughputs of recently completed chunks, against which the chunks in flight are checked for stragglers
+ */
+struct FRuntimeHedgingSamples
+{
+	/**
+	 * Add a completed chunk, dropping the oldest one once the samples are full
+	 *
+	 * @param Duration The time the chunk took to download, in seconds
+	 * @param Size The size of the chunk in bytes
+	 */
+	void Add(double Duration, int64 Size);
+
+	/**
+	 * Get the time in flight after which a chunk straggles regardless of its throughput, e.g. when its first byte never arrives
+	 *
+	 * @return The time in seconds, or the largest double if there are not enough completed chunks yet
+	 */
+	double GetLatencyThreshold(const FRuntimeHedgingSettings& Settings) const;
+
+	/**
+	 * Check whether the throughput of a chunk falls behind the median throughput of its peers
+	 *
+	 * @param Throughput The throughput of the chunk in bytes per second
+	 * @param PeerThroughputs The throughputs of the other chunks in flight. The completed chunks are added to them
+	 */
+	bool IsThroughputStraggling(const FRuntimeHedgingSettings& Settings, double Throughput, TArray<double> PeerThroughputs) const;
+
+private:
+	/** The number of completed chunks kept */
+	static constexpr int32 MaxSamples = 32;
+
+	/** The durations of the completed chunks in seconds */
+	TArray<double> Durations;
+
+	/** The throughputs of the completed chunks in bytes per second */
+	TArray<double> Throughputs;
+};
@@ -0,0 +1,132 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/UniquePtr.h"
+
+class IFileHandle;
+
+/**
+ * A writer for a file that is preallocated at its final size and filled at arbitrary offsets
+ * When the platform supports it, the file is memory-mapped so that data lands directly at its offset without seek/write calls. Otherwise, positioned writes through a regular file handle are used
+ * Writes to disjoint ranges may be issued from multiple threads
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeMappedFileWriter
+{
+public:
+	~FRuntimeMappedFileWriter();
+
+	/**
+	 * Create the file and preallocate it at the specified size. Fails fast if there is not enough free space, or if the file system cannot reserve the space up front
+	 * A sparse file is never created instead, since running out of space while writing into a mapping would crash instead of failing the download
+	 *
+	 * @param FilePath The absolute path of the file to create. An existing file is overwritten
+	 * @param FileSize The final size of the file in bytes
+	 * @return The writer, or nullptr if the file could not be created or preallocated
+	 */
+	static TUniquePtr<FRuntimeMappedFileWriter> Create(const FString& FilePath, int64 FileSize);
+
+	/**
+	 * Write data at the specified offset
+	 *
+	 * @param Offset The offset in the file to write at
+	 * @param Data The data to write
+	 * @param Size The size of the data in bytes
+	 * @return Whether the data was written or not
+	 */
+	bool Write(int64 Offset, const uint8* Data, int64 Size);
+
+	/**
+	 * Get direct access to the mapped file data, or nullptr if the file is not memory-mapped
+	 */
+	uint8* GetMappedData() const
+	{
+		return MappedData;
+	}
+
+	/**
+	 * Whether the file is memory-mapped or written through a file handle
+	 */
+	bool IsMapped() const
+	{
+		return MappedData != nullptr;
+	}
+
+	/**
+	 * Get the preallocated size of the file in bytes
+	 */
+	int64 GetFileSize() const
+	{
+		return FileSize;
+	}
+
+	/**
+	 * Get the path of the file
+	 */
+	const FString& GetFilePath() const
+	{
+		return FilePath;
+	}
+
+	/**
+	 * Flush all written data to the storage and close the file
+	 *
+	 * @return Whether the data was flushed successfully or not
+	 */
+	bool Finalize();
+
+	/**
+	 * Close the file without flushing and delete it
+	 */
+	void Abort();
+
+private:
+	FRuntimeMappedFileWriter(const FString& InFilePath, int64 InFileSize);
+
+	/**
+	 * Try to create, preallocate and map the file using native platform functions
+	 *
+	 * @param bOutPreallocationFailed Set to true if the file was created but its space could not be reserved, e.g. due to insufficient space or a file system without preallocation support
+	 * @return Whether the file was mapped or not
+	 */
+	bool OpenMapped(bool& bOutPreallocationFailed);
+
+	/**
+	 * Create and preallocate the file using a regular file handle. Only used on platforms where the file cannot be preallocated natively or mapped into the address space
+	 */
+	bool OpenHandle();
+
+	/**
+	 * Release the mapping and the native file, optionally flushing the data first
+	 */
+	bool CloseMapped(bool bFlush);
+
+	/** The path of the file */
+	FString FilePath;
+
+	/** The preallocated size of the file */
+	int64 FileSize;
+
+	/** The mapped file data, if the file is memory-mapped */
+	uint8* MappedData = nullptr;
+
+#if PLATFORM_WINDOWS
+	/** The native file and file mapping handles */
+	void* NativeFileHandle = nullptr;
+	void* NativeMappingHandle = nullptr;
+#else
+	/** The native file descriptor */
+	int32 NativeFileDescriptor = -1;
+#endif
+
+	/** The file handle used if the file could not be memory-mapped */
+	TUniquePtr<IFileHandle> FileHandle;
+
+	/** Guards positioned writes through the file handle */
+	FCriticalSection FileHandleCriticalSection;
+
+	/** Whether the file has been finalized or aborted */
+	bool bClosed = false;
+};
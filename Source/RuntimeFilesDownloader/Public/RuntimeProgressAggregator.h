@@ -0,0 +1,116 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Containers/Ticker.h"
+
+/**
+ * Coalesces the progress updates of HTTP requests and dispatches them in a single batch per frame
+ * Each request reports its progress as often as the HTTP module calls it, only the latest value is kept, and it is dispatched no more often than the configured rate
+ * Progress functions are called on the game thread, except for the final update which is dispatched synchronously when the request is unregistered
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeProgressAggregator
+{
+public:
+	/**
+	 * Get the global progress aggregator
+	 */
+	static FRuntimeProgressAggregator& Get();
+
+	/**
+	 * Register a request whose progress should be coalesced
+	 *
+	 * @param Name The name used in the summary log, usually the URL of the request
+	 * @param OnProgress A function called with the number of bytes received and the overall content size
+	 * @return The handle used to report the progress and to unregister the request
+	 */
+	uint64 Register(const FString& Name, TFunction<void(int64, int64)> OnProgress);
+
+	/**
+	 * Report the progress of a request. Thread-safe
+	 *
+	 * @param Handle The handle returned by Register
+	 * @param BytesReceived The number of bytes received so far
+	 * @param ContentSize The overall content size, or 0 if unknown
+	 */
+	void Report(uint64 Handle, int64 BytesReceived, int64 ContentSize);
+
+	/**
+	 * Unregister a request, dispatching its pending progress synchronously so that it is never delivered after the request completes
+	 *
+	 * @param Handle The handle returned by Register
+	 */
+	void Unregister(uint64 Handle);
+
+	/**
+	 * Set how often the progress of a single request can be dispatched
+	 *
+	 * @param InMaxUpdatesPerSecond The maximum number of updates per second, or 0 to dispatch once per frame
+	 * @param InMinBytesDelta The number of bytes after which an update is dispatched regardless of the rate, or 0 to disable
+	 */
+	void SetUpdateRate(float InMaxUpdatesPerSecond, int64 InMinBytesDelta);
+
+	/**
+	 * Remove the ticker used for dispatching. Called when the module is shut down
+	 */
+	void Shutdown();
+
+private:
+	FRuntimeProgressAggregator() = default;
+
+	/** Progress state of a registered request */
+	struct FProgressEntry
+	{
+		FString Name;
+		TFunction<void(int64, int64)> OnProgress;
+
+		/** The latest reported progress */
+		int64 BytesReceived = 0;
+		int64 ContentSize = 0;
+		bool bPending = false;
+
+		/** The last dispatched progress */
+		int64 DispatchedBytesReceived = 0;
+		double DispatchTime = 0;
+
+		/** Counters for the summary log */
+		int64 NumReported = 0;
+		int64 NumDispatched = 0;
+	};
+
+	/** A progress update collected for dispatching outside of the lock */
+	struct FProgressUpdate
+	{
+		TFunction<void(int64, int64)> OnProgress;
+		int64 BytesReceived;
+		int64 ContentSize;
+	};
+
+	/**
+	 * Dispatch the pending progress of all requests that are due
+	 */
+	bool Tick(float DeltaTime);
+
+	/** Registered requests by handle */
+	TMap<uint64, FProgressEntry> Entries;
+
+	/** The handle assigned to the next registered request */
+	uint64 NextHandle = 1;
+
+	/** The minimum time between two dispatches of the same request, in seconds */
+	double MinInterval = 0.1;
+
+	/** The number of bytes after which an update is dispatched regardless of the interval, 0 if disabled */
+	int64 MinBytesDelta = 0;
+
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+	FTSTicker::FDelegateHandle TickerHandle;
+#else
+	FDelegateHandle TickerHandle;
+#endif
+
+	mutable FCriticalSection CriticalSection;
+};
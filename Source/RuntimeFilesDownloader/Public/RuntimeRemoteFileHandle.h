@@ -0,0 +1,125 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/CriticalSection.h"
+
+class FRuntimeChunkDownloader;
+
+/**
+ * Settings of a remote file handle
+ */
+struct FRuntimeRemoteFileSettings
+{
+	/** The size of the blocks the file is fetched and cached in, in bytes. Blocks are aligned to multiples of this size */
+	int64 BlockSize = 256 * 1024;
+
+	/** The maximum number of blocks kept in the cache. The least recently used blocks are evicted first */
+	int32 MaxCachedBlocks = 64;
+
+	/** The number of blocks fetched ahead of a read once the reads follow a sequential pattern, 0 to disable readahead */
+	int32 MaxReadaheadBlocks = 8;
+
+	/** The timeout of each request in seconds */
+	float Timeout = 30.f;
+
+	/** The maximum time in seconds a read or the opening of the handle waits for the data, including the time spent queued behind other downloads. A read that times out fails, while its blocks keep downloading for later reads */
+	float WaitTimeout = 60.f;
+};
+
+/**
+ * A read-only file handle to a remote file, reading it with range requests as if it was a local file
+ * The file is fetched in aligned blocks on demand and kept in an LRU block cache. Adjacent missing blocks are fetched with a single range request, and sequential reads trigger readahead
+ * Reads block until the data has been received, and the HTTP requests complete on the game thread, so the handle must be opened and used on another thread
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeRemoteFileHandle : public IFileHandle
+{
+public:
+	virtual ~FRuntimeRemoteFileHandle() override;
+
+	/**
+	 * Open a remote file, obtaining its size with a HEAD request. Blocks until the size is known
+	 *
+	 * @param URL The URL of the file
+	 * @param Settings The settings of the handle
+	 * @return The file handle, or null if the size of the file could not be obtained
+	 */
+	static TUniquePtr<FRuntimeRemoteFileHandle> Open(const FString& URL, const FRuntimeRemoteFileSettings& Settings = FRuntimeRemoteFileSettings());
+
+	/**
+	 * Open a remote file as an archive, like IFileManager::CreateFileReader does for local files. Blocks until the size is known
+	 *
+	 * @param URL The URL of the file
+	 * @param Settings The settings of the underlying file handle
+	 * @return The archive, or null if the size of the file could not be obtained
+	 */
+	static TUniquePtr<FArchive> CreateReader(const FString& URL, const FRuntimeRemoteFileSettings& Settings = FRuntimeRemoteFileSettings());
+
+	//~ Begin IFileHandle Interface
+	virtual int64 Tell() override;
+	virtual bool Seek(int64 NewPosition) override;
+	virtual bool SeekFromEnd(int64 NewPositionRelativeToEnd = 0) override;
+	virtual bool Read(uint8* Destination, int64 BytesToRead) override;
+	virtual bool Write(const uint8* Source, int64 BytesToWrite) override;
+	virtual bool Flush(const bool bFullFlush = false) override;
+	virtual bool Truncate(int64 NewSize) override;
+	virtual int64 Size() override;
+	//~ End IFileHandle Interface
+
+	/**
+	 * Get the number of range requests made so far, excluding the HEAD request
+	 */
+	int64 GetNumRangeRequests() const;
+
+private:
+	FRuntimeRemoteFileHandle(const FString& InURL, int64 InFileSize, const FRuntimeRemoteFileSettings& InSettings, const TSharedPtr<FRuntimeChunkDownloader>& InDownloader);
+
+	/** A cached block of the file */
+	struct FBlock
+	{
+		/** The data of the block. Only valid once the block is ready */
+		TArray64<uint8> Data;
+
+		/** Resolves to whether the block has been downloaded */
+		TSharedFuture<bool> Ready;
+
+		/** The value of the use counter when the block was last read, for the LRU eviction */
+		uint64 LastUsed = 0;
+	};
+	using FBlockPtr = TSharedPtr<FBlock, ESPMode::ThreadSafe>;
+
+	/**
+	 * Get the blocks in the specified range, requesting the missing ones. Adjacent missing blocks are requested together
+	 */
+	TArray<FBlockPtr> RequestBlocks(int64 FirstBlockIndex, int64 LastBlockIndex);
+
+	/**
+	 * Evict the least recently used blocks until the cache fits into its capacity. The critical section must be held
+	 */
+	void EvictBlocks_Locked();
+
+	FString URL;
+	int64 FileSize;
+	FRuntimeRemoteFileSettings Settings;
+	TSharedPtr<FRuntimeChunkDownloader> Downloader;
+
+	/** The current read position */
+	int64 Position = 0;
+
+	/** The position right after the last read, used to detect sequential reads */
+	int64 LastReadEnd = -1;
+
+	/** The cached and in-flight blocks, by index */
+	TMap<int64, FBlockPtr> Blocks;
+
+	/** Incremented on every block use, for the LRU eviction */
+	uint64 UseCounter = 0;
+
+	int64 NumRangeRequests = 0;
+
+	/** Guards the blocks, since the downloaded data is delivered on the game thread */
+	mutable FCriticalSection CriticalSection;
+};
@@ -0,0 +1,143 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/Archive.h"
+#include "RuntimeSharedBuffer.h"
+
+/**
+ * A byte buffer made of a list of separately allocated segments (a rope)
+ * It allows holding large downloaded data without a single contiguous allocation and keeps chunks exactly as they were received
+ * Copying the buffer does not copy the data, since segments are shared buffers
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeSegmentedBuffer
+{
+public:
+	FRuntimeSegmentedBuffer() = default;
+
+	/**
+	 * Append a segment, taking ownership of the data without copying it
+	 *
+	 * @param Data The data of the segment
+	 */
+	void AppendSegment(TArray64<uint8>&& Data);
+
+	/**
+	 * Append a segment that shares the data of the specified buffer
+	 *
+	 * @param Buffer The data of the segment
+	 */
+	void AppendSegment(const FRuntimeSharedBuffer& Buffer);
+
+	/**
+	 * Remove all segments
+	 */
+	void Reset();
+
+	/**
+	 * Get the total size of all segments in bytes
+	 */
+	int64 Num() const
+	{
+		return TotalSize;
+	}
+
+	/**
+	 * Whether the buffer contains no data
+	 */
+	bool IsEmpty() const
+	{
+		return TotalSize == 0;
+	}
+
+	/**
+	 * Get the number of segments
+	 */
+	int32 GetNumSegments() const
+	{
+		return Segments.Num();
+	}
+
+	/**
+	 * Get the segment at the specified index
+	 */
+	const FRuntimeSharedBuffer& GetSegment(int32 SegmentIndex) const
+	{
+		return Segments[SegmentIndex];
+	}
+
+	/**
+	 * Get the offset of the segment at the specified index within the whole buffer
+	 */
+	int64 GetSegmentOffset(int32 SegmentIndex) const
+	{
+		return SegmentOffsets[SegmentIndex];
+	}
+
+	/**
+	 * Find the index of the segment containing the specified offset
+	 *
+	 * @param Offset The offset within the whole buffer
+	 * @return The segment index, or INDEX_NONE if the offset is out of range
+	 */
+	int32 FindSegmentIndex(int64 Offset) const;
+
+	/**
+	 * Get the views of the segments covering the specified range (scatter-gather). The range is clamped to the buffer size
+	 *
+	 * @param Offset The offset of the range within the whole buffer
+	 * @param Size The size of the range in bytes
+	 * @return The views, in order, covering the range
+	 */
+	TArray<TArrayView64<const uint8>> GetViews(int64 Offset, int64 Size) const;
+
+	/**
+	 * Copy the specified range into a contiguous destination (gather)
+	 *
+	 * @param Offset The offset of the range within the whole buffer
+	 * @param Destination The memory to copy the data to
+	 * @param Size The number of bytes to copy
+	 * @return The number of bytes actually copied, which may be less than Size if the range exceeds the buffer size
+	 */
+	int64 CopyTo(int64 Offset, uint8* Destination, int64 Size) const;
+
+	/**
+	 * Copy all segments into a single contiguous array
+	 */
+	TArray64<uint8> ToContiguousArray() const;
+
+private:
+	/** The segments, in order */
+	TArray<FRuntimeSharedBuffer> Segments;
+
+	/** The offset of each segment within the whole buffer */
+	TArray<int64> SegmentOffsets;
+
+	/** The total size of all segments */
+	int64 TotalSize = 0;
+};
+
+/**
+ * An archive reading from a segmented buffer, e.g. to deserialize downloaded data without making it contiguous
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeSegmentedBufferReader : public FArchive
+{
+public:
+	explicit FRuntimeSegmentedBufferReader(const FRuntimeSegmentedBuffer& InBuffer);
+
+	//~ Begin FArchive Interface
+	virtual void Serialize(void* Data, int64 Num) override;
+	virtual int64 Tell() override;
+	virtual int64 TotalSize() override;
+	virtual void Seek(int64 InPos) override;
+	virtual FString GetArchiveName() const override;
+	//~ End FArchive Interface
+
+private:
+	/** The buffer to read from. Copying the buffer only copies references to its segments */
+	FRuntimeSegmentedBuffer Buffer;
+
+	/** The current read position */
+	int64 Position = 0;
+};
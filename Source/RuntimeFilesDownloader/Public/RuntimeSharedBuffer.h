@@ -0,0 +1,156 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+
+/**
+ * The underlying storage of a shared buffer
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeSharedBufferStorage
+{
+public:
+	virtual ~FRuntimeSharedBufferStorage() = default;
+
+	/** Get a pointer to the stored data */
+	virtual const uint8* GetData() const = 0;
+
+	/** Get the size of the stored data in bytes */
+	virtual int64 Num() const = 0;
+
+	/** Get the array holding the data if the data is stored in memory, or nullptr otherwise */
+	virtual TArray64<uint8>* GetArray()
+	{
+		return nullptr;
+	}
+
+	/** Whether the data is stored in a file mapped into memory */
+	virtual bool IsFileBacked() const
+	{
+		return false;
+	}
+};
+
+/**
+ * A ref-counted, immutable byte buffer for downloaded data
+ * Copying the buffer only copies a reference, so the same data can be passed through futures and delegates without being duplicated
+ * A buffer may also be a slice of another buffer, sharing ownership of the underlying data
+ * The data is either held in memory or in a read-only memory-mapped file, and is accessed the same way in both cases
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeSharedBuffer
+{
+public:
+	FRuntimeSharedBuffer() = default;
+
+	/**
+	 * Create a buffer that takes ownership of the data without copying it
+	 *
+	 * @param Data The data to take ownership of
+	 * @return The shared buffer
+	 */
+	static FRuntimeSharedBuffer MakeOwned(TArray64<uint8>&& Data);
+
+	/**
+	 * Create a buffer holding a copy of the data
+	 *
+	 * @param Data The data to copy
+	 * @param Size The size of the data in bytes
+	 * @return The shared buffer
+	 */
+	static FRuntimeSharedBuffer MakeCopy(const uint8* Data, int64 Size);
+
+	/**
+	 * Create a buffer backed by a read-only memory mapping of the specified file
+	 *
+	 * @param FilePath The path of the file to map
+	 * @param bDeleteFileOnRelease Whether to delete the file once the last reference to the buffer is released
+	 * @return The shared buffer, or an empty buffer if the file could not be mapped
+	 */
+	static FRuntimeSharedBuffer MakeMappedFile(const FString& FilePath, bool bDeleteFileOnRelease);
+
+	/**
+	 * Whether the data is stored in a memory-mapped file rather than in memory
+	 */
+	bool IsFileBacked() const
+	{
+		return Storage.IsValid() && Storage->IsFileBacked();
+	}
+
+	/**
+	 * Get a pointer to the data, or nullptr if the buffer is empty
+	 */
+	const uint8* GetData() const
+	{
+		return Storage.IsValid() ? Storage->GetData() + Offset : nullptr;
+	}
+
+	/**
+	 * Get the size of the data in bytes
+	 */
+	int64 Num() const
+	{
+		return Size;
+	}
+
+	/**
+	 * Whether the buffer contains no data
+	 */
+	bool IsEmpty() const
+	{
+		return Size == 0;
+	}
+
+	/**
+	 * Get a view of the whole buffer
+	 */
+	TArrayView64<const uint8> GetView() const
+	{
+		return TArrayView64<const uint8>(GetData(), Size);
+	}
+
+	/**
+	 * Get a view of a part of the buffer. The range is clamped to the buffer size
+	 *
+	 * @param ViewOffset The offset of the view in bytes
+	 * @param ViewSize The size of the view in bytes
+	 */
+	TArrayView64<const uint8> GetView(int64 ViewOffset, int64 ViewSize) const;
+
+	/**
+	 * Get a buffer that references a part of this buffer without copying it. The range is clamped to the buffer size
+	 *
+	 * @param SliceOffset The offset of the slice in bytes
+	 * @param SliceSize The size of the slice in bytes
+	 */
+	FRuntimeSharedBuffer Slice(int64 SliceOffset, int64 SliceSize) const;
+
+	/**
+	 * Copy the data into a new array
+	 */
+	TArray64<uint8> ToArray() const;
+
+	/**
+	 * Get the data as an array. If this is the only reference to the whole underlying data, the data is moved out without copying. Otherwise, it is copied
+	 * The buffer is left empty
+	 */
+	TArray64<uint8> MoveToArray();
+
+	/**
+	 * Get the number of buffers that share the underlying data
+	 */
+	int32 GetSharedReferenceCount() const
+	{
+		return Storage.GetSharedReferenceCount();
+	}
+
+private:
+	/** The underlying data. It is never modified once shared */
+	TSharedPtr<FRuntimeSharedBufferStorage, ESPMode::ThreadSafe> Storage;
+
+	/** The offset of this buffer within the underlying data */
+	int64 Offset = 0;
+
+	/** The size of this buffer in bytes */
+	int64 Size = 0;
+};
@@ -0,0 +1,120 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Containers/Ticker.h"
+
+/**
+ * A low-speed limit of HTTP requests, detecting stalled connections long before the timeout of the whole request expires
+ */
+struct FRuntimeLowSpeedLimit
+{
+	/** The minimum average throughput over the window, in bytes per second, 0 to disable */
+	float MinBytesPerSecond = 0;
+
+	/** The length of the sliding window the throughput is averaged over, in seconds. The window starts with the request, so a slow start counts as well */
+	float WindowSeconds = 10;
+
+	/** The maximum time without receiving any byte, in seconds, 0 to disable */
+	float IdleTimeout = 0;
+
+	/** The number of times a stalled request is made again before giving up */
+	int32 MaxRetries = 3;
+
+	bool IsEnabled() const
+	{
+		return MinBytesPerSecond > 0 || IdleTimeout > 0;
+	}
+};
+
+/**
+ * Watches the progress of HTTP requests and reports the requests that fall below their low-speed limit
+ * The progress is reported from the progress delegates of the requests, and is checked on the game thread several times per second, so that a request that stopped reporting progress altogether is noticed too
+ * The progress delegates are dispatched on the game thread as well, so a hitch of the game thread holds back the progress of every request. The time of a hitch is left out of the idle times and the windows, so that it is not mistaken for a stall
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeStallMonitor
+{
+public:
+	/**
+	 * Get the global stall monitor
+	 */
+	static FRuntimeStallMonitor& Get();
+
+	/**
+	 * Start watching a request
+	 *
+	 * @param Name The name used in the log, usually the URL of the request
+	 * @param Limit The low-speed limit of the request
+	 * @param OnStalled A function called on the game thread once the request has stalled. The request is no longer watched from then on
+	 * @return The handle used to report the progress and to stop watching the request
+	 */
+	uint64 Register(const FString& Name, const FRuntimeLowSpeedLimit& Limit, TFunction<void()> OnStalled);
+
+	/**
+	 * Report the progress of a request. Thread-safe
+	 *
+	 * @param Handle The handle returned by Register
+	 * @param BytesReceived The number of bytes received so far
+	 */
+	void Report(uint64 Handle, int64 BytesReceived);
+
+	/**
+	 * Stop watching a request
+	 *
+	 * @param Handle The handle returned by Register
+	 */
+	void Unregister(uint64 Handle);
+
+	/**
+	 * Remove the ticker used for checking. Called when the module is shut down
+	 */
+	void Shutdown();
+
+private:
+	FRuntimeStallMonitor() = default;
+
+	/** The state of a watched request */
+	struct FStallEntry
+	{
+		FString Name;
+		FRuntimeLowSpeedLimit Limit;
+		TFunction<void()> OnStalled;
+
+		/** The time the request was registered, in FPlatformTime::Seconds */
+		double StartTime = 0;
+
+		/** The latest reported progress */
+		int64 BytesReceived = 0;
+
+		/** The time the last byte was received, in FPlatformTime::Seconds */
+		double LastByteTime = 0;
+
+		/** The progress sampled at each check within the window, as the time and the number of bytes received */
+		TArray<TPair<double, int64>> Samples;
+	};
+
+	/**
+	 * Check all watched requests against their limits
+	 */
+	bool Tick(float DeltaTime);
+
+	/** Watched requests by handle */
+	TMap<uint64, FStallEntry> Entries;
+
+	/** The handle assigned to the next registered request */
+	uint64 NextHandle = 1;
+
+	/** The time of the previous check, in FPlatformTime::Seconds, 0 before the first check */
+	double LastTickTime = 0;
+
+#if !UE_VERSION_OLDER_THAN(5, 0, 0)
+	FTSTicker::FDelegateHandle TickerHandle;
+#else
+	FDelegateHandle TickerHandle;
+#endif
+
+	mutable FCriticalSection CriticalSection;
+};
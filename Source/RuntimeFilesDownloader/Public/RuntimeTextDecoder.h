@@ -0,0 +1,75 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Text encodings recognized when decoding downloaded bytes
+ */
+enum class ERuntimeTextEncoding : uint8
+{
+	/** Single-byte encoding where each byte is a code point (the legacy behavior for non-UTF-8 data) */
+	Latin1,
+	/** UTF-8, with or without a byte order mark. Pure ASCII data is reported as UTF-8 */
+	UTF8,
+	/** UTF-16 little endian, detected by its byte order mark */
+	UTF16LE,
+	/** UTF-16 big endian, detected by its byte order mark */
+	UTF16BE
+};
+
+/**
+ * Decodes downloaded bytes into strings
+ * The encoding is detected from a byte order mark or by validating the data as UTF-8, falling back to Latin-1
+ * ASCII runs are scanned several bytes at a time and the output string is allocated once
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeTextDecoder
+{
+public:
+	/**
+	 * Detect the encoding of the specified data
+	 *
+	 * @param Data The data to inspect
+	 * @param Size The size of the data in bytes
+	 * @param OutBOMSize The size of the byte order mark at the start of the data, or 0 if there is none
+	 * @return The detected encoding
+	 */
+	static ERuntimeTextEncoding DetectEncoding(const uint8* Data, int64 Size, int32& OutBOMSize);
+
+	/**
+	 * Decode the specified data into a string, detecting its encoding
+	 *
+	 * @param Data The data to decode
+	 * @param Size The size of the data in bytes
+	 * @return The decoded string, empty on failure
+	 */
+	static FString Decode(const uint8* Data, int64 Size);
+
+	/**
+	 * Decode the specified data into a string using the specified encoding
+	 *
+	 * @param Data The data to decode, without a byte order mark
+	 * @param Size The size of the data in bytes
+	 * @param Encoding The encoding of the data
+	 * @return The decoded string, empty on failure
+	 */
+	static FString Decode(const uint8* Data, int64 Size, ERuntimeTextEncoding Encoding);
+
+	/**
+	 * Get the number of leading bytes that are 7-bit ASCII
+	 *
+	 * @param Data The data to inspect
+	 * @param Size The size of the data in bytes
+	 * @return The length of the ASCII prefix in bytes
+	 */
+	static int64 CountLeadingASCII(const uint8* Data, int64 Size);
+
+	/**
+	 * Check whether the specified data is well-formed UTF-8
+	 *
+	 * @param Data The data to validate
+	 * @param Size The size of the data in bytes
+	 */
+	static bool IsValidUTF8(const uint8* Data, int64 Size);
+};
@@ -0,0 +1,74 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "RuntimeSharedBuffer.h"
+
+class UTexture2D;
+
+/**
+ * Decodes compressed images (PNG, JPEG, BMP, etc.) into textures without blocking the game thread
+ * Decoding and the creation of the texture platform data happen on worker threads, with a limit on the number of concurrent decodes. Only the final creation of the texture object happens on the game thread
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeTextureDecoder
+{
+public:
+	/**
+	 * Get the global texture decoder
+	 */
+	static FRuntimeTextureDecoder& Get();
+
+	/**
+	 * Decode the specified image data into a texture asynchronously. Calls made outside of the game thread are forwarded to it
+	 *
+	 * @param ImageData The compressed image data
+	 * @param OnComplete A function called on the game thread with the created texture, or nullptr on failure
+	 */
+	void DecodeAsync(const FRuntimeSharedBuffer& ImageData, TFunction<void(UTexture2D*)> OnComplete);
+
+	/**
+	 * Set the maximum number of images decoded at the same time. Further requests are queued
+	 *
+	 * @param InMaxConcurrentDecodes The maximum number of concurrent decodes, at least 1
+	 */
+	void SetMaxConcurrentDecodes(int32 InMaxConcurrentDecodes);
+
+	/**
+	 * Get the maximum number of images decoded at the same time
+	 */
+	int32 GetMaxConcurrentDecodes() const;
+
+private:
+	FRuntimeTextureDecoder();
+
+	/** A decode request waiting for a free decode slot */
+	struct FDecodeRequest
+	{
+		FRuntimeSharedBuffer ImageData;
+		TFunction<void(UTexture2D*)> OnComplete;
+	};
+
+	/**
+	 * Start queued decode requests while there are free decode slots
+	 */
+	void StartPendingDecodes();
+
+	/**
+	 * Decode the request on the current (worker) thread and finish it on the game thread
+	 */
+	void Decode(FDecodeRequest&& Request);
+
+	/** Decode requests waiting for a free decode slot */
+	TArray<FDecodeRequest> PendingRequests;
+
+	/** The number of decodes currently running */
+	int32 NumActiveDecodes = 0;
+
+	/** The maximum number of decodes running at the same time */
+	int32 MaxConcurrentDecodes;
+
+	/** Guards access to the pending requests and counters */
+	mutable FCriticalSection CriticalSection;
+};
@@ -17,5 +17,12 @@ public class RuntimeFilesDownloader : ModuleRules
 				"HTTP"
 			}
 		);
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"ImageWrapper"
+			}
+		);
 	}
 }
\ No newline at end of file